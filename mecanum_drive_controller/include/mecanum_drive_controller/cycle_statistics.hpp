@@ -0,0 +1,278 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__CYCLE_STATISTICS_HPP_
+#define MECANUM_DRIVE_CONTROLLER__CYCLE_STATISTICS_HPP_
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// The instrumentation is compiled out by defining MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS=0
+// (CMake option of the same name).
+#ifndef MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS
+#define MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS 1
+#endif
+
+namespace mecanum_drive_controller
+{
+/// \brief Histogram of durations with a fixed memory footprint.
+///
+/// Bins are log-linear: every power of two of nanoseconds is split in 4 bins, so the relative
+/// resolution is 25% from 1 ns up to the range of int64_t. Adding a sample never allocates.
+class DurationHistogram
+{
+public:
+  static constexpr size_t NR_SUB_BINS = 4;
+  static constexpr size_t NR_BINS = 64 * NR_SUB_BINS;
+
+  DurationHistogram() { reset(); }
+
+  void reset()
+  {
+    bins_.fill(0);
+    count_ = 0;
+    sum_ns_ = 0;
+    min_ns_ = std::numeric_limits<int64_t>::max();
+    max_ns_ = 0;
+  }
+
+  void add(int64_t duration_ns)
+  {
+    duration_ns = duration_ns > 0 ? duration_ns : 0;
+    ++bins_[binIndex(duration_ns)];
+    ++count_;
+    sum_ns_ += duration_ns;
+    min_ns_ = duration_ns < min_ns_ ? duration_ns : min_ns_;
+    max_ns_ = duration_ns > max_ns_ ? duration_ns : max_ns_;
+  }
+
+  uint64_t count() const { return count_; }
+  int64_t min() const { return count_ > 0 ? min_ns_ : 0; }
+  int64_t max() const { return max_ns_; }
+  int64_t mean() const { return count_ > 0 ? sum_ns_ / static_cast<int64_t>(count_) : 0; }
+
+  /// \return upper bound of the bin holding the \p quantile (e.g. 0.99) of the samples [ns]
+  int64_t percentile(double quantile) const
+  {
+    if (count_ == 0)
+    {
+      return 0;
+    }
+    const auto rank = static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(count_)));
+    uint64_t cumulated = 0;
+    for (size_t i = 0; i < NR_BINS; ++i)
+    {
+      cumulated += bins_[i];
+      if (cumulated >= rank && bins_[i] > 0)
+      {
+        const int64_t upper_bound = binUpperBound(i);
+        return upper_bound < max_ns_ ? upper_bound : max_ns_;
+      }
+    }
+    return max_ns_;
+  }
+
+  static size_t binIndex(int64_t duration_ns)
+  {
+    if (duration_ns < static_cast<int64_t>(NR_SUB_BINS))
+    {
+      return static_cast<size_t>(duration_ns);
+    }
+    const int exponent = std::ilogb(static_cast<double>(duration_ns));
+    const auto sub_bin = static_cast<size_t>((duration_ns >> (exponent - 2)) & 0x3);
+    return NR_SUB_BINS * static_cast<size_t>(exponent - 1) + sub_bin;
+  }
+
+  static int64_t binUpperBound(size_t index)
+  {
+    if (index < NR_SUB_BINS)
+    {
+      return static_cast<int64_t>(index);
+    }
+    const auto exponent = static_cast<int>(index / NR_SUB_BINS + 1);
+    const auto sub_bin = static_cast<int64_t>(index % NR_SUB_BINS);
+    const int64_t width = int64_t{1} << (exponent - 2);
+    return (static_cast<int64_t>(NR_SUB_BINS) + sub_bin) * width + width - 1;
+  }
+
+private:
+  std::array<uint32_t, NR_BINS> bins_;
+  uint64_t count_;
+  int64_t sum_ns_;
+  int64_t min_ns_;
+  int64_t max_ns_;
+};
+
+/// \brief Phases of the control cycle measured by CycleStatistics
+enum class CyclePhase : size_t
+{
+  PERIOD = 0,          // time between the starts of two control cycles
+  REFERENCE,           // update_reference_from_subscribers
+  FORWARD_KINEMATICS,  // reading wheel states and FK
+  ODOMETRY,            // odometry integration
+  INVERSE_KINEMATICS,  // IK and writing commands
+  PUBLISHING,          // odometry, tf and state publishers
+  UPDATE,              // whole update_and_write_commands
+  NR_PHASES
+};
+
+/// \brief Events counted by CycleStatistics
+enum class CycleEvent : size_t
+{
+  DROPPED_ODOM_PUBLISH = 0,  // odometry publisher was busy when a message was due
+  DROPPED_TF_PUBLISH,        // tf publisher was busy when a message was due
+  DROPPED_STATE_PUBLISH,     // state publisher was busy when a message was due
+  STALE_REFERENCE,           // reference discarded because of the reference timeout
+  NAN_WHEEL_STATE,           // cycle without odometry update because a wheel state is NaN
+  WHEEL_SLIP,                // cycle with a slipping wheel detected
+  NR_EVENTS
+};
+
+/// \brief Timing histograms of the control cycle phases and event counters.
+///
+/// Everything is preallocated, measuring uses std::chrono::steady_clock. With
+/// MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS=0 all methods are empty.
+class CycleStatistics
+{
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr size_t NR_PHASES = static_cast<size_t>(CyclePhase::NR_PHASES);
+  static constexpr size_t NR_EVENTS = static_cast<size_t>(CycleEvent::NR_EVENTS);
+  static constexpr bool ENABLED = MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS != 0;
+
+  /// \brief Scope measuring the duration of a phase
+  class ScopedPhase
+  {
+  public:
+    ScopedPhase(CycleStatistics & statistics, CyclePhase phase)
+#if MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS
+    : statistics_(statistics), phase_(phase), start_(Clock::now())
+#endif
+    {
+      (void)statistics;
+      (void)phase;
+    }
+
+    ~ScopedPhase()
+    {
+#if MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS
+      statistics_.addDuration(phase_, Clock::now() - start_);
+#endif
+    }
+
+    ScopedPhase(const ScopedPhase &) = delete;
+    ScopedPhase & operator=(const ScopedPhase &) = delete;
+
+#if MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS
+
+  private:
+    CycleStatistics & statistics_;
+    CyclePhase phase_;
+    Clock::time_point start_;
+#endif
+  };
+
+  /// \brief Resets the histograms, the event counters are kept
+  void resetHistograms()
+  {
+    for (auto & histogram : histograms_)
+    {
+      histogram.reset();
+    }
+  }
+
+  /// \brief Resets histograms and event counters
+  void reset()
+  {
+    resetHistograms();
+    events_.fill(0);
+    last_cycle_start_set_ = false;
+  }
+
+  /// \brief Marks the start of a control cycle, used for the PERIOD phase
+  void startCycle()
+  {
+#if MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS
+    const auto now = Clock::now();
+    if (last_cycle_start_set_)
+    {
+      addDuration(CyclePhase::PERIOD, now - last_cycle_start_);
+    }
+    last_cycle_start_ = now;
+    last_cycle_start_set_ = true;
+#endif
+  }
+
+  /// \brief Starts measuring \p phase, for sections which are not a scope
+  void startPhase(CyclePhase phase)
+  {
+#if MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS
+    phase_starts_[static_cast<size_t>(phase)] = Clock::now();
+#else
+    (void)phase;
+#endif
+  }
+
+  /// \brief Adds the duration since startPhase() to the histogram of \p phase
+  void stopPhase(CyclePhase phase)
+  {
+#if MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS
+    addDuration(phase, Clock::now() - phase_starts_[static_cast<size_t>(phase)]);
+#else
+    (void)phase;
+#endif
+  }
+
+  void addDuration(CyclePhase phase, Clock::duration duration)
+  {
+#if MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS
+    histograms_[static_cast<size_t>(phase)].add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+#else
+    (void)phase;
+    (void)duration;
+#endif
+  }
+
+  void count(CycleEvent event)
+  {
+#if MECANUM_DRIVE_CONTROLLER_ENABLE_DIAGNOSTICS
+    ++events_[static_cast<size_t>(event)];
+#else
+    (void)event;
+#endif
+  }
+
+  const DurationHistogram & histogram(CyclePhase phase) const
+  {
+    return histograms_[static_cast<size_t>(phase)];
+  }
+
+  uint64_t events(CycleEvent event) const { return events_[static_cast<size_t>(event)]; }
+
+private:
+  std::array<DurationHistogram, NR_PHASES> histograms_;
+  std::array<uint64_t, NR_EVENTS> events_ = {};
+  std::array<Clock::time_point, NR_PHASES> phase_starts_;
+  Clock::time_point last_cycle_start_;
+  bool last_cycle_start_set_ = false;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__CYCLE_STATISTICS_HPP_
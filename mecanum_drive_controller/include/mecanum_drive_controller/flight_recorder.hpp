@@ -0,0 +1,138 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__FLIGHT_RECORDER_HPP_
+#define MECANUM_DRIVE_CONTROLLER__FLIGHT_RECORDER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mecanum_drive_controller
+{
+/// \brief Header at the start of a flight recorder file
+///
+/// The file is the header followed by 'capacity' records of 'record_size' bytes. A record is the
+/// int64 stamp [ns] followed by the doubles: wheel states, wheel commands (nr_wheels each),
+/// references [vx, vy, wz], pose [x, y, theta] and twist [vx, vy, wz].
+struct FlightRecorderHeader
+{
+  static constexpr uint64_t MAGIC = 0x31524643454d5f5fULL;  // "__MECFR1" little endian
+  static constexpr uint32_t VERSION = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t nr_wheels;
+  uint64_t record_size;  // [bytes]
+  uint64_t capacity;     // [records]
+  // Number of records written since the file was opened, the newest one is at
+  // (nr_records - 1) % capacity
+  uint64_t nr_records;
+};
+
+/// \brief Records the controller state of every control cycle into a memory mapped file.
+///
+/// The file is created, sized and touched at open(), so that writing a record in the control loop
+/// is a copy into resident memory: no system call, allocation or lock. A background thread
+/// periodically asks the kernel to write the dirty pages back to the file. When the file is full
+/// the oldest records are overwritten.
+class FlightRecorder
+{
+public:
+  // references, pose and twist
+  static constexpr size_t NR_BASE_VALUES = 9;
+
+  FlightRecorder() = default;
+  ~FlightRecorder();
+
+  FlightRecorder(const FlightRecorder &) = delete;
+  FlightRecorder & operator=(const FlightRecorder &) = delete;
+
+  /// \brief Creates the file and starts the flush thread (not RT safe)
+  /// \param path File, an existing one is kept by renaming it with the suffix of its modification
+  /// time, see rotatedPath()
+  /// \param nr_wheels Number of wheel states and commands per record
+  /// \param capacity Number of records kept in the file
+  /// \param flush_period Period of writing the file back to the disk
+  /// \return false if the file could not be created or mapped, \p error holds the reason
+  bool open(
+    const std::string & path, size_t nr_wheels, size_t capacity,
+    std::chrono::nanoseconds flush_period, std::string & error);
+
+  /// \brief Stops the flush thread, writes back and unmaps the file (not RT safe)
+  void close();
+
+  bool isOpen() const { return mapping_ != nullptr; }
+
+  /// \return path the existing file was moved to by the last open(), empty if there was none
+  const std::string & rotatedPath() const { return rotated_path_; }
+
+  /// \return number of doubles after the stamp in a record
+  size_t nrValues() const { return nr_values_; }
+
+  /// \brief Writes a record (RT safe)
+  /// \param values nrValues() doubles in the order of FlightRecorderHeader
+  void write(int64_t stamp_ns, const double * values);
+
+private:
+  bool rotate(const std::string & path, std::string & error);
+  void flushLoop(std::chrono::nanoseconds flush_period);
+
+  FlightRecorderHeader * header_ = nullptr;
+  std::atomic<uint64_t> * nr_records_ = nullptr;
+  uint8_t * records_ = nullptr;
+  void * mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  int file_descriptor_ = -1;
+  size_t nr_values_ = 0;
+  size_t record_size_ = 0;
+  uint64_t capacity_ = 0;
+  std::string rotated_path_;
+
+  std::thread flush_thread_;
+  std::mutex flush_mutex_;
+  std::condition_variable flush_condition_;
+  bool stop_flush_ = false;
+};
+
+/// \brief Reads a flight recorder file, e.g., for offline analysis
+class FlightRecorderReader
+{
+public:
+  /// \return false if the file could not be read or is not a flight recorder file
+  bool open(const std::string & path, std::string & error);
+
+  const FlightRecorderHeader & header() const { return header_; }
+
+  /// \return number of records in the file
+  size_t size() const;
+
+  /// \brief Reads a record, 0 is the oldest one
+  /// \param values Resized to the number of doubles of a record
+  void read(size_t index, int64_t & stamp_ns, std::vector<double> & values) const;
+
+private:
+  FlightRecorderHeader header_{};
+  std::vector<uint8_t> records_;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__FLIGHT_RECORDER_HPP_
@@ -0,0 +1,164 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__KINEMATICS_CALIBRATION_HPP_
+#define MECANUM_DRIVE_CONTROLLER__KINEMATICS_CALIBRATION_HPP_
+
+#include <cmath>
+#include <cstddef>
+
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+
+namespace mecanum_drive_controller
+{
+/// \brief Online estimation of the wheels radius and the wheelbase out of an external twist.
+///
+/// The linear velocities of the FK twist scale with the wheels radius r and the angular velocity
+/// with r / L, where L is the sum of the center projections of the wheels. Comparing the FK twist
+/// computed with the configured parameters to a measured twist (e.g. from a visual odometry or a
+/// motion capture) gives the two scales
+///
+///   measured linear  = linear_scale  * FK linear,   linear_scale  = r_true / r
+///   measured angular = angular_scale * FK angular,  angular_scale = (r_true / L_true) / (r / L)
+///
+/// which are estimated by two scalar recursive least squares with exponential forgetting. Each
+/// update is a few multiplications, so it runs in the RT loop. Samples with too little motion are
+/// skipped, which also bounds the covariance growth caused by the forgetting.
+///
+/// \note The lever arm of a translated base frame couples the angular velocity into the linear
+/// one, the estimate is exact for a base frame at the center (any orientation).
+class KinematicsCalibration
+{
+public:
+  struct Estimate
+  {
+    double linear_scale = 1.0;
+    double angular_scale = 1.0;
+    /// Suggested parameters [m]
+    double wheels_radius = 0.0;
+    double sum_of_robot_center_projection_on_X_Y_axis = 0.0;
+    /// RLS covariances of the scales (not scaled by the measurement noise), small once converged
+    double linear_variance = 0.0;
+    double angular_variance = 0.0;
+    /// Number of samples used for each scale
+    size_t nr_linear_samples = 0;
+    size_t nr_angular_samples = 0;
+  };
+
+  /// \param wheels_radius Configured wheels radius [m]
+  /// \param sum_of_robot_center_projection_on_X_Y_axis Configured wheels geometric param [m]
+  /// \param forgetting_factor Weight of the past per sample, in (0, 1], 1 means no forgetting
+  /// \param min_linear_velocity Minimal measured linear speed of a linear sample [m/s]
+  /// \param min_angular_velocity Minimal measured angular speed of an angular sample [rad/s]
+  /// \param initial_variance Variance of the initial scales of 1
+  void configure(
+    double wheels_radius, double sum_of_robot_center_projection_on_X_Y_axis,
+    double forgetting_factor, double min_linear_velocity, double min_angular_velocity,
+    double initial_variance = 1.0)
+  {
+    wheels_radius_ = wheels_radius;
+    sum_of_projections_ = sum_of_robot_center_projection_on_X_Y_axis;
+    forgetting_factor_ = forgetting_factor;
+    min_linear_velocity_ = min_linear_velocity;
+    min_angular_velocity_ = min_angular_velocity;
+    initial_variance_ = initial_variance;
+    reset();
+  }
+
+  /// \brief Restarts the estimation at the configured parameters
+  void reset()
+  {
+    linear_.reset(initial_variance_);
+    angular_.reset(initial_variance_);
+  }
+
+  /// \brief Adds a pair of twists of the same instant (RT safe)
+  /// \param fk_twist Twist computed by FK with the configured parameters [vx, vy, wz]
+  /// \param measured Externally measured twist of the base frame [vx, vy, wz]
+  void update(const MecanumKinematics::Twist & fk_twist, const MecanumKinematics::Twist & measured)
+  {
+    for (size_t i = 0; i < 3; ++i)
+    {
+      if (!std::isfinite(fk_twist[i]) || !std::isfinite(measured[i]))
+      {
+        return;
+      }
+    }
+    if (std::hypot(measured[0], measured[1]) >= min_linear_velocity_)
+    {
+      linear_.update(fk_twist[0], measured[0], forgetting_factor_, initial_variance_);
+      linear_.update(fk_twist[1], measured[1], forgetting_factor_, initial_variance_);
+    }
+    if (std::abs(measured[2]) >= min_angular_velocity_)
+    {
+      angular_.update(fk_twist[2], measured[2], forgetting_factor_, initial_variance_);
+    }
+  }
+
+  Estimate estimate() const
+  {
+    Estimate estimate;
+    estimate.linear_scale = linear_.scale;
+    estimate.angular_scale = angular_.scale;
+    estimate.wheels_radius = wheels_radius_ * linear_.scale;
+    // r / L scales with angular_scale, so L scales with linear_scale / angular_scale
+    estimate.sum_of_robot_center_projection_on_X_Y_axis =
+      angular_.scale != 0.0 ? sum_of_projections_ * linear_.scale / angular_.scale : 0.0;
+    estimate.linear_variance = linear_.variance;
+    estimate.angular_variance = angular_.variance;
+    estimate.nr_linear_samples = linear_.nr_samples;
+    estimate.nr_angular_samples = angular_.nr_samples;
+    return estimate;
+  }
+
+private:
+  /// Recursive least squares of measurement = scale * regressor
+  struct ScalarEstimator
+  {
+    double scale = 1.0;
+    double variance = 1.0;
+    size_t nr_samples = 0;
+
+    void reset(double initial_variance)
+    {
+      scale = 1.0;
+      variance = initial_variance;
+      nr_samples = 0;
+    }
+
+    void update(double regressor, double measurement, double forgetting_factor, double max_variance)
+    {
+      const double gain =
+        variance * regressor / (forgetting_factor + regressor * variance * regressor);
+      scale += gain * (measurement - scale * regressor);
+      // the variance is bounded so that the forgetting cannot wind it up in poorly excited phases
+      variance = std::fmin((1.0 - gain * regressor) * variance / forgetting_factor, max_variance);
+      ++nr_samples;
+    }
+  };
+
+  double wheels_radius_ = 0.0;
+  double sum_of_projections_ = 0.0;
+  double forgetting_factor_ = 1.0;
+  double min_linear_velocity_ = 0.0;
+  double min_angular_velocity_ = 0.0;
+  double initial_variance_ = 1.0;
+
+  ScalarEstimator linear_;
+  ScalarEstimator angular_;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__KINEMATICS_CALIBRATION_HPP_
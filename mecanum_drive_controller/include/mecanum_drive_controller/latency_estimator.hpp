@@ -0,0 +1,132 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__LATENCY_ESTIMATOR_HPP_
+#define MECANUM_DRIVE_CONTROLLER__LATENCY_ESTIMATOR_HPP_
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "mecanum_drive_controller/cycle_statistics.hpp"
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+#include "mecanum_drive_controller/odometry_integration_kernel.hpp"
+
+namespace mecanum_drive_controller
+{
+/// \brief Transport latency of a stamped topic, from the header stamp to the reception.
+///
+/// The latency and its jitter are smoothed like the round-trip time of TCP (RFC 6298):
+///
+///   jitter  += gain * (|sample - latency| - jitter)
+///   latency += gain * (sample - latency)
+///
+/// Samples are also collected in a DurationHistogram for the diagnostics. A negative sample means
+/// the clocks of sender and receiver are not synchronized; it is counted and clamped to zero.
+/// Adding a sample never allocates.
+class LatencyEstimator
+{
+public:
+  /// \param gain Weight of a new sample in the smoothed latency and jitter, in (0, 1]
+  void configure(double gain)
+  {
+    gain_ = gain;
+    reset();
+  }
+
+  /// \brief Forgets all samples
+  void reset()
+  {
+    latency_ns_ = 0.0;
+    jitter_ns_ = 0.0;
+    nr_samples_ = 0;
+    nr_negative_samples_ = 0;
+    histogram_.reset();
+  }
+
+  /// \brief Adds the latency of one received message (RT safe)
+  /// \param stamp_ns Header stamp of the message [ns]
+  /// \param receive_ns Time the message was received [ns]
+  void add(int64_t stamp_ns, int64_t receive_ns)
+  {
+    int64_t latency_ns = receive_ns - stamp_ns;
+    if (latency_ns < 0)
+    {
+      ++nr_negative_samples_;
+      latency_ns = 0;
+    }
+    histogram_.add(latency_ns);
+
+    const auto sample = static_cast<double>(latency_ns);
+    if (nr_samples_ == 0)
+    {
+      latency_ns_ = sample;
+      jitter_ns_ = 0.5 * sample;
+    }
+    else
+    {
+      jitter_ns_ += gain_ * (std::abs(sample - latency_ns_) - jitter_ns_);
+      latency_ns_ += gain_ * (sample - latency_ns_);
+    }
+    ++nr_samples_;
+  }
+
+  /// \return smoothed latency [ns], 0 before the first sample
+  double latency() const { return latency_ns_; }
+
+  /// \return smoothed mean deviation of the latency [ns]
+  double jitter() const { return jitter_ns_; }
+
+  /// \return number of samples since reset()
+  uint64_t samples() const { return nr_samples_; }
+
+  /// \return number of samples stamped after their reception since reset()
+  uint64_t negativeSamples() const { return nr_negative_samples_; }
+
+  /// \return histogram of the samples since reset() or resetHistogram()
+  const DurationHistogram & histogram() const { return histogram_; }
+
+  /// \brief Resets the histogram only, the smoothed latency is kept
+  void resetHistogram() { histogram_.reset(); }
+
+private:
+  double gain_ = 0.1;
+  double latency_ns_ = 0.0;
+  double jitter_ns_ = 0.0;
+  uint64_t nr_samples_ = 0;
+  uint64_t nr_negative_samples_ = 0;
+  DurationHistogram histogram_;
+};
+
+/// \brief Extrapolates a planar pose with a constant body twist (SE(2) exponential)
+/// \param pose Pose [x, y, theta] of the frame the twist is expressed in
+/// \param twist Body twist [vx, vy, wz]
+/// \param horizon Prediction time [s]
+/// \param predicted Output, pose after \p horizon, may alias \p pose
+inline void predictPose(
+  const std::array<double, 3> & pose, const MecanumKinematics::Twist & twist, double horizon,
+  std::array<double, 3> & predicted)
+{
+  const double theta_end = pose[2] + twist[2] * horizon;
+  double c;
+  double s;
+  ExactIntegration::rotation(pose[2], theta_end, c, s);
+  predicted = {
+    pose[0] + (c * twist[0] - s * twist[1]) * horizon,
+    pose[1] + (s * twist[0] + c * twist[1]) * horizon, theta_end};
+}
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__LATENCY_ESTIMATOR_HPP_
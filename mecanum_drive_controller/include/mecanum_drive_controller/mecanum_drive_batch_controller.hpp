@@ -0,0 +1,154 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__MECANUM_DRIVE_BATCH_CONTROLLER_HPP_
+#define MECANUM_DRIVE_CONTROLLER__MECANUM_DRIVE_BATCH_CONTROLLER_HPP_
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "controller_interface/chainable_controller_interface.hpp"
+#include "mecanum_drive_batch_controller_parameters.hpp"
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+#include "mecanum_drive_controller/reference_mailbox.hpp"
+#include "mecanum_drive_controller/visibility_control.h"
+#include "rclcpp_lifecycle/node_interfaces/lifecycle_node_interface.hpp"
+#include "rclcpp_lifecycle/state.hpp"
+#include "realtime_tools/realtime_publisher.h"
+
+#include "geometry_msgs/msg/twist_stamped.hpp"
+#include "tf2_msgs/msg/tf_message.hpp"
+
+namespace mecanum_drive_controller
+{
+/// \brief Mecanum drive controller driving many identical bases from one plugin instance.
+///
+/// All bases share the kinematic parameters. Wheel states, references and odometry of the bases
+/// are kept in structure-of-arrays buffers (one contiguous array per quantity, indexed by base),
+/// so FK, IK and odometry integration of all bases are computed in loops over the bases which
+/// the compiler can vectorize. Each base still has its own reference interfaces
+/// (<base>/linear/x/velocity, ...), reference topic and odometry transform.
+class MecanumDriveBatchController : public controller_interface::ChainableControllerInterface
+{
+public:
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  MecanumDriveBatchController();
+
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  controller_interface::CallbackReturn on_init() override;
+
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  controller_interface::InterfaceConfiguration command_interface_configuration() const override;
+
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  controller_interface::InterfaceConfiguration state_interface_configuration() const override;
+
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  controller_interface::CallbackReturn on_configure(
+    const rclcpp_lifecycle::State & previous_state) override;
+
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  controller_interface::CallbackReturn on_activate(
+    const rclcpp_lifecycle::State & previous_state) override;
+
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  controller_interface::CallbackReturn on_deactivate(
+    const rclcpp_lifecycle::State & previous_state) override;
+
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  controller_interface::return_type update_reference_from_subscribers() override;
+
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  controller_interface::return_type update_and_write_commands(
+    const rclcpp::Time & time, const rclcpp::Duration & period) override;
+
+  /// \brief Odometry of each base for controllers chained in front
+  ///
+  /// The interfaces are '<controller_name>/<base>/pose/x', 'pose/y', 'pose/yaw' and the body
+  /// twist 'twist/linear/x', 'twist/linear/y', 'twist/angular/z', component-major like the
+  /// reference interfaces. They point directly into the structure-of-arrays odometry buffers.
+  ///
+  /// \note As MecanumDriveController::export_state_interfaces() this is not an override, the
+  /// interfaces are for consumers in the same process only. Once exported the buffers are never
+  /// reallocated; configuring a different number of bases afterwards fails.
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  std::vector<hardware_interface::StateInterface> export_state_interfaces();
+
+  using ControllerReferenceMsg = geometry_msgs::msg::TwistStamped;
+  using TfStateMsg = tf2_msgs::msg::TFMessage;
+
+protected:
+  std::shared_ptr<mecanum_drive_batch_controller::ParamListener> param_listener_;
+  mecanum_drive_batch_controller::Params params_;
+
+  // Command joints of all bases, base-major
+  std::vector<std::string> command_joint_names_;
+
+  // Command subscribers and tf state publisher, one subscriber per base
+  std::vector<rclcpp::Subscription<ControllerReferenceMsg>::SharedPtr> ref_subscribers_;
+  std::vector<std::unique_ptr<ReferenceMailbox>> input_refs_;
+  // References used by the RT loop, owned by the RT thread only
+  std::vector<TwistReference> current_refs_;
+  // Set by update_reference_from_subscribers(), current_refs_ are checked for timeout and written
+  // to the reference interfaces at the start of update_and_write_commands()
+  bool subscriber_references_pending_ = false;
+  rclcpp::Duration ref_timeout_ = rclcpp::Duration::from_seconds(0.0);
+
+  using TfStatePublisher = realtime_tools::RealtimePublisher<TfStateMsg>;
+  rclcpp::Publisher<TfStateMsg>::SharedPtr tf_odom_s_publisher_;
+  std::unique_ptr<TfStatePublisher> rt_tf_odom_state_publisher_;
+
+  // override methods from ChainableControllerInterface
+  std::vector<hardware_interface::CommandInterface> on_export_reference_interfaces() override;
+
+  bool on_set_chained_mode(bool chained_mode) override;
+
+  MecanumKinematics kinematics_;
+
+  size_t nr_bases_ = 0;
+  size_t nr_wheels_ = 0;
+
+  /// \note Structure-of-arrays buffers, sized at configure.
+  /// reference_interfaces_ is laid out component-major: [x of all bases, y of all bases, ...].
+  /// Wheel buffers are wheel-major: wheel_velocities_[wheel * nr_bases_ + base].
+  std::vector<double> wheel_velocities_;
+  std::vector<double> wheel_commands_;
+  std::vector<double> wheel_velocities_valid_;  // 1.0 if all wheel states of a base are valid
+  std::vector<double> twist_linear_x_;
+  std::vector<double> twist_linear_y_;
+  std::vector<double> twist_angular_z_;
+  std::vector<double> pose_x_;
+  std::vector<double> pose_y_;
+  std::vector<double> pose_theta_;
+  bool state_interfaces_exported_ = false;
+
+  // buffers behind the exported state interfaces, in the order of their names
+  std::array<std::vector<double> *, 6> odometry_buffers();
+
+private:
+  // callback for topic interface
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_LOCAL
+  void reference_callback(size_t base, const std::shared_ptr<ControllerReferenceMsg> msg);
+
+  // writes current_refs_ to the reference interfaces unless they are older than the reference
+  // timeout at \p time, called from RT loop
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_LOCAL
+  void apply_subscriber_references(const rclcpp::Time & time);
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__MECANUM_DRIVE_BATCH_CONTROLLER_HPP_
@@ -15,8 +15,10 @@
 #ifndef MECANUM_DRIVE_CONTROLLER__MECANUM_DRIVE_CONTROLLER_HPP_
 #define MECANUM_DRIVE_CONTROLLER__MECANUM_DRIVE_CONTROLLER_HPP_
 
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <queue>
 #include <string>
@@ -24,26 +26,42 @@
 #include <vector>
 
 #include "controller_interface/chainable_controller_interface.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "mecanum_drive_controller/cycle_statistics.hpp"
+#include "mecanum_drive_controller/flight_recorder.hpp"
+#include "mecanum_drive_controller/kinematics_calibration.hpp"
+#include "mecanum_drive_controller/latency_estimator.hpp"
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
 #include "mecanum_drive_controller/odometry.hpp"
+#include "mecanum_drive_controller/odometry_covariance.hpp"
+#include "mecanum_drive_controller/odometry_history.hpp"
+#include "mecanum_drive_controller/publish_scheduler.hpp"
+#include "mecanum_drive_controller/reference_mailbox.hpp"
+#include "mecanum_drive_controller/slip_detector.hpp"
+#include "mecanum_drive_controller/twist_feedback.hpp"
+#include "mecanum_drive_controller/twist_limiter.hpp"
 #include "mecanum_drive_controller/visibility_control.h"
+#include "mecanum_drive_controller/wheel_pid.hpp"
 #include "mecanum_drive_controller_parameters.hpp"
 #include "rclcpp_lifecycle/node_interfaces/lifecycle_node_interface.hpp"
 #include "rclcpp_lifecycle/state.hpp"
-#include "realtime_tools/realtime_buffer.h"
 #include "realtime_tools/realtime_publisher.h"
 #include "std_srvs/srv/set_bool.hpp"
 
+#include "control_msgs/msg/dynamic_joint_state.hpp"
 #include "control_msgs/msg/mecanum_drive_controller_state.hpp"
 #include "geometry_msgs/msg/twist_stamped.hpp"
+#include "mecanum_drive_controller/srv/pose_at.hpp"
 #include "nav_msgs/msg/odometry.hpp"
 #include "tf2_msgs/msg/tf_message.hpp"
 namespace mecanum_drive_controller
 {
-// name constants for state interfaces
-static constexpr size_t NR_STATE_ITFS = 4;
+// name constants for state interfaces of the classic 4 wheel base
+// (the number of wheels is defined by 'command_joint_names' parameter)
+static constexpr size_t NR_STATE_ITFS = MecanumKinematics::NR_DEFAULT_WHEELS;
 
-// name constants for command interfaces
-static constexpr size_t NR_CMD_ITFS = 4;
+// name constants for command interfaces of the classic 4 wheel base
+static constexpr size_t NR_CMD_ITFS = MecanumKinematics::NR_DEFAULT_WHEELS;
 
 // name constants for reference interfaces
 static constexpr size_t NR_REF_ITFS = 3;
@@ -86,6 +104,35 @@ public:
   using OdomStateMsg = nav_msgs::msg::Odometry;
   using TfStateMsg = tf2_msgs::msg::TFMessage;
   using ControllerStateMsg = control_msgs::msg::MecanumDriveControllerState;
+  using DiagnosticsMsg = diagnostic_msgs::msg::DiagnosticArray;
+  using PoseAtSrv = mecanum_drive_controller::srv::PoseAt;
+  using CalibrationMsg = diagnostic_msgs::msg::DiagnosticStatus;
+  using SlipStateMsg = control_msgs::msg::DynamicJointState;
+
+  /// \brief History of the odometry, to query the pose at past times from other components
+  /// \return nullptr if 'odometry.history_size' is zero or the controller is not configured
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  std::shared_ptr<const OdometryHistory> get_odometry_history() const
+  {
+    return odometry_history_;
+  }
+
+  /// \brief Odometry and wheel estimates for controllers chained in front
+  ///
+  /// The interfaces are '<controller_name>/pose/x', 'pose/y', 'pose/yaw', the body twist
+  /// 'twist/linear/x', 'twist/linear/y', 'twist/angular/z', then
+  /// '<command_joint_names[i]>/slipping' of all wheels and '<command_joint_names[i]>/saturated'
+  /// of all wheels (1.0 if set, 0.0 otherwise). They point into one contiguous array written in
+  /// each control cycle, so a consumer in the same process reads the estimates of the current
+  /// cycle without a topic.
+  ///
+  /// \note This is not an override: the controller manager of ROS 2 Humble has no state
+  /// interfaces of controllers, the interfaces are for consumers in the same process only. The
+  /// array is sized at the first configure and never reallocated afterwards, so the interfaces
+  /// stay valid when the controller is configured again; configuring a different number of wheels
+  /// after the export fails.
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_PUBLIC
+  std::vector<hardware_interface::StateInterface> export_state_interfaces();
 
 protected:
   std::shared_ptr<mecanum_drive_controller::ParamListener> param_listener_;
@@ -100,13 +147,28 @@ protected:
 
   // Command subscribers and Controller State, odom state, tf state publishers
   rclcpp::Subscription<ControllerReferenceMsg>::SharedPtr ref_subscriber_ = nullptr;
-  realtime_tools::RealtimeBuffer<std::shared_ptr<ControllerReferenceMsg>> input_ref_;
+  // Latest reference handed from the subscriber callback to the RT loop
+  ReferenceMailbox input_ref_;
+  // Reference used by the RT loop, owned by the RT thread only
+  TwistReference current_ref_;
+  // Set by update_reference_from_subscribers(), current_ref_ is checked for timeout and written
+  // to the reference interfaces at the start of update_and_write_commands()
+  bool subscriber_reference_pending_ = false;
+  // Deadline events of the reference subscription, counted by the event callback and compared
+  // with the count handled by the RT loop
+  std::atomic<uint64_t> reference_deadline_misses_{0};
+  uint64_t handled_reference_deadline_misses_ = 0;
+  bool reference_deadline_missed_ = false;
   rclcpp::Duration ref_timeout_ = rclcpp::Duration::from_seconds(0.0);
 
   using OdomStatePublisher = realtime_tools::RealtimePublisher<OdomStateMsg>;
   rclcpp::Publisher<OdomStateMsg>::SharedPtr odom_s_publisher_;
   std::unique_ptr<OdomStatePublisher> rt_odom_state_publisher_;
 
+  // Odometry extrapolated by the transport latency of the references, see latency_compensation
+  rclcpp::Publisher<OdomStateMsg>::SharedPtr predicted_odom_s_publisher_;
+  std::unique_ptr<OdomStatePublisher> rt_predicted_odom_state_publisher_;
+
   using TfStatePublisher = realtime_tools::RealtimePublisher<TfStateMsg>;
   rclcpp::Publisher<TfStateMsg>::SharedPtr tf_odom_s_publisher_;
   std::unique_ptr<TfStatePublisher> rt_tf_odom_state_publisher_;
@@ -115,21 +177,121 @@ protected:
   rclcpp::Publisher<ControllerStateMsg>::SharedPtr controller_s_publisher_;
   std::unique_ptr<ControllerStatePublisher> controller_state_publisher_;
 
+  // Decide in which control cycles the topics are published
+  PublishScheduler odom_publish_scheduler_;
+  PublishScheduler tf_publish_scheduler_;
+  PublishScheduler state_publish_scheduler_;
+  // Wheels velocities and references of the last published state, sized at configure
+  std::vector<double> last_published_state_;
+
+  // Cycle time histograms and event counters, published at a low rate on /diagnostics
+  CycleStatistics cycle_statistics_;
+  PublishScheduler diagnostics_publish_scheduler_;
+  using DiagnosticsPublisher = realtime_tools::RealtimePublisher<DiagnosticsMsg>;
+  rclcpp::Publisher<DiagnosticsMsg>::SharedPtr diagnostics_s_publisher_;
+  std::unique_ptr<DiagnosticsPublisher> diagnostics_publisher_;
+
+  // Record of every control cycle in a memory mapped file, the values of the record being written
+  // are sized at configure
+  FlightRecorder flight_recorder_;
+  std::vector<double> flight_record_;
+
+  // Transport latency of the stamped topics, measured from header stamp to reception
+  bool latency_compensation_enabled_ = false;
+  LatencyEstimator reference_latency_;
+  LatencyEstimator measurement_latency_;
+  int64_t max_prediction_ns_ = 0;
+
+  // Velocity, acceleration and jerk limits of the reference twist and wheel speed limit, applied
+  // before IK
+  TwistLimiter twist_limiter_;
+
+  // Feedback of the body twist estimated by FK, corrects the reference twist before IK
+  bool twist_feedback_enabled_ = false;
+  TwistFeedback twist_feedback_;
+
+  // Closed-loop wheel control, PID per wheel with the IK wheel velocities as references and
+  // outputs sized at configure
+  bool wheel_pid_enabled_ = false;
+  WheelPidBank wheel_pid_;
+  std::vector<double> wheel_pid_outputs_;
+
+  // Slip detection out of the FK residual, metrics per wheel published on ~/slip_state
+  bool slip_detection_enabled_ = false;
+  SlipDetector slip_detector_;
+  PublishScheduler slip_publish_scheduler_;
+  using SlipStatePublisher = realtime_tools::RealtimePublisher<SlipStateMsg>;
+  rclcpp::Publisher<SlipStateMsg>::SharedPtr slip_s_publisher_;
+  std::unique_ptr<SlipStatePublisher> slip_publisher_;
+
+  // Online calibration of wheels radius and wheelbase against an externally measured twist
+  bool calibration_enabled_ = false;
+  KinematicsCalibration calibration_;
+  rclcpp::Subscription<ControllerReferenceMsg>::SharedPtr calibration_subscriber_;
+  RealtimeMailbox<TwistReference> calibration_measurement_;
+  int64_t calibration_timeout_ns_ = 0;
+  PublishScheduler calibration_publish_scheduler_;
+  using CalibrationPublisher = realtime_tools::RealtimePublisher<CalibrationMsg>;
+  rclcpp::Publisher<CalibrationMsg>::SharedPtr calibration_s_publisher_;
+  std::unique_ptr<CalibrationPublisher> calibration_publisher_;
+
   // override methods from ChainableControllerInterface
   std::vector<hardware_interface::CommandInterface> on_export_reference_interfaces() override;
 
   bool on_set_chained_mode(bool chained_mode) override;
 
   Odometry odometry_;
+  MecanumKinematics kinematics_;
+  // Covariances of the published odometry, propagated in the RT loop if
+  // 'odometry.covariance.dynamic' is set
+  bool dynamic_covariance_ = false;
+  OdometryCovariance odometry_covariance_;
+
+  // Odometry of the last control cycles, written by the RT loop
+  std::shared_ptr<OdometryHistory> odometry_history_;
+  rclcpp::Service<PoseAtSrv>::SharedPtr pose_at_service_;
+
+  // Wheels velocities read from state interfaces and computed by IK, sized at configure
+  std::vector<double> wheel_velocities_;
+  std::vector<double> wheel_commands_;
+  // Body twist of the base frame computed by FK
+  MecanumKinematics::Twist body_twist_;
+  // Values behind the interfaces of export_state_interfaces(), in their order, sized at
+  // configure until the interfaces are exported
+  std::vector<double> exported_state_values_;
+  bool state_interfaces_exported_ = false;
 
 private:
+  // fills the preallocated diagnostics message from cycle_statistics_, called from RT loop
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_LOCAL
+  void fill_diagnostics(DiagnosticsMsg & msg);
+
+  // writes the state of the control cycle to the flight recorder, called from RT loop
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_LOCAL
+  void record_cycle(const rclcpp::Time & time);
+
+  // fills the preallocated slip state message from slip_detector_, called from RT loop
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_LOCAL
+  void fill_slip_state(SlipStateMsg & msg);
+
+  // fills the preallocated calibration message from calibration_, called from RT loop
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_LOCAL
+  void fill_calibration(CalibrationMsg & msg);
+
+  // writes current_ref_ to the reference interfaces unless it is older than the reference timeout
+  // at \p time, called from RT loop
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_LOCAL
+  void apply_subscriber_reference(const rclcpp::Time & time);
+
   // callback for topic interface
   MECANUM_DRIVE_CONTROLLER__VISIBILITY_LOCAL
   void reference_callback(const std::shared_ptr<ControllerReferenceMsg> msg);
 
-  double velocity_in_center_frame_linear_x_;   // [m/s]
-  double velocity_in_center_frame_linear_y_;   // [m/s]
-  double velocity_in_center_frame_angular_z_;  // [rad/s]
+  // callback of the service querying the odometry at a past time
+  MECANUM_DRIVE_CONTROLLER__VISIBILITY_LOCAL
+  void pose_at_callback(
+    const std::shared_ptr<PoseAtSrv::Request> request,
+    std::shared_ptr<PoseAtSrv::Response> response);
 };
 
 }  // namespace mecanum_drive_controller
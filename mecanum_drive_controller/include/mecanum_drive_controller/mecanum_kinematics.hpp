@@ -0,0 +1,175 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__MECANUM_KINEMATICS_HPP_
+#define MECANUM_DRIVE_CONTROLLER__MECANUM_KINEMATICS_HPP_
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace mecanum_drive_controller
+{
+/// \brief Constant kinematic model of a mecanum (or omni) base with an arbitrary number of wheels.
+///
+/// The inverse (body twist -> wheel velocities) Jacobian and its least-squares pseudo-inverse
+/// (wheel velocities -> body twist) are built once from the wheels geometry. Both already contain
+/// the rotation and lever-arm terms of the base frame offset (wrt. the center frame), so
+/// evaluating them in the control loop is a single matrix-vector product without trigonometric
+/// functions, divisions or allocations.
+class MecanumKinematics
+{
+public:
+  /// Number of wheels of the classic 4 wheel mecanum base.
+  /// Wheel order: front_left, back_left, back_right, front_right.
+  static constexpr size_t NR_DEFAULT_WHEELS = 4;
+  static constexpr size_t NR_TWIST_COMPONENTS = 3;
+
+  using Twist = std::array<double, NR_TWIST_COMPONENTS>;
+  /// One row per twist component
+  using ForwardMatrix = std::array<std::vector<double>, NR_TWIST_COMPONENTS>;
+
+  /// Mounting of a single wheel, expressed in the center frame
+  struct WheelGeometry
+  {
+    double position_x;    // [m]
+    double position_y;    // [m]
+    double roller_angle;  // angle between the rollers' axes and the wheel's axis [rad]
+    double radius;        // [m]
+  };
+
+  MecanumKinematics();
+
+  /// \brief Builds the model of the classic 4 wheel mecanum base
+  /// \param sum_of_robot_center_projection_on_X_Y_axis Wheels geometric param (lx + ly) [m]
+  /// \param wheels_radius Wheels radius [m]
+  /// \param base_frame_offset Offset of the base frame wrt. the center frame [x, y, theta]
+  /// \return false if the resulting model is singular
+  bool configure(
+    double sum_of_robot_center_projection_on_X_Y_axis, double wheels_radius,
+    const Twist & base_frame_offset);
+
+  /// \brief Builds the model out of the geometry of each wheel
+  /// \param wheels Mounting of the wheels, in the order of the wheel velocities
+  /// \param base_frame_offset Offset of the base frame wrt. the center frame [x, y, theta]
+  /// \return false if the wheels do not span the planar twist space (e.g., less than 3 wheels)
+  bool configure(const std::vector<WheelGeometry> & wheels, const Twist & base_frame_offset);
+
+  /// \brief Changes the base frame offset without changing the wheels geometry
+  /// \return false if the resulting model is singular
+  bool setBaseFrameOffset(const Twist & base_frame_offset);
+
+  /// \brief Sets the weight of a wheel in the FK of forwardDownweighted(), e.g., of a slipping one
+  /// \param weight In [0, 1], 0 ignores the wheel, 1 is the same as forward()
+  /// \return false if the resulting model is singular
+  bool setDownweightedWheelWeight(double weight);
+
+  /// \return number of wheels of the model
+  size_t size() const { return ik_.size(); }
+
+  /// \return inverse kinematics matrix, one row per wheel
+  const std::vector<Twist> & getInverseMatrix() const { return ik_; }
+
+  /// \return forward kinematics matrix, one row per twist component
+  const ForwardMatrix & getForwardMatrix() const { return fk_; }
+
+  /// \brief Computes wheel velocities [rad/s] out of a body twist expressed in the base frame
+  /// \param wheel_velocities Output, has to be presized to size()
+  inline void inverse(const Twist & twist, std::vector<double> & wheel_velocities) const
+  {
+    for (size_t i = 0; i < ik_.size(); ++i)
+    {
+      wheel_velocities[i] = ik_[i][0] * twist[0] + ik_[i][1] * twist[1] + ik_[i][2] * twist[2];
+    }
+  }
+
+  /// \brief Computes the body twist expressed in the base frame out of wheel velocities [rad/s]
+  /// using the least-squares solution in case of redundant wheels.
+  inline void forward(const std::vector<double> & wheel_velocities, Twist & twist) const
+  {
+    for (size_t i = 0; i < NR_TWIST_COMPONENTS; ++i)
+    {
+      const auto & fk_row = fk_[i];
+      double value = 0.0;
+      for (size_t j = 0; j < fk_row.size(); ++j)
+      {
+        value += fk_row[j] * wheel_velocities[j];
+      }
+      twist[i] = value;
+    }
+  }
+
+  /// \brief Computes the body twist like forward(), but with the wheel \p wheel weighted by the
+  /// weight set with setDownweightedWheelWeight() in the least-squares solution
+  inline void forwardDownweighted(
+    const std::vector<double> & wheel_velocities, size_t wheel, Twist & twist) const
+  {
+    const auto & fk = downweighted_fk_[wheel];
+    for (size_t i = 0; i < NR_TWIST_COMPONENTS; ++i)
+    {
+      double value = 0.0;
+      for (size_t j = 0; j < fk[i].size(); ++j)
+      {
+        value += fk[i][j] * wheel_velocities[j];
+      }
+      twist[i] = value;
+    }
+  }
+
+  /// \brief Computes the wheel velocities not explained by the body twist, ω - IK(twist).
+  ///
+  /// With the twist of forward(), the residual is the projection of the wheel velocities onto the
+  /// space the wheels of a rigid base cannot produce (one dimension for 4 wheels), so it is zero
+  /// without slip and kinematic errors.
+  /// \param residuals Output, has to be presized to size()
+  /// \return Euclidean norm of the residuals [rad/s]
+  inline double residual(
+    const std::vector<double> & wheel_velocities, const Twist & twist,
+    std::vector<double> & residuals) const
+  {
+    double squared_norm = 0.0;
+    for (size_t i = 0; i < ik_.size(); ++i)
+    {
+      residuals[i] = wheel_velocities[i] -
+                     (ik_[i][0] * twist[0] + ik_[i][1] * twist[1] + ik_[i][2] * twist[2]);
+      squared_norm += residuals[i] * residuals[i];
+    }
+    return std::sqrt(squared_norm);
+  }
+
+private:
+  /// Builds IK and FK out of the wheels Jacobian at the center frame
+  bool build();
+
+  /// Builds the weighted least-squares FK, \return false if it is singular
+  bool buildForward(const std::vector<double> & weights, ForwardMatrix & fk) const;
+
+  /// Jacobian of the wheels at the center frame (size() x NR_TWIST_COMPONENTS)
+  std::vector<Twist> center_ik_;
+  /// Offset of the base frame wrt. the center frame [x, y, theta]
+  Twist base_frame_offset_;
+
+  /// Inverse kinematics matrix (size() x NR_TWIST_COMPONENTS)
+  std::vector<Twist> ik_;
+  /// Forward kinematics matrix (NR_TWIST_COMPONENTS x size())
+  ForwardMatrix fk_;
+  /// Forward kinematics matrix with each wheel downweighted, one per wheel
+  std::vector<ForwardMatrix> downweighted_fk_;
+  double downweighted_wheel_weight_ = 0.0;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__MECANUM_KINEMATICS_HPP_
@@ -15,11 +15,15 @@
 #ifndef MECANUM_DRIVE_CONTROLLER__ODOMETRY_HPP_
 #define MECANUM_DRIVE_CONTROLLER__ODOMETRY_HPP_
 
+#include <array>
+#include <vector>
+
 #include "geometry_msgs/msg/twist.hpp"
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+#include "mecanum_drive_controller/odometry_integration_kernel.hpp"
+#include "mecanum_drive_controller/twist_filter.hpp"
 #include "realtime_tools/realtime_buffer.h"
 #include "realtime_tools/realtime_publisher.h"
-// #include "rcpputils/rolling_mean_accumulator.hpp"
-#include "rcppmath/rolling_mean_accumulator.hpp"
 
 #define PLANAR_POINT_DIM 3
 
@@ -43,32 +47,35 @@ public:
   void init(const rclcpp::Time & time, std::array<double, PLANAR_POINT_DIM> base_frame_offset);
 
   /// \brief Updates the odometry class with latest wheels position
-  /// \param wheel_front_left_vel  Wheel velocity [rad/s]
-  /// \param wheel_back_left_vel  Wheel velocity [rad/s]
-  /// \param wheel_back_right_vel  Wheel velocity [rad/s]
-  /// \param wheel_front_right_vel  Wheel velocity [rad/s]
-  /// \param time      Current time
+  /// \param wheel_velocities  Wheels velocities [rad/s], in the order of the kinematic model
+  /// \param dt      Time since the last update [s]
+  /// \return true if the odometry is actually updated
+  bool update(const std::vector<double> & wheel_velocities, const double dt);
+
+  /// \brief Updates the odometry class with the body twist of the base frame
+  ///
+  /// The pose is integrated from the raw twist, the twist returned by getVx(), getVy() and
+  /// getWz() is filtered by the twist filter.
+  /// \param linear_x  Body velocity along x [m/s]
+  /// \param linear_y  Body velocity along y [m/s]
+  /// \param angular_z Body angular velocity [rad/s]
+  /// \param dt        Time since the last update [s]
   /// \return true if the odometry is actually updated
-  bool update(
-    double wheel_front_left_vel, double wheel_back_left_vel, double wheel_back_right_vel,
-    double wheel_front_right_vel, const double dt);
+  bool updateFromVelocity(
+    const double linear_x, const double linear_y, const double angular_z, const double dt);
 
   /// \return position (x component) [m]
-  double getX() const { return position_x_in_base_frame_; }
+  double getX() const { return integration_kernel_.getX(); }
   /// \return position (y component) [m]
-  double getY() const { return position_y_in_base_frame_; }
+  double getY() const { return integration_kernel_.getY(); }
   /// \return orientation (z component) [m]
-  double getRz() const { return orientation_z_in_base_frame_; }
-  /// \return body velocity of the base frame (linear x component) [m/s]
-  double getVx() const { return velocity_in_base_frame_linear_x; }
-  /// \return body velocity of the base frame (linear y component) [m/s]
-  double getVy() const { return velocity_in_base_frame_linear_y; }
-  /// \return body velocity of the base frame (angular z component) [m/s]
-  double getWz() const
-  {
-    return velocity_in_base_frame_angular_z;
-    ;
-  }
+  double getRz() const { return integration_kernel_.getRz(); }
+  /// \return filtered body velocity of the base frame (linear x component) [m/s]
+  double getVx() const { return twist_filter_.output()[0]; }
+  /// \return filtered body velocity of the base frame (linear y component) [m/s]
+  double getVy() const { return twist_filter_.output()[1]; }
+  /// \return filtered body velocity of the base frame (angular z component) [m/s]
+  double getWz() const { return twist_filter_.output()[2]; }
 
   /// \brief Sets the wheels parameters: mecanum geometric param and radius
   /// \param sum_of_robot_center_projection_on_X_Y_axis Wheels geometric param
@@ -76,23 +83,27 @@ public:
   /// \param wheels_radius  Wheels radius [m]
   void setWheelsParams(double sum_of_robot_center_projection_on_X_Y_axis, double wheels_radius);
 
+  /// \brief Sets the geometry of each wheel, used for bases with an arbitrary number of wheels
+  /// \param wheels Mounting of the wheels, in the order of the wheels velocities
+  /// \return false if the wheels do not span the planar twist space
+  bool setWheelsGeometry(const std::vector<MecanumKinematics::WheelGeometry> & wheels);
+
+  /// \brief Sets the filter of the twist returned by getVx(), getVy() and getWz() (not RT safe)
+  void setTwistFilter(const TwistFilterConfig & config) { twist_filter_.configure(config); }
+
+  /// \brief Sets the method integrating the body twist into the pose
+  void setIntegrationMethod(IntegrationMethod method) { integration_method_ = method; }
+
+  /// \return kinematic model used by update(), FK gives the body twist of the base frame
+  const MecanumKinematics & getKinematics() const { return kinematics_; }
+
 private:
-  using RollingMeanAccumulator = rcppmath::RollingMeanAccumulator<double>;
   /// Current timestamp:
   rclcpp::Time timestamp_;
 
   /// Reference frame (wrt to center frame). [x, y, theta]
   std::array<double, PLANAR_POINT_DIM> base_frame_offset_;
 
-  /// Current pose:
-  double position_x_in_base_frame_;     // [m]
-  double position_y_in_base_frame_;     // [m]
-  double orientation_z_in_base_frame_;  // [rad]
-
-  double velocity_in_base_frame_linear_x;   // [m/s]
-  double velocity_in_base_frame_linear_y;   // [m/s]
-  double velocity_in_base_frame_angular_z;  // [rad/s]
-
   /// Wheels kinematic parameters [m]:
   /// lx and ly represent the distance from the robot's center to the wheels
   /// projected on the x and y axis with origin at robots center respectively,
@@ -100,13 +111,16 @@ private:
   double sum_of_robot_center_projection_on_X_Y_axis_;
   double wheels_radius_;  // [m]
 
-  
+  /// Constant kinematic model, rebuilt when wheels params or base frame offset change
+  MecanumKinematics kinematics_;
+
   // void resetOdometry();
   void resetAccumulators();
-  size_t velocity_rolling_window_size_ = 10;
-  RollingMeanAccumulator linear_x_accumulator_;
-  RollingMeanAccumulator linear_y_accumulator_;
-  RollingMeanAccumulator angular_accumulator_;
+  /// Current pose, integrated from the raw twist
+  OdometryIntegrationKernel integration_kernel_;
+  /// Filter of the published twist
+  TwistFilter twist_filter_;
+  IntegrationMethod integration_method_ = IntegrationMethod::EULER;
 };
 
 }  // namespace mecanum_drive_controller
@@ -0,0 +1,169 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__ODOMETRY_COVARIANCE_HPP_
+#define MECANUM_DRIVE_CONTROLLER__ODOMETRY_COVARIANCE_HPP_
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+
+namespace mecanum_drive_controller
+{
+/// \brief Covariance of the planar odometry pose [x, y, theta], grown with the motion.
+///
+/// Each update propagates the covariance through the linearized integration of the body twist,
+///
+///   P = F P F^T + Q,   F = [1 0 -dy; 0 1 dx; 0 0 1],
+///
+/// where [dx, dy] is the position increment in the odometry frame. The process noise Q is
+/// diagonal: the position variance grows by 'linear' per traveled distance, the orientation
+/// variance by 'angular' per rotated angle plus 'linear_to_angular' per traveled distance, all
+/// multiplied by 'slip_factor' in cycles with a slipping wheel. The twist variances are the
+/// configured ones plus the square of 'twist_speed' times the RMS wheel velocity.
+///
+/// The state is a fixed 3x3 matrix, an update is a few multiplications without allocation.
+class OdometryCovariance
+{
+public:
+  using Matrix3 = std::array<std::array<double, 3>, 3>;
+  using Covariance6 = std::array<double, 36>;
+
+  struct Coefficients
+  {
+    double linear = 0.0;             // [m^2/m]
+    double angular = 0.0;            // [rad^2/rad]
+    double linear_to_angular = 0.0;  // [rad^2/m]
+    double slip_factor = 1.0;
+    double twist_speed = 0.0;  // standard deviation of the twist per RMS wheel velocity [1/rad]
+  };
+
+  /// \param pose_variance Initial variances of [x, y, theta]
+  /// \param twist_variance Variances of [vx, vy, wz] at standstill
+  void configure(
+    const Coefficients & coefficients, const std::array<double, 3> & pose_variance,
+    const std::array<double, 3> & twist_variance)
+  {
+    coefficients_ = coefficients;
+    initial_pose_variance_ = pose_variance;
+    base_twist_variance_ = twist_variance;
+    reset();
+  }
+
+  /// \brief Restarts from the initial pose variances
+  void reset()
+  {
+    for (size_t i = 0; i < 3; ++i)
+    {
+      pose_[i].fill(0.0);
+      pose_[i][i] = initial_pose_variance_[i];
+    }
+    twist_ = base_twist_variance_;
+  }
+
+  /// \brief Propagates the pose covariance over one integration step (RT safe)
+  /// \param twist Body twist integrated in this step [vx, vy, wz]
+  /// \param heading Angle rotating the body twist into the odometry frame at the start of the
+  ///   step, i.e., the orientation minus the orientation of the base frame offset [rad]
+  /// \param dt Duration of the step [s]
+  /// \param slipping True if a wheel slips in this step
+  void update(const MecanumKinematics::Twist & twist, double heading, double dt, bool slipping)
+  {
+    const double body_x = twist[0] * dt;
+    const double body_y = twist[1] * dt;
+    const double rotation = std::abs(twist[2] * dt);
+    const double c = std::cos(heading);
+    const double s = std::sin(heading);
+    // Jacobian of the position with respect to the heading
+    const double a = -(s * body_x + c * body_y);
+    const double b = c * body_x - s * body_y;
+
+    // P = F P F^T, only the upper triangle is computed
+    const double p02 = pose_[0][2];
+    const double p12 = pose_[1][2];
+    const double p22 = pose_[2][2];
+    pose_[0][0] += 2.0 * a * p02 + a * a * p22;
+    pose_[0][1] += a * p12 + b * p02 + a * b * p22;
+    pose_[1][1] += 2.0 * b * p12 + b * b * p22;
+    pose_[0][2] += a * p22;
+    pose_[1][2] += b * p22;
+
+    // + Q
+    const double distance = std::hypot(body_x, body_y);
+    const double factor = slipping ? coefficients_.slip_factor : 1.0;
+    const double linear_noise = factor * coefficients_.linear * distance;
+    pose_[0][0] += linear_noise;
+    pose_[1][1] += linear_noise;
+    pose_[2][2] += factor * (coefficients_.angular * rotation +
+                             coefficients_.linear_to_angular * distance);
+
+    pose_[1][0] = pose_[0][1];
+    pose_[2][0] = pose_[0][2];
+    pose_[2][1] = pose_[1][2];
+  }
+
+  /// \brief Scales the twist variances with the wheel velocities (RT safe)
+  /// \param rms_wheel_velocity RMS of the wheel velocities [rad/s]
+  void updateTwist(double rms_wheel_velocity)
+  {
+    const double deviation = coefficients_.twist_speed * rms_wheel_velocity;
+    for (size_t i = 0; i < 3; ++i)
+    {
+      twist_[i] = base_twist_variance_[i] + deviation * deviation;
+    }
+  }
+
+  /// \return covariance of [x, y, theta]
+  const Matrix3 & poseCovariance() const { return pose_; }
+
+  /// \return variances of [vx, vy, wz]
+  const std::array<double, 3> & twistVariance() const { return twist_; }
+
+  /// \brief Writes the planar entries (x, y, yaw) of a row-major 6x6 pose covariance
+  void writePose(Covariance6 & covariance) const
+  {
+    for (size_t i = 0; i < 3; ++i)
+    {
+      for (size_t j = 0; j < 3; ++j)
+      {
+        covariance[6 * PLANAR_INDICES[i] + PLANAR_INDICES[j]] = pose_[i][j];
+      }
+    }
+  }
+
+  /// \brief Writes the planar variances (x, y, yaw) of a row-major 6x6 twist covariance
+  void writeTwist(Covariance6 & covariance) const
+  {
+    for (size_t i = 0; i < 3; ++i)
+    {
+      covariance[7 * PLANAR_INDICES[i]] = twist_[i];
+    }
+  }
+
+private:
+  // indices of x, y and yaw in the 6 dimensions of the covariance messages
+  static constexpr std::array<size_t, 3> PLANAR_INDICES = {0, 1, 5};
+
+  Coefficients coefficients_;
+  std::array<double, 3> initial_pose_variance_ = {0.0, 0.0, 0.0};
+  std::array<double, 3> base_twist_variance_ = {0.0, 0.0, 0.0};
+  Matrix3 pose_ = {};
+  std::array<double, 3> twist_ = {0.0, 0.0, 0.0};
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__ODOMETRY_COVARIANCE_HPP_
@@ -0,0 +1,236 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__ODOMETRY_HISTORY_HPP_
+#define MECANUM_DRIVE_CONTROLLER__ODOMETRY_HISTORY_HPP_
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace mecanum_drive_controller
+{
+/// \brief Odometry at one control cycle
+struct OdometrySample
+{
+  int64_t stamp_ns = 0;
+  double x = 0.0;          // [m]
+  double y = 0.0;          // [m]
+  double theta = 0.0;      // [rad]
+  double linear_x = 0.0;   // body velocity [m/s]
+  double linear_y = 0.0;   // body velocity [m/s]
+  double angular_z = 0.0;  // body velocity [rad/s]
+};
+
+/// \brief History of the odometry written by the RT loop and queried from other threads.
+///
+/// Fixed-capacity ring buffer with a single writer and any number of readers. Each slot is
+/// guarded by a sequence number (seqlock) which also encodes the index of the sample it holds, so
+/// readers detect samples overwritten while they search and retry; neither side ever blocks.
+class OdometryHistory
+{
+public:
+  /// \param capacity Number of samples kept (allocates, not RT safe)
+  explicit OdometryHistory(size_t capacity)
+  : capacity_(capacity > 0 ? capacity : 1), slots_(new Slot[capacity_])
+  {
+  }
+
+  size_t capacity() const { return capacity_; }
+
+  /// \brief Appends a sample, stamps are expected to increase (RT safe, single writer)
+  void push(const OdometrySample & sample)
+  {
+    const uint64_t index = head_.load(std::memory_order_relaxed);
+    Slot & slot = slots_[index % capacity_];
+    slot.version.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.stamp_ns.store(sample.stamp_ns, std::memory_order_relaxed);
+    const double values[NR_VALUES] = {sample.x,        sample.y,        sample.theta,
+                                      sample.linear_x, sample.linear_y, sample.angular_z};
+    for (size_t i = 0; i < NR_VALUES; ++i)
+    {
+      slot.values[i].store(values[i], std::memory_order_relaxed);
+    }
+    slot.version.store(2 * index + 2, std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+  }
+
+  /// \brief Drops all samples (not thread safe with concurrent push())
+  void clear() { head_.store(0, std::memory_order_release); }
+
+  /// \brief Gets the newest sample (thread safe)
+  /// \return false if the history is empty
+  bool latest(OdometrySample & sample) const
+  {
+    for (size_t attempt = 0; attempt < MAX_ATTEMPTS; ++attempt)
+    {
+      const uint64_t head = head_.load(std::memory_order_acquire);
+      if (head == 0)
+      {
+        return false;
+      }
+      if (read(head - 1, sample))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// \brief Odometry at \p stamp_ns, interpolated between the two samples around it (thread safe)
+  ///
+  /// The pose is interpolated along the SE(2) geodesic (constant twist between the samples), the
+  /// velocities linearly.
+  /// \return false if \p stamp_ns is outside of the history
+  bool poseAt(int64_t stamp_ns, OdometrySample & sample) const
+  {
+    for (size_t attempt = 0; attempt < MAX_ATTEMPTS; ++attempt)
+    {
+      const uint64_t head = head_.load(std::memory_order_acquire);
+      if (head == 0)
+      {
+        return false;
+      }
+      // the oldest slot is the next to be overwritten, skip it
+      uint64_t lower = head > capacity_ ? head - capacity_ + 1 : 0;
+      uint64_t upper = head - 1;
+      OdometrySample before;
+      OdometrySample after;
+      if (!read(lower, before) || !read(upper, after))
+      {
+        continue;
+      }
+      if (stamp_ns < before.stamp_ns || stamp_ns > after.stamp_ns)
+      {
+        return false;
+      }
+      if (stamp_ns == after.stamp_ns || lower == upper)
+      {
+        sample = after;
+        return true;
+      }
+
+      // binary search of the samples with before.stamp_ns <= stamp_ns < after.stamp_ns
+      bool consistent = true;
+      while (upper - lower > 1 && consistent)
+      {
+        const uint64_t middle = lower + (upper - lower) / 2;
+        OdometrySample middle_sample;
+        consistent = read(middle, middle_sample);
+        if (consistent && middle_sample.stamp_ns <= stamp_ns)
+        {
+          lower = middle;
+          before = middle_sample;
+        }
+        else if (consistent)
+        {
+          upper = middle;
+          after = middle_sample;
+        }
+      }
+      if (consistent)
+      {
+        interpolate(before, after, stamp_ns, sample);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// \brief Interpolates the odometry between \p before and \p after
+  static void interpolate(
+    const OdometrySample & before, const OdometrySample & after, int64_t stamp_ns,
+    OdometrySample & sample)
+  {
+    const int64_t interval = after.stamp_ns - before.stamp_ns;
+    const double fraction =
+      interval > 0 ? static_cast<double>(stamp_ns - before.stamp_ns) / interval : 1.0;
+
+    // relative motion in the frame of 'before'
+    const double cos_theta = std::cos(before.theta);
+    const double sin_theta = std::sin(before.theta);
+    const double dx = after.x - before.x;
+    const double dy = after.y - before.y;
+    const double local_x = cos_theta * dx + sin_theta * dy;
+    const double local_y = -sin_theta * dx + cos_theta * dy;
+    const double rotation = after.theta - before.theta;
+
+    // the translation of exp(fraction * log(T)) is V(fraction * rotation) * V(rotation)^-1 *
+    // fraction * translation of T, where V(phi) = exp(i * phi / 2) * sinc(phi / 2) as complex
+    const double scale = fraction * sinc(0.5 * fraction * rotation) / sinc(0.5 * rotation);
+    const double angle = 0.5 * (fraction - 1.0) * rotation;
+    const double cos_angle = std::cos(angle) * scale;
+    const double sin_angle = std::sin(angle) * scale;
+    const double interpolated_x = cos_angle * local_x - sin_angle * local_y;
+    const double interpolated_y = sin_angle * local_x + cos_angle * local_y;
+
+    sample.stamp_ns = stamp_ns;
+    sample.x = before.x + cos_theta * interpolated_x - sin_theta * interpolated_y;
+    sample.y = before.y + sin_theta * interpolated_x + cos_theta * interpolated_y;
+    sample.theta = before.theta + fraction * rotation;
+    sample.linear_x = before.linear_x + fraction * (after.linear_x - before.linear_x);
+    sample.linear_y = before.linear_y + fraction * (after.linear_y - before.linear_y);
+    sample.angular_z = before.angular_z + fraction * (after.angular_z - before.angular_z);
+  }
+
+private:
+  static constexpr size_t NR_VALUES = 6;
+  // a reader retries only when the writer overwrote a sample during its search
+  static constexpr size_t MAX_ATTEMPTS = 8;
+
+  struct Slot
+  {
+    // 2 * index + 2 when the slot holds the sample 'index', odd while written
+    std::atomic<uint64_t> version{0};
+    std::atomic<int64_t> stamp_ns{0};
+    std::atomic<double> values[NR_VALUES];
+  };
+
+  /// \return false if the slot does not hold the sample \p index (anymore)
+  bool read(uint64_t index, OdometrySample & sample) const
+  {
+    const Slot & slot = slots_[index % capacity_];
+    const uint64_t version = slot.version.load(std::memory_order_acquire);
+    if (version != 2 * index + 2)
+    {
+      return false;
+    }
+    sample.stamp_ns = slot.stamp_ns.load(std::memory_order_relaxed);
+    sample.x = slot.values[0].load(std::memory_order_relaxed);
+    sample.y = slot.values[1].load(std::memory_order_relaxed);
+    sample.theta = slot.values[2].load(std::memory_order_relaxed);
+    sample.linear_x = slot.values[3].load(std::memory_order_relaxed);
+    sample.linear_y = slot.values[4].load(std::memory_order_relaxed);
+    sample.angular_z = slot.values[5].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.version.load(std::memory_order_relaxed) == version;
+  }
+
+  static double sinc(double x)
+  {
+    // Taylor series below the precision of sin(x) / x
+    return std::abs(x) < 1e-4 ? 1.0 - x * x / 6.0 : std::sin(x) / x;
+  }
+
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> head_{0};
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__ODOMETRY_HISTORY_HPP_
@@ -0,0 +1,126 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__ODOMETRY_INTEGRATION_KERNEL_HPP_
+#define MECANUM_DRIVE_CONTROLLER__ODOMETRY_INTEGRATION_KERNEL_HPP_
+
+#include <cmath>
+
+namespace mecanum_drive_controller
+{
+/// \brief Methods integrating the body velocity over one interval into the odometry frame
+enum class IntegrationMethod
+{
+  EULER,          // body velocity rotated by the orientation at the end of the interval
+  RUNGE_KUTTA_2,  // body velocity rotated by the orientation in the middle of the interval
+  EXACT           // arc of the SE(2) exponential, exact for a constant twist over the interval
+};
+
+/// Integration policies of OdometryIntegrationKernel::integrate(). Each one computes [c, s] such
+/// that the position increment is ([c, s] * vx + [-s, c] * vy) * dt, out of the orientations at
+/// the start and end of the interval.
+struct EulerIntegration
+{
+  static inline void rotation(double start, double end, double & c, double & s)
+  {
+    (void)start;
+    c = std::cos(end);
+    s = std::sin(end);
+  }
+};
+
+struct RungeKutta2Integration
+{
+  static inline void rotation(double start, double end, double & c, double & s)
+  {
+    const double middle = 0.5 * (start + end);
+    c = std::cos(middle);
+    s = std::sin(middle);
+  }
+};
+
+struct ExactIntegration
+{
+  /// exp(i * start) * (exp(i * dtheta) - 1) / (i * dtheta)
+  ///   = exp(i * middle) * sin(dtheta / 2) / (dtheta / 2)
+  static inline void rotation(double start, double end, double & c, double & s)
+  {
+    const double middle = 0.5 * (start + end);
+    const double half_increment = 0.5 * (end - start);
+    // Taylor series below the precision of sin(x) / x
+    const double sinc = std::abs(half_increment) < 1e-4
+                          ? 1.0 - half_increment * half_increment / 6.0
+                          : std::sin(half_increment) / half_increment;
+    c = std::cos(middle) * sinc;
+    s = std::sin(middle) * sinc;
+  }
+};
+
+/// \brief Integrates the planar pose out of the body twist.
+///
+/// The pose increments [x, y, theta] are accumulated into the pose, each update is a few scalar
+/// operations and the trigonometric functions of the integration policy, without allocation.
+class OdometryIntegrationKernel
+{
+public:
+  OdometryIntegrationKernel() { reset(); }
+
+  /// \brief Resets the pose
+  void reset()
+  {
+    x_ = 0.0;
+    y_ = 0.0;
+    rz_ = 0.0;
+  }
+
+  /// \brief Integrates the body twist
+  /// \tparam Method Integration policy (EulerIntegration, RungeKutta2Integration or
+  ///   ExactIntegration), the orientation is always integrated exactly
+  /// \param linear_x Body velocity along x [m/s]
+  /// \param linear_y Body velocity along y [m/s]
+  /// \param angular_z Body angular velocity [rad/s]
+  /// \param dt Integration interval [s]
+  /// \param heading_offset Offset added to the orientation when rotating the body velocity
+  ///   into the odometry frame [rad]
+  template <typename Method = EulerIntegration>
+  inline void integrate(
+    double linear_x, double linear_y, double angular_z, double dt, double heading_offset)
+  {
+    const double orientation = rz_ + angular_z * dt;
+    double cos_heading;
+    double sin_heading;
+    Method::rotation(heading_offset + rz_, heading_offset + orientation, cos_heading, sin_heading);
+
+    // [dx, dy] = ([c, s] * vx + [-s, c] * vy) * dt
+    x_ += (cos_heading * linear_x - sin_heading * linear_y) * dt;
+    y_ += (sin_heading * linear_x + cos_heading * linear_y) * dt;
+    rz_ = orientation;
+  }
+
+  /// \return position (x component) [m]
+  double getX() const { return x_; }
+  /// \return position (y component) [m]
+  double getY() const { return y_; }
+  /// \return orientation (z component) [rad]
+  double getRz() const { return rz_; }
+
+private:
+  double x_ = 0.0;
+  double y_ = 0.0;
+  double rz_ = 0.0;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__ODOMETRY_INTEGRATION_KERNEL_HPP_
@@ -0,0 +1,82 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__PUBLISH_SCHEDULER_HPP_
+#define MECANUM_DRIVE_CONTROLLER__PUBLISH_SCHEDULER_HPP_
+
+#include <cstdint>
+
+namespace mecanum_drive_controller
+{
+/// \brief Decides in which control cycles a topic is published.
+///
+/// The deadlines are phase-locked to the first publication: after publishing, the next deadline
+/// is advanced by whole periods instead of being set relative to the control cycle time. The
+/// average rate is therefore exact even if the period is not a multiple of the control period
+/// (e.g. 30 Hz out of a 1 kHz loop). Only integer nanoseconds are compared, so the check is a
+/// single comparison in the usual case.
+class PublishScheduler
+{
+public:
+  /// \param period_ns Publish period [ns], 0 to publish in every control cycle
+  void configure(int64_t period_ns)
+  {
+    period_ns_ = period_ns > 0 ? period_ns : 0;
+    reset();
+  }
+
+  /// \brief The next call of isDue() will be true
+  void reset() { next_deadline_ns_set_ = false; }
+
+  /// \return true if the topic should be published in the control cycle at \p time_ns
+  bool isDue(int64_t time_ns) const
+  {
+    // publish also if the time jumped back, e.g. simulation was reset
+    return period_ns_ == 0 || !next_deadline_ns_set_ || time_ns >= next_deadline_ns_ ||
+           time_ns < next_deadline_ns_ - period_ns_;
+  }
+
+  /// \brief Records a publication in the control cycle at \p time_ns
+  void published(int64_t time_ns)
+  {
+    if (period_ns_ == 0)
+    {
+      return;
+    }
+    if (!next_deadline_ns_set_ || time_ns < next_deadline_ns_ - period_ns_)
+    {
+      next_deadline_ns_ = time_ns + period_ns_;
+      next_deadline_ns_set_ = true;
+      return;
+    }
+    next_deadline_ns_ += period_ns_;
+    if (next_deadline_ns_ <= time_ns)
+    {
+      // deadlines were missed (publisher busy or control loop overrun), skip them in phase
+      next_deadline_ns_ += ((time_ns - next_deadline_ns_) / period_ns_ + 1) * period_ns_;
+    }
+  }
+
+  /// \return publish period [ns], 0 if published in every control cycle
+  int64_t period() const { return period_ns_; }
+
+private:
+  int64_t period_ns_ = 0;
+  int64_t next_deadline_ns_ = 0;
+  bool next_deadline_ns_set_ = false;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__PUBLISH_SCHEDULER_HPP_
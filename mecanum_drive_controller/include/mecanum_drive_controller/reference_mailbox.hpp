@@ -0,0 +1,109 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__REFERENCE_MAILBOX_HPP_
+#define MECANUM_DRIVE_CONTROLLER__REFERENCE_MAILBOX_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace mecanum_drive_controller
+{
+/// \brief Body twist reference as received on the reference topic
+struct TwistReference
+{
+  double linear_x = std::numeric_limits<double>::quiet_NaN();   // [m/s]
+  double linear_y = std::numeric_limits<double>::quiet_NaN();   // [m/s]
+  double angular_z = std::numeric_limits<double>::quiet_NaN();  // [rad/s]
+  int64_t stamp_ns = 0;                                         // [ns]
+  int64_t receive_ns = 0;  // time the subscriber received the message [ns]
+};
+
+/// \brief Lock-free single-producer single-consumer mailbox holding the latest value.
+///
+/// Triple buffer: the writer fills its own back slot and swaps it with the middle slot, the
+/// reader swaps the middle slot with its own front slot when a new value was published. Each
+/// side only touches the slot it owns, the hand-over is a single atomic exchange of the slot
+/// index. The reader never blocks the writer and never writes into memory owned by the writer.
+///
+/// \note writeFromNonRT() must be called from one thread at a time (e.g. the subscription
+/// callback), readFromRT() from the RT thread only.
+template <typename T>
+class RealtimeMailbox
+{
+  static_assert(std::is_trivially_copyable<T>::value, "Mailbox values must be trivially copyable");
+
+public:
+  explicit RealtimeMailbox(const T & value = T()) { reset(value); }
+
+  RealtimeMailbox(const RealtimeMailbox &) = delete;
+  RealtimeMailbox & operator=(const RealtimeMailbox &) = delete;
+
+  /// \brief Sets all slots to \p value and drops a pending value (not thread safe)
+  void reset(const T & value)
+  {
+    slots_.fill(value);
+    last_written_ = value;
+    back_ = 0;
+    middle_.store(1, std::memory_order_relaxed);
+    front_ = 2;
+  }
+
+  /// \brief Publishes \p value to the reader, replacing a value not taken yet
+  void writeFromNonRT(const T & value)
+  {
+    slots_[back_] = value;
+    last_written_ = value;
+    back_ = middle_.exchange(back_ | NEW_VALUE_FLAG, std::memory_order_acq_rel) & INDEX_MASK;
+  }
+
+  /// \return the last value written, for the writer side only
+  const T & readFromNonRT() const { return last_written_; }
+
+  /// \brief Takes the latest value if a new one was published since the last call
+  /// \param value Output, left untouched if there is no new value
+  /// \return true if \p value was updated
+  bool readFromRT(T & value)
+  {
+    if ((middle_.load(std::memory_order_relaxed) & NEW_VALUE_FLAG) == 0)
+    {
+      return false;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+    value = slots_[front_];
+    return true;
+  }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 0x3;
+  static constexpr uint8_t NEW_VALUE_FLAG = 0x4;
+
+  std::array<T, 3> slots_;
+  T last_written_;
+
+  // Writer slot, middle slot (with the new value flag) and reader slot, kept on separate cache
+  // lines so the writer and the reader do not share one
+  alignas(64) uint8_t back_;
+  alignas(64) std::atomic<uint8_t> middle_;
+  alignas(64) uint8_t front_;
+};
+
+using ReferenceMailbox = RealtimeMailbox<TwistReference>;
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__REFERENCE_MAILBOX_HPP_
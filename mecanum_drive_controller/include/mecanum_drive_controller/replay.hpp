@@ -0,0 +1,121 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__REPLAY_HPP_
+#define MECANUM_DRIVE_CONTROLLER__REPLAY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+#include "mecanum_drive_controller/odometry_integration_kernel.hpp"
+
+namespace mecanum_drive_controller
+{
+/// \brief Wheel data recorded by the controller, one row per control cycle
+struct WheelLog
+{
+  static constexpr size_t NR_REFERENCES = 3;
+
+  size_t nr_wheels = 0;
+  std::vector<int64_t> stamps_ns;
+  /// Wheel velocities [rad/s], nr_wheels per cycle
+  std::vector<double> wheel_states;
+  /// Wheel commands [rad/s], nr_wheels per cycle, empty if not recorded
+  std::vector<double> wheel_commands;
+  /// Reference body twist [vx, vy, wz] per cycle, empty if not recorded
+  std::vector<double> references;
+
+  size_t size() const { return stamps_ns.size(); }
+
+  /// \brief Empties the log, keeping the allocated memory for the next file
+  void clear();
+};
+
+/// \brief Loads a flight recorder file or its CSV conversion (see flight_recorder_decoder)
+///
+/// CSV files need a header line with a 'stamp_ns' and 'wheel_state_<i>' columns, the optional
+/// columns 'wheel_command_<i>' and 'reference_linear_x', 'reference_linear_y' and
+/// 'reference_angular_z' are loaded as well, other columns are ignored. A wheel index that is not
+/// a decimal number below the number of columns is an error.
+/// \param log Output, cleared first
+/// \return false if the file could not be read, \p error holds the reason
+bool loadWheelLog(const std::string & path, WheelLog & log, std::string & error);
+
+/// \brief Kinematic parameters of a replay, named as the controller parameters
+struct ReplayParameters
+{
+  double sum_of_robot_center_projection_on_X_Y_axis = 0.0;  // [m]
+  double wheels_radius = 0.0;                                // [m]
+  MecanumKinematics::Twist base_frame_offset = {0.0, 0.0, 0.0};
+  IntegrationMethod integration_method = IntegrationMethod::EULER;
+  /// Geometry of each wheel of the log, as with 'kinematics.use_wheels_geometry'. If not empty,
+  /// it replaces sum_of_robot_center_projection_on_X_Y_axis, and wheels_radius is used only for
+  /// wheels with a radius of zero.
+  std::vector<MecanumKinematics::WheelGeometry> wheels_geometry;
+};
+
+struct ReplayResult
+{
+  /// Pose at the end of the log
+  double x = 0.0;      // [m]
+  double y = 0.0;      // [m]
+  double theta = 0.0;  // [rad]
+  /// Length of the integrated path [m]
+  double path_length = 0.0;
+  /// Number of integrated cycles and of cycles skipped for NaN wheel states
+  size_t nr_integrated = 0;
+  size_t nr_skipped = 0;
+  /// RMS difference between the wheel commands computed by IK from the references and the
+  /// recorded ones [rad/s], NaN if the log has no references or commands
+  double command_rms_error = 0.0;
+};
+
+/// \brief Runs the odometry and the inverse kinematics of the controller over a log
+///
+/// Each cycle runs the kinematic core of MecanumDriveController::update_and_write_commands: FK of
+/// the wheel states, integration over the time since the previous cycle and IK of the references.
+/// The twist filter, the slip downweighting, the reference limits and the twist feedback are not
+/// replayed, so the commands match the recorded ones only if those were disabled.
+/// \return false if the parameters do not describe a valid base for the wheels of the log,
+/// \p error holds the reason
+bool replay(
+  const WheelLog & log, const ReplayParameters & parameters, ReplayResult & result,
+  std::string & error);
+
+struct ReplayFileResult
+{
+  std::string file;
+  /// Empty if the file was replayed
+  std::string error;
+  size_t nr_cycles = 0;
+  /// One result per parameter set
+  std::vector<ReplayResult> results;
+};
+
+/// \brief Replays each file with each parameter set, files are processed in parallel
+///
+/// Every file is loaded once and replayed with all parameter sets by the same worker, so the
+/// results do not depend on the number of threads.
+/// \param nr_threads Number of worker threads, 0 uses one per core
+/// \return one result per file, in the order of \p files
+std::vector<ReplayFileResult> replayFiles(
+  const std::vector<std::string> & files, const std::vector<ReplayParameters> & parameter_sets,
+  size_t nr_threads);
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__REPLAY_HPP_
@@ -0,0 +1,159 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__SLIP_DETECTOR_HPP_
+#define MECANUM_DRIVE_CONTROLLER__SLIP_DETECTOR_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+
+namespace mecanum_drive_controller
+{
+/// \brief Detects slipping wheels out of the redundancy of the wheel velocities.
+///
+/// The residual of the least-squares FK, ω - IK(FK(ω)), is zero for wheels rolling on a rigid
+/// base. A slip is flagged when its norm exceeds an absolute threshold plus a fraction of the norm
+/// of the wheel velocities. With 4 wheels the residual is one-dimensional and the same for any
+/// slipping wheel, so the wheel is isolated by the innovation ω - IK(twist of the previous cycle):
+/// the base changes its twist slowly, a slipping wheel changes its velocity abruptly.
+///
+/// The cost per cycle is fixed (a few matrix-vector products) and no memory is allocated after
+/// configure().
+class SlipDetector
+{
+public:
+  static constexpr size_t NO_WHEEL = std::numeric_limits<size_t>::max();
+
+  /// \brief Allocates the buffers (not RT safe)
+  /// \param residual_threshold Absolute residual norm above which a slip is flagged [rad/s]
+  /// \param relative_threshold Additional threshold per norm of the wheel velocities
+  /// \param downweight If true, the twist of a slipping cycle is computed by
+  /// MecanumKinematics::forwardDownweighted() for the slipping wheel
+  void configure(
+    size_t nr_wheels, double residual_threshold, double relative_threshold, bool downweight)
+  {
+    residual_threshold_ = residual_threshold;
+    relative_threshold_ = relative_threshold;
+    downweight_ = downweight;
+    residuals_.assign(nr_wheels, 0.0);
+    innovations_.assign(nr_wheels, 0.0);
+    slip_events_.assign(nr_wheels, 0);
+    reset();
+  }
+
+  /// \brief Forgets the previous twist and the slip state, keeps the event counters (RT safe)
+  ///
+  /// Also called for cycles without valid wheel velocities, so no slip of an earlier cycle is
+  /// reported for them.
+  void reset()
+  {
+    previous_twist_ = {0.0, 0.0, 0.0};
+    has_previous_twist_ = false;
+    slipping_wheel_ = NO_WHEEL;
+    residual_norm_ = 0.0;
+    std::fill(residuals_.begin(), residuals_.end(), 0.0);
+    std::fill(innovations_.begin(), innovations_.end(), 0.0);
+  }
+
+  /// \brief Computes the body twist of the wheel velocities and checks them for slip (RT safe)
+  /// \param wheel_velocities Wheel velocities [rad/s], without NaN
+  /// \param twist Output, body twist to integrate into the odometry
+  void update(
+    const MecanumKinematics & kinematics, const std::vector<double> & wheel_velocities,
+    MecanumKinematics::Twist & twist)
+  {
+    kinematics.forward(wheel_velocities, twist);
+    residual_norm_ = kinematics.residual(wheel_velocities, twist, residuals_);
+
+    double squared_speed = 0.0;
+    for (const double wheel_velocity : wheel_velocities)
+    {
+      squared_speed += wheel_velocity * wheel_velocity;
+    }
+    // without a previous twist the residual itself is the best guess (same size, no allocation)
+    if (has_previous_twist_)
+    {
+      kinematics.residual(wheel_velocities, previous_twist_, innovations_);
+    }
+    else
+    {
+      innovations_ = residuals_;
+    }
+
+    const size_t previous_slipping_wheel = slipping_wheel_;
+    slipping_wheel_ = NO_WHEEL;
+    if (residual_norm_ > residual_threshold_ + relative_threshold_ * std::sqrt(squared_speed))
+    {
+      slipping_wheel_ = 0;
+      for (size_t i = 1; i < innovations_.size(); ++i)
+      {
+        if (std::abs(innovations_[i]) > std::abs(innovations_[slipping_wheel_]))
+        {
+          slipping_wheel_ = i;
+        }
+      }
+      if (slipping_wheel_ != previous_slipping_wheel)
+      {
+        ++slip_events_[slipping_wheel_];
+      }
+      if (downweight_)
+      {
+        kinematics.forwardDownweighted(wheel_velocities, slipping_wheel_, twist);
+      }
+    }
+
+    previous_twist_ = twist;
+    has_previous_twist_ = true;
+  }
+
+  bool isSlipping() const { return slipping_wheel_ != NO_WHEEL; }
+
+  /// \return index of the slipping wheel, NO_WHEEL if none slips
+  size_t slippingWheel() const { return slipping_wheel_; }
+
+  /// \return norm of the FK residual of the last update [rad/s]
+  double residualNorm() const { return residual_norm_; }
+
+  /// \return FK residual of each wheel of the last update [rad/s]
+  const std::vector<double> & residuals() const { return residuals_; }
+
+  /// \return deviation of each wheel from the twist of the previous update [rad/s]
+  const std::vector<double> & innovations() const { return innovations_; }
+
+  /// \return number of slip events of each wheel since configure()
+  const std::vector<uint64_t> & slipEvents() const { return slip_events_; }
+
+private:
+  double residual_threshold_ = 0.0;
+  double relative_threshold_ = 0.0;
+  bool downweight_ = false;
+
+  std::vector<double> residuals_;
+  std::vector<double> innovations_;
+  std::vector<uint64_t> slip_events_;
+  MecanumKinematics::Twist previous_twist_ = {0.0, 0.0, 0.0};
+  bool has_previous_twist_ = false;
+  size_t slipping_wheel_ = NO_WHEEL;
+  double residual_norm_ = 0.0;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__SLIP_DETECTOR_HPP_
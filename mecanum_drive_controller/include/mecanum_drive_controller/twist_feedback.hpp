@@ -0,0 +1,139 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__TWIST_FEEDBACK_HPP_
+#define MECANUM_DRIVE_CONTROLLER__TWIST_FEEDBACK_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+
+namespace mecanum_drive_controller
+{
+/// \brief Gains of the feedback of one component of the body twist
+struct TwistFeedbackGains
+{
+  double p = 0.0;
+  double i = 0.0;               // [1/s]
+  double max_correction = 0.0;  // maximal absolute correction, 0 means unlimited
+};
+
+/// \brief PI feedback of the body twist, corrects the reference before the inverse kinematics.
+///
+/// For each component [vx, vy, wz] the error between the reference, after the limits of its
+/// velocity, acceleration and jerk, and the twist estimated by FK gives the correction
+///
+///   c = p * e + I,   e = reference - measured,   I += i * e * dt
+///
+/// which is clamped to 'max_correction' and added to the reference. The integral removes a
+/// persistent deviation, e.g., a base drifting sideways on a ramp. While a correction is clamped,
+/// its integral advances at most until the correction reaches the limit (anti-windup). The same
+/// holds for the scaling of the corrected twist by the wheel velocity limit, see
+/// scaleCorrection().
+///
+/// The state is one fixed-size array, a correction costs the same in every cycle.
+class TwistFeedback
+{
+public:
+  using Twist = MecanumKinematics::Twist;
+  static constexpr size_t NR_COMPONENTS = 3;
+
+  void configure(const std::array<TwistFeedbackGains, NR_COMPONENTS> & gains)
+  {
+    gains_ = gains;
+    reset();
+  }
+
+  /// \brief Clears the integral terms
+  void reset()
+  {
+    integrals_ = {0.0, 0.0, 0.0};
+    previous_integrals_ = {0.0, 0.0, 0.0};
+    correction_ = {0.0, 0.0, 0.0};
+  }
+
+  /// \brief Adds the correction to \p reference in place (RT safe)
+  /// \param measured Body twist estimated by FK in this cycle
+  /// \param dt Time since the last call [s]
+  void correct(Twist & reference, const Twist & measured, double dt)
+  {
+    previous_integrals_ = integrals_;
+    for (size_t i = 0; i < NR_COMPONENTS; ++i)
+    {
+      const auto & gains = gains_[i];
+      const double error = reference[i] - measured[i];
+      const double proportional = gains.p * error;
+      double integral = integrals_[i] + gains.i * error * dt;
+      double correction = proportional + integral;
+      if (gains.max_correction > 0.0)
+      {
+        // the integral advances at most until the correction reaches the limit
+        if (correction > gains.max_correction && integral > integrals_[i])
+        {
+          integral = std::max(integrals_[i], gains.max_correction - proportional);
+        }
+        else if (correction < -gains.max_correction && integral < integrals_[i])
+        {
+          integral = std::min(integrals_[i], -gains.max_correction - proportional);
+        }
+        correction =
+          std::clamp(proportional + integral, -gains.max_correction, gains.max_correction);
+      }
+      integrals_[i] = integral;
+      correction_[i] = correction;
+      reference[i] += correction;
+    }
+  }
+
+  /// \brief Anti-windup for a corrected twist that was scaled down after correct(), e.g., by the
+  /// wheel velocity limit (RT safe)
+  ///
+  /// The integral step of the last correct() is undone where it increased the magnitude of the
+  /// correction, and the correction is scaled as it was applied.
+  /// \param scale Factor the corrected twist was scaled with, 1 if it was applied unchanged
+  void scaleCorrection(double scale)
+  {
+    if (scale >= 1.0)
+    {
+      return;
+    }
+    for (size_t i = 0; i < NR_COMPONENTS; ++i)
+    {
+      if ((integrals_[i] - previous_integrals_[i]) * correction_[i] > 0.0)
+      {
+        integrals_[i] = previous_integrals_[i];
+      }
+      correction_[i] *= scale;
+    }
+  }
+
+  /// \return correction added by the last call of correct()
+  const Twist & getCorrection() const { return correction_; }
+
+  /// \return integral terms of [vx, vy, wz]
+  const Twist & getIntegrals() const { return integrals_; }
+
+private:
+  std::array<TwistFeedbackGains, NR_COMPONENTS> gains_ = {};
+  Twist integrals_ = {0.0, 0.0, 0.0};
+  // integral terms before the last call of correct()
+  Twist previous_integrals_ = {0.0, 0.0, 0.0};
+  Twist correction_ = {0.0, 0.0, 0.0};
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__TWIST_FEEDBACK_HPP_
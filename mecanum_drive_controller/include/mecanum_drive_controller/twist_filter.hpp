@@ -0,0 +1,242 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__TWIST_FILTER_HPP_
+#define MECANUM_DRIVE_CONTROLLER__TWIST_FILTER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace mecanum_drive_controller
+{
+/// \brief Low-pass filters applicable to the body twist
+enum class TwistFilterType
+{
+  NONE,         // output is the input
+  MEAN,         // mean over a fixed window of samples
+  EXPONENTIAL,  // first order, y += alpha * (x - y)
+  BUTTERWORTH,  // second order Butterworth with the given cutoff frequency
+  ONE_EURO      // first order with a cutoff increasing with the rate of change (one-euro filter)
+};
+
+struct TwistFilterConfig
+{
+  TwistFilterType type = TwistFilterType::NONE;
+  /// Number of samples of the MEAN filter
+  size_t window_size = 1;
+  /// Smoothing factor of the EXPONENTIAL filter, in (0, 1], 1 means no filtering
+  double exponential_alpha = 1.0;
+  /// Cutoff frequency of the BUTTERWORTH filter, minimal cutoff of the ONE_EURO filter [Hz]
+  double cutoff_frequency = 10.0;
+  /// Increase of the ONE_EURO cutoff per unit of rate of change of the input [Hz * s / unit]
+  double one_euro_beta = 0.0;
+  /// Cutoff frequency of the rate of change estimated by the ONE_EURO filter [Hz]
+  double one_euro_derivative_cutoff = 1.0;
+};
+
+/// \brief Filters the three components of the body twist [vx, vy, wz].
+///
+/// The state, including the ring buffer of the MEAN filter, is allocated in configure(); filter()
+/// does not allocate and its cost does not depend on the window size. The first sample after
+/// reset() initializes the filter state, so the output starts at the input without a transient.
+class TwistFilter
+{
+public:
+  static constexpr size_t NR_COMPONENTS = 3;
+  using Twist = std::array<double, NR_COMPONENTS>;
+
+  TwistFilter() { configure(TwistFilterConfig()); }
+
+  /// \brief Sets the filter and allocates its state (not RT safe)
+  void configure(const TwistFilterConfig & config)
+  {
+    config_ = config;
+    window_.assign(
+      config_.type == TwistFilterType::MEAN && config_.window_size > 0 ? config_.window_size : 1,
+      Twist{0.0, 0.0, 0.0});
+    reset();
+  }
+
+  /// \brief Clears the filter state, the next sample initializes it
+  void reset()
+  {
+    initialized_ = false;
+    output_.fill(0.0);
+    sum_.fill(0.0);
+    next_insert_ = 0;
+    nr_samples_ = 0;
+    butterworth_dt_ = 0.0;
+  }
+
+  /// \brief Filters one sample
+  /// \param input Body twist [vx, vy, wz]
+  /// \param dt Time since the previous sample [s]
+  /// \return filtered twist
+  const Twist & filter(const Twist & input, double dt)
+  {
+    if (!initialized_)
+    {
+      initialize(input);
+      return output_;
+    }
+
+    switch (config_.type)
+    {
+      case TwistFilterType::MEAN:
+        filterMean(input);
+        break;
+      case TwistFilterType::EXPONENTIAL:
+        for (size_t i = 0; i < NR_COMPONENTS; ++i)
+        {
+          output_[i] += config_.exponential_alpha * (input[i] - output_[i]);
+        }
+        break;
+      case TwistFilterType::BUTTERWORTH:
+        filterButterworth(input, dt);
+        break;
+      case TwistFilterType::ONE_EURO:
+        filterOneEuro(input, dt);
+        break;
+      case TwistFilterType::NONE:
+      default:
+        output_ = input;
+        break;
+    }
+    return output_;
+  }
+
+  /// \return last filtered twist
+  const Twist & output() const { return output_; }
+
+  const TwistFilterConfig & config() const { return config_; }
+
+private:
+  void initialize(const Twist & input)
+  {
+    output_ = input;
+    for (auto & sample : window_)
+    {
+      sample.fill(0.0);
+    }
+    window_[0] = input;
+    sum_ = input;
+    next_insert_ = 1 % window_.size();
+    nr_samples_ = 1;
+    butterworth_input_[0] = butterworth_input_[1] = input;
+    butterworth_output_[0] = butterworth_output_[1] = input;
+    previous_input_ = input;
+    derivative_.fill(0.0);
+    initialized_ = true;
+  }
+
+  void filterMean(const Twist & input)
+  {
+    Twist & oldest = window_[next_insert_];
+    for (size_t i = 0; i < NR_COMPONENTS; ++i)
+    {
+      // until the window is filled the replaced samples are zeros
+      sum_[i] += input[i] - oldest[i];
+    }
+    oldest = input;
+    next_insert_ = (next_insert_ + 1) % window_.size();
+    nr_samples_ = nr_samples_ < window_.size() ? nr_samples_ + 1 : nr_samples_;
+    const double count = static_cast<double>(nr_samples_);
+    for (size_t i = 0; i < NR_COMPONENTS; ++i)
+    {
+      output_[i] = sum_[i] / count;
+    }
+  }
+
+  void filterButterworth(const Twist & input, double dt)
+  {
+    // the coefficients depend on the sample time, recompute them only if it changed noticeably
+    if (std::abs(dt - butterworth_dt_) > 1e-3 * butterworth_dt_ || butterworth_dt_ <= 0.0)
+    {
+      computeButterworthCoefficients(dt);
+    }
+    for (size_t i = 0; i < NR_COMPONENTS; ++i)
+    {
+      const double y =
+        b0_ * (input[i] + 2.0 * butterworth_input_[0][i] + butterworth_input_[1][i]) -
+        a1_ * butterworth_output_[0][i] - a2_ * butterworth_output_[1][i];
+      butterworth_input_[1][i] = butterworth_input_[0][i];
+      butterworth_input_[0][i] = input[i];
+      butterworth_output_[1][i] = butterworth_output_[0][i];
+      butterworth_output_[0][i] = y;
+      output_[i] = y;
+    }
+  }
+
+  void computeButterworthCoefficients(double dt)
+  {
+    butterworth_dt_ = dt;
+    // bilinear transform with prewarping, the cutoff is limited below the Nyquist frequency
+    const double warped = std::tan(std::min(M_PI * config_.cutoff_frequency * dt, 0.49 * M_PI));
+    const double warped2 = warped * warped;
+    const double norm = 1.0 / (1.0 + M_SQRT2 * warped + warped2);
+    b0_ = warped2 * norm;
+    a1_ = 2.0 * (warped2 - 1.0) * norm;
+    a2_ = (1.0 - M_SQRT2 * warped + warped2) * norm;
+  }
+
+  void filterOneEuro(const Twist & input, double dt)
+  {
+    const double derivative_alpha = smoothingFactor(config_.one_euro_derivative_cutoff, dt);
+    for (size_t i = 0; i < NR_COMPONENTS; ++i)
+    {
+      const double derivative = (input[i] - previous_input_[i]) / dt;
+      derivative_[i] += derivative_alpha * (derivative - derivative_[i]);
+      const double cutoff =
+        config_.cutoff_frequency + config_.one_euro_beta * std::abs(derivative_[i]);
+      output_[i] += smoothingFactor(cutoff, dt) * (input[i] - output_[i]);
+      previous_input_[i] = input[i];
+    }
+  }
+
+  /// \return smoothing factor of a first order low-pass with the cutoff frequency \p cutoff
+  static double smoothingFactor(double cutoff, double dt)
+  {
+    const double omega_dt = 2.0 * M_PI * cutoff * dt;
+    return omega_dt / (omega_dt + 1.0);
+  }
+
+  TwistFilterConfig config_;
+  bool initialized_ = false;
+  Twist output_;
+
+  // MEAN: ring buffer of the last samples and their sum
+  std::vector<Twist> window_;
+  Twist sum_;
+  size_t next_insert_ = 0;
+  size_t nr_samples_ = 0;
+
+  // BUTTERWORTH: last two inputs and outputs, coefficients for butterworth_dt_ (b1 = 2 b0, b2 = b0)
+  std::array<Twist, 2> butterworth_input_;
+  std::array<Twist, 2> butterworth_output_;
+  double butterworth_dt_ = 0.0;
+  double b0_ = 1.0;
+  double a1_ = 0.0;
+  double a2_ = 0.0;
+
+  // ONE_EURO: previous input and filtered rate of change
+  Twist previous_input_;
+  Twist derivative_;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__TWIST_FILTER_HPP_
@@ -0,0 +1,223 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__TWIST_LIMITER_HPP_
+#define MECANUM_DRIVE_CONTROLLER__TWIST_LIMITER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+
+namespace mecanum_drive_controller
+{
+/// \brief Limits of one component of the body twist, 0 means unlimited
+struct AxisLimits
+{
+  double max_velocity = 0.0;      // [m/s] or [rad/s]
+  double max_acceleration = 0.0;  // [m/s^2] or [rad/s^2]
+  double max_jerk = 0.0;          // [m/s^3] or [rad/s^3]
+};
+
+/// \brief Limits the reference body twist before it is turned into wheel commands.
+///
+/// Stage 1 limits each twist component [vx, vy, wz] independently to its velocity, acceleration
+/// and jerk limits, relative to the twist commanded in the previous cycle. Near the target the
+/// acceleration is further bounded, so that it can be ramped down to zero with the jerk limit
+/// without overshooting the target.
+/// Stage 2 computes the wheel velocities by IK and, if any exceeds the maximal wheel velocity,
+/// scales the whole twist by the same factor, which keeps the direction of motion. The stages can
+/// be run separately, e.g., to correct the limited twist by feedback before the desaturation.
+///
+/// The state is three fixed-size arrays and the wheel velocities are written into the caller's
+/// preallocated vector, so limit() does not allocate.
+class TwistLimiter
+{
+public:
+  using Twist = MecanumKinematics::Twist;
+  static constexpr size_t NR_COMPONENTS = MecanumKinematics::NR_TWIST_COMPONENTS;
+
+  /// \param limits Limits of [vx, vy, wz]
+  /// \param max_wheel_velocity Maximal absolute wheel velocity [rad/s], 0 means unlimited
+  void configure(const std::array<AxisLimits, NR_COMPONENTS> & limits, double max_wheel_velocity)
+  {
+    limits_ = limits;
+    max_wheel_velocity_ = max_wheel_velocity;
+    reset();
+  }
+
+  /// \return false if no limit is set, i.e., limit() only computes the IK
+  bool isActive() const
+  {
+    bool active = max_wheel_velocity_ > 0.0;
+    for (const auto & axis : limits_)
+    {
+      active = active || axis.max_velocity > 0.0 || axis.max_acceleration > 0.0 ||
+               axis.max_jerk > 0.0;
+    }
+    return active;
+  }
+
+  /// \brief Restarts from \p twist at rest (no acceleration), e.g., the twist the base moves with
+  void reset(const Twist & twist = {0.0, 0.0, 0.0})
+  {
+    velocity_ = twist;
+    previous_velocity_ = twist;
+    acceleration_.fill(0.0);
+    dt_ = 0.0;
+  }
+
+  /// \brief Limits \p twist in place and computes its wheel velocities (RT safe), i.e.,
+  /// limitComponents() followed by desaturate()
+  /// \param dt Time since the last call [s]
+  /// \param wheel_velocities Output, has to be presized to kinematics.size()
+  void limit(
+    Twist & twist, double dt, const MecanumKinematics & kinematics,
+    std::vector<double> & wheel_velocities)
+  {
+    limitComponents(twist, dt);
+    desaturate(twist, kinematics, wheel_velocities);
+  }
+
+  /// \brief Stage 1: limits the velocity, acceleration and jerk of each component of \p twist in
+  /// place (RT safe)
+  /// \param dt Time since the last call [s]
+  void limitComponents(Twist & twist, double dt)
+  {
+    if (dt > 0.0)
+    {
+      for (size_t i = 0; i < NR_COMPONENTS; ++i)
+      {
+        twist[i] = limitComponent(i, twist[i], dt);
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < NR_COMPONENTS; ++i)
+      {
+        twist[i] = clamp(twist[i], limits_[i].max_velocity);
+      }
+    }
+
+    previous_velocity_ = velocity_;
+    velocity_ = twist;
+    dt_ = dt;
+    updateAcceleration();
+  }
+
+  /// \brief Stage 2: computes the wheel velocities of \p twist and, if any exceeds the maximal
+  /// wheel velocity, scales both down uniformly (RT safe)
+  ///
+  /// \p twist may differ from the output of limitComponents(), e.g., by a feedback correction.
+  /// The next limitComponents() continues from its output scaled by the same factor.
+  /// \param wheel_velocities Output, has to be presized to kinematics.size()
+  /// \return the factor \p twist was scaled with, 1 if no wheel exceeds the limit
+  double desaturate(
+    Twist & twist, const MecanumKinematics & kinematics, std::vector<double> & wheel_velocities)
+  {
+    kinematics.inverse(twist, wheel_velocities);
+    if (max_wheel_velocity_ <= 0.0)
+    {
+      return 1.0;
+    }
+    double max_abs_wheel_velocity = 0.0;
+    for (const double wheel_velocity : wheel_velocities)
+    {
+      max_abs_wheel_velocity = std::max(max_abs_wheel_velocity, std::abs(wheel_velocity));
+    }
+    if (max_abs_wheel_velocity <= max_wheel_velocity_)
+    {
+      return 1.0;
+    }
+    const double scale = max_wheel_velocity_ / max_abs_wheel_velocity;
+    for (auto & component : twist)
+    {
+      component *= scale;
+    }
+    for (auto & wheel_velocity : wheel_velocities)
+    {
+      wheel_velocity *= scale;
+    }
+    // the acceleration of the next cycle continues from what was actually commanded
+    for (auto & component : velocity_)
+    {
+      component *= scale;
+    }
+    updateAcceleration();
+    return scale;
+  }
+
+  /// \return twist commanded by the last call of limit()
+  const Twist & getVelocity() const { return velocity_; }
+
+  /// \return acceleration of the twist commanded by the last call of limit()
+  const Twist & getAcceleration() const { return acceleration_; }
+
+  /// \return maximal absolute wheel velocity [rad/s], 0 if unlimited
+  double getMaxWheelVelocity() const { return max_wheel_velocity_; }
+
+private:
+  static double clamp(double value, double limit)
+  {
+    return limit > 0.0 ? std::clamp(value, -limit, limit) : value;
+  }
+
+  void updateAcceleration()
+  {
+    for (size_t i = 0; i < NR_COMPONENTS; ++i)
+    {
+      acceleration_[i] = dt_ > 0.0 ? (velocity_[i] - previous_velocity_[i]) / dt_ : 0.0;
+    }
+  }
+
+  double limitComponent(size_t i, double target, double dt) const
+  {
+    const AxisLimits & limits = limits_[i];
+    target = clamp(target, limits.max_velocity);
+
+    double acceleration = (target - velocity_[i]) / dt;
+    acceleration = clamp(acceleration, limits.max_acceleration);
+    if (limits.max_jerk > 0.0)
+    {
+      // bound the acceleration so it can be ramped down to zero at the target with the jerk
+      // limit: the velocity change while ramping down from a in steps of dt is
+      // a^2 / (2 * max_jerk) + a * dt / 2, which must not exceed the distance to the target
+      const double half_step = 0.5 * limits.max_jerk * dt;
+      const double braking_acceleration =
+        std::sqrt(half_step * half_step + 2.0 * limits.max_jerk * std::abs(target - velocity_[i])) -
+        half_step;
+      acceleration = clamp(acceleration, braking_acceleration);
+      const double max_change = limits.max_jerk * dt;
+      acceleration =
+        std::clamp(acceleration, acceleration_[i] - max_change, acceleration_[i] + max_change);
+    }
+    return clamp(velocity_[i] + acceleration * dt, limits.max_velocity);
+  }
+
+  std::array<AxisLimits, NR_COMPONENTS> limits_;
+  double max_wheel_velocity_ = 0.0;
+
+  // twist and acceleration commanded in the previous cycle, and the twist and period before it
+  Twist velocity_ = {0.0, 0.0, 0.0};
+  Twist acceleration_ = {0.0, 0.0, 0.0};
+  Twist previous_velocity_ = {0.0, 0.0, 0.0};
+  double dt_ = 0.0;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__TWIST_LIMITER_HPP_
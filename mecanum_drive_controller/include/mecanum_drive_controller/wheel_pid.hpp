@@ -0,0 +1,122 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MECANUM_DRIVE_CONTROLLER__WHEEL_PID_HPP_
+#define MECANUM_DRIVE_CONTROLLER__WHEEL_PID_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace mecanum_drive_controller
+{
+/// \brief Velocity PID controllers of all wheels, with feedforward of the velocity reference.
+///
+/// For each wheel with reference r and measured velocity w the output (e.g., an effort) is
+///
+///   u = feedforward * r + p * e + I - d * dw/dt,   e = r - w,   I += i * e * dt
+///
+/// The derivative acts on the measured velocity, so a step of the reference does not kick the
+/// output. The output is clamped to 'max_output' and the integral term to 'max_integral'. Against
+/// windup the integral advances into the direction of a saturated output at most until the output
+/// reaches the limit, so it leaves the saturation as soon as the error changes its sign.
+///
+/// The state of all wheels is held in vectors sized at configure, update() does not allocate.
+class WheelPidBank
+{
+public:
+  struct Gains
+  {
+    double p = 0.0;
+    double i = 0.0;
+    double d = 0.0;
+    double feedforward = 0.0;   // output per wheel velocity reference
+    double max_integral = 0.0;  // maximal absolute integral term, 0 means unlimited
+    double max_output = 0.0;    // maximal absolute output, 0 means unlimited
+  };
+
+  void configure(size_t nr_wheels, const Gains & gains)
+  {
+    gains_ = gains;
+    integrals_.assign(nr_wheels, 0.0);
+    previous_velocities_.assign(nr_wheels, 0.0);
+    reset();
+  }
+
+  /// \brief Clears the integral terms and the velocities of the derivative terms
+  void reset()
+  {
+    std::fill(integrals_.begin(), integrals_.end(), 0.0);
+    has_previous_velocities_ = false;
+  }
+
+  /// \brief Computes the outputs of all wheels (RT safe)
+  /// \param references Wheel velocity references, e.g., computed by IK [rad/s]
+  /// \param velocities Measured wheel velocities [rad/s]
+  /// \param dt Time since the last call [s]
+  /// \param outputs Output, has to be presized to the number of wheels
+  void update(
+    const std::vector<double> & references, const std::vector<double> & velocities, double dt,
+    std::vector<double> & outputs)
+  {
+    for (size_t i = 0; i < integrals_.size(); ++i)
+    {
+      const double error = references[i] - velocities[i];
+      const double derivative = has_previous_velocities_ && dt > 0.0
+                                  ? (velocities[i] - previous_velocities_[i]) / dt
+                                  : 0.0;
+      previous_velocities_[i] = velocities[i];
+
+      const double proportional =
+        gains_.feedforward * references[i] + gains_.p * error - gains_.d * derivative;
+      double integral = clamp(integrals_[i] + gains_.i * error * dt, gains_.max_integral);
+      double output = proportional + integral;
+      if (gains_.max_output > 0.0 && std::abs(output) > gains_.max_output)
+      {
+        // the integral advances at most until the output reaches the limit
+        if (integral > integrals_[i] && output > 0.0)
+        {
+          integral = std::max(integrals_[i], gains_.max_output - proportional);
+        }
+        else if (integral < integrals_[i] && output < 0.0)
+        {
+          integral = std::min(integrals_[i], -gains_.max_output - proportional);
+        }
+        output = clamp(proportional + integral, gains_.max_output);
+      }
+      integrals_[i] = integral;
+      outputs[i] = output;
+    }
+    has_previous_velocities_ = true;
+  }
+
+  /// \return integral term of each wheel
+  const std::vector<double> & integrals() const { return integrals_; }
+
+private:
+  static double clamp(double value, double limit)
+  {
+    return limit > 0.0 ? std::clamp(value, -limit, limit) : value;
+  }
+
+  Gains gains_;
+  std::vector<double> integrals_;
+  std::vector<double> previous_velocities_;
+  bool has_previous_velocities_ = false;
+};
+
+}  // namespace mecanum_drive_controller
+
+#endif  // MECANUM_DRIVE_CONTROLLER__WHEEL_PID_HPP_
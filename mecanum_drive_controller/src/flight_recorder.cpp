@@ -0,0 +1,225 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mecanum_drive_controller/flight_recorder.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <new>
+
+namespace mecanum_drive_controller
+{
+static_assert(
+  sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && std::atomic<uint64_t>::is_always_lock_free,
+  "The record counter in the mapped file is accessed as lock-free atomic");
+
+FlightRecorder::~FlightRecorder() { close(); }
+
+bool FlightRecorder::rotate(const std::string & path, std::string & error)
+{
+  rotated_path_.clear();
+  struct stat status;
+  if (::stat(path.c_str(), &status) != 0 || status.st_size == 0)
+  {
+    return true;
+  }
+
+  // Suffix of the time of the last write back, a counter avoids overwriting an earlier rotation
+  char stamp[32];
+  struct tm local_time;
+  ::localtime_r(&status.st_mtime, &local_time);
+  std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local_time);
+  std::string rotated_path = path + "." + stamp;
+  for (int counter = 1; ::access(rotated_path.c_str(), F_OK) == 0; ++counter)
+  {
+    rotated_path = path + "." + stamp + "-" + std::to_string(counter);
+  }
+  if (std::rename(path.c_str(), rotated_path.c_str()) != 0)
+  {
+    error = "cannot move '" + path + "' to '" + rotated_path + "': " + std::strerror(errno);
+    return false;
+  }
+  rotated_path_ = rotated_path;
+  return true;
+}
+
+bool FlightRecorder::open(
+  const std::string & path, size_t nr_wheels, size_t capacity,
+  std::chrono::nanoseconds flush_period, std::string & error)
+{
+  close();
+
+  nr_values_ = 2 * nr_wheels + NR_BASE_VALUES;
+  record_size_ = sizeof(int64_t) + nr_values_ * sizeof(double);
+  capacity_ = capacity > 0 ? capacity : 1;
+  mapping_size_ = sizeof(FlightRecorderHeader) + capacity_ * record_size_;
+
+  if (!rotate(path, error))
+  {
+    return false;
+  }
+  file_descriptor_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (file_descriptor_ < 0)
+  {
+    error = "cannot create '" + path + "': " + std::strerror(errno);
+    return false;
+  }
+  if (::ftruncate(file_descriptor_, static_cast<off_t>(mapping_size_)) != 0)
+  {
+    error = "cannot resize '" + path + "': " + std::strerror(errno);
+    ::close(file_descriptor_);
+    file_descriptor_ = -1;
+    return false;
+  }
+  void * mapping =
+    ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor_, 0);
+  if (mapping == MAP_FAILED)
+  {
+    error = "cannot map '" + path + "': " + std::strerror(errno);
+    ::close(file_descriptor_);
+    file_descriptor_ = -1;
+    return false;
+  }
+  mapping_ = mapping;
+
+  // Touch all pages now so that the control loop does not fault them in; locking them in memory
+  // is best effort, it needs the RLIMIT_MEMLOCK to be large enough
+  std::memset(mapping_, 0, mapping_size_);
+  ::mlock(mapping_, mapping_size_);
+
+  header_ = static_cast<FlightRecorderHeader *>(mapping_);
+  header_->magic = FlightRecorderHeader::MAGIC;
+  header_->version = FlightRecorderHeader::VERSION;
+  header_->nr_wheels = static_cast<uint32_t>(nr_wheels);
+  header_->record_size = record_size_;
+  header_->capacity = capacity_;
+  nr_records_ = new (&header_->nr_records) std::atomic<uint64_t>(0);
+  records_ = static_cast<uint8_t *>(mapping_) + sizeof(FlightRecorderHeader);
+
+  stop_flush_ = false;
+  flush_thread_ = std::thread(&FlightRecorder::flushLoop, this, flush_period);
+  return true;
+}
+
+void FlightRecorder::close()
+{
+  if (flush_thread_.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(flush_mutex_);
+      stop_flush_ = true;
+    }
+    flush_condition_.notify_all();
+    flush_thread_.join();
+  }
+  if (mapping_ != nullptr)
+  {
+    ::msync(mapping_, mapping_size_, MS_SYNC);
+    ::munlock(mapping_, mapping_size_);
+    ::munmap(mapping_, mapping_size_);
+    mapping_ = nullptr;
+    header_ = nullptr;
+    nr_records_ = nullptr;
+    records_ = nullptr;
+  }
+  if (file_descriptor_ >= 0)
+  {
+    ::close(file_descriptor_);
+    file_descriptor_ = -1;
+  }
+}
+
+void FlightRecorder::write(int64_t stamp_ns, const double * values)
+{
+  const uint64_t index = nr_records_->load(std::memory_order_relaxed);
+  uint8_t * record = records_ + (index % capacity_) * record_size_;
+  std::memcpy(record, &stamp_ns, sizeof(int64_t));
+  std::memcpy(record + sizeof(int64_t), values, nr_values_ * sizeof(double));
+  nr_records_->store(index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::flushLoop(std::chrono::nanoseconds flush_period)
+{
+  std::unique_lock<std::mutex> lock(flush_mutex_);
+  while (!flush_condition_.wait_for(lock, flush_period, [this]() { return stop_flush_; }))
+  {
+    // only schedules the write back, it does not wait for the disk
+    ::msync(mapping_, mapping_size_, MS_ASYNC);
+  }
+}
+
+bool FlightRecorderReader::open(const std::string & path, std::string & error)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+  {
+    error = "cannot open '" + path + "'";
+    return false;
+  }
+  if (!file.read(reinterpret_cast<char *>(&header_), sizeof(header_)))
+  {
+    error = "'" + path + "' is too short for a flight recorder header";
+    return false;
+  }
+  if (header_.magic != FlightRecorderHeader::MAGIC)
+  {
+    error = "'" + path + "' is not a flight recorder file";
+    return false;
+  }
+  if (header_.version != FlightRecorderHeader::VERSION)
+  {
+    error = "'" + path + "' has the unsupported version " + std::to_string(header_.version);
+    return false;
+  }
+  const size_t expected_record_size =
+    sizeof(int64_t) + (2 * header_.nr_wheels + FlightRecorder::NR_BASE_VALUES) * sizeof(double);
+  if (header_.record_size != expected_record_size || header_.capacity == 0)
+  {
+    error = "'" + path + "' has an inconsistent header";
+    return false;
+  }
+  records_.resize(header_.capacity * header_.record_size);
+  if (!file.read(reinterpret_cast<char *>(records_.data()), records_.size()))
+  {
+    error = "'" + path + "' is truncated";
+    return false;
+  }
+  return true;
+}
+
+size_t FlightRecorderReader::size() const
+{
+  return header_.nr_records < header_.capacity ? header_.nr_records : header_.capacity;
+}
+
+void FlightRecorderReader::read(
+  size_t index, int64_t & stamp_ns, std::vector<double> & values) const
+{
+  const uint64_t oldest = header_.nr_records - size();
+  const uint8_t * record =
+    records_.data() + ((oldest + index) % header_.capacity) * header_.record_size;
+  values.resize((header_.record_size - sizeof(int64_t)) / sizeof(double));
+  std::memcpy(&stamp_ns, record, sizeof(int64_t));
+  std::memcpy(values.data(), record + sizeof(int64_t), values.size() * sizeof(double));
+}
+
+}  // namespace mecanum_drive_controller
@@ -0,0 +1,83 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Converts a flight recorder file of the mecanum drive controller to CSV, oldest record first.
+// Usage: flight_recorder_decoder <file> [<output.csv>]
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mecanum_drive_controller/flight_recorder.hpp"
+
+int main(int argc, char ** argv)
+{
+  if (argc < 2 || argc > 3)
+  {
+    fprintf(stderr, "Usage: %s <flight recorder file> [<output.csv>]\n", argv[0]);
+    return 1;
+  }
+
+  mecanum_drive_controller::FlightRecorderReader reader;
+  std::string error;
+  if (!reader.open(argv[1], error))
+  {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+
+  FILE * output = argc == 3 ? fopen(argv[2], "w") : stdout;
+  if (output == nullptr)
+  {
+    fprintf(stderr, "cannot create '%s'\n", argv[2]);
+    return 1;
+  }
+
+  const size_t nr_wheels = reader.header().nr_wheels;
+  fprintf(output, "stamp_ns");
+  for (const char * prefix : {"wheel_state_", "wheel_command_"})
+  {
+    for (size_t i = 0; i < nr_wheels; ++i)
+    {
+      fprintf(output, ",%s%zu", prefix, i);
+    }
+  }
+  fprintf(
+    output,
+    ",reference_linear_x,reference_linear_y,reference_angular_z,pose_x,pose_y,pose_theta,"
+    "twist_linear_x,twist_linear_y,twist_angular_z\n");
+
+  int64_t stamp_ns = 0;
+  std::vector<double> values;
+  for (size_t i = 0; i < reader.size(); ++i)
+  {
+    reader.read(i, stamp_ns, values);
+    fprintf(output, "%lld", static_cast<long long>(stamp_ns));
+    for (const double value : values)
+    {
+      fprintf(output, ",%.17g", value);
+    }
+    fprintf(output, "\n");
+  }
+
+  if (output != stdout)
+  {
+    fclose(output);
+  }
+  fprintf(
+    stderr, "%zu records of %zu written\n", reader.size(),
+    static_cast<size_t>(reader.header().nr_records));
+  return 0;
+}
@@ -0,0 +1,530 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mecanum_drive_controller/mecanum_drive_batch_controller.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "controller_interface/helpers.hpp"
+#include "hardware_interface/types/hardware_interface_type_values.hpp"
+#include "tf2/transform_datatypes.h"
+#include "tf2_geometry_msgs/tf2_geometry_msgs.hpp"
+
+namespace
+{  // utility
+
+using mecanum_drive_controller::TwistReference;
+
+// called from RT control loop
+void reset_controller_reference(TwistReference & reference)
+{
+  reference.linear_x = std::numeric_limits<double>::quiet_NaN();
+  reference.linear_y = std::numeric_limits<double>::quiet_NaN();
+  reference.angular_z = std::numeric_limits<double>::quiet_NaN();
+}
+
+const std::vector<std::string> REFERENCE_INTERFACE_NAMES = {
+  "linear/x/velocity", "linear/y/velocity", "angular/z/velocity"};
+
+// names of the exported odometry states of each base, same as MecanumDriveController
+const std::vector<std::string> ODOMETRY_STATE_NAMES = {
+  "pose/x", "pose/y", "pose/yaw", "twist/linear/x", "twist/linear/y", "twist/angular/z"};
+
+// sizes the buffer to one value per base, without reallocation if \p keep_storage is set
+void reset_base_buffer(std::vector<double> & buffer, size_t nr_bases, bool keep_storage)
+{
+  if (keep_storage)
+  {
+    std::fill(buffer.begin(), buffer.end(), 0.0);
+  }
+  else
+  {
+    buffer.assign(nr_bases, 0.0);
+  }
+}
+
+}  // namespace
+
+namespace mecanum_drive_controller
+{
+MecanumDriveBatchController::MecanumDriveBatchController()
+: controller_interface::ChainableControllerInterface()
+{
+}
+
+controller_interface::CallbackReturn MecanumDriveBatchController::on_init()
+{
+  try
+  {
+    param_listener_ =
+      std::make_shared<mecanum_drive_batch_controller::ParamListener>(get_node());
+  }
+  catch (const std::exception & e)
+  {
+    fprintf(stderr, "Exception thrown during controller's init with message: %s \n", e.what());
+    return controller_interface::CallbackReturn::ERROR;
+  }
+
+  return controller_interface::CallbackReturn::SUCCESS;
+}
+
+controller_interface::CallbackReturn MecanumDriveBatchController::on_configure(
+  const rclcpp_lifecycle::State & /*previous_state*/)
+{
+  params_ = param_listener_->get_params();
+
+  nr_bases_ = params_.bases.size();
+  nr_wheels_ = MecanumKinematics::NR_DEFAULT_WHEELS;
+  if (nr_bases_ == 0)
+  {
+    RCLCPP_FATAL(get_node()->get_logger(), "'bases' parameter has to contain at least one base.");
+    return CallbackReturn::FAILURE;
+  }
+  // The exported state interfaces point into the odometry buffers, so once they are handed out
+  // the buffers are never reallocated
+  if (state_interfaces_exported_ && pose_x_.size() != nr_bases_)
+  {
+    RCLCPP_FATAL(
+      get_node()->get_logger(),
+      "The number of bases (%zu) can not change after the state interfaces were exported.",
+      nr_bases_);
+    return CallbackReturn::FAILURE;
+  }
+
+  command_joint_names_.clear();
+  command_joint_names_.reserve(nr_bases_ * nr_wheels_);
+  for (const auto & base : params_.bases)
+  {
+    const auto & joints = params_.base.bases_map.at(base).command_joint_names;
+    if (joints.size() != nr_wheels_)
+    {
+      RCLCPP_FATAL(
+        get_node()->get_logger(),
+        "Base '%s' has %zu wheel joints in 'base.%s.command_joint_names', %zu expected.",
+        base.c_str(), joints.size(), base.c_str(), nr_wheels_);
+      return CallbackReturn::FAILURE;
+    }
+    command_joint_names_.insert(command_joint_names_.end(), joints.begin(), joints.end());
+  }
+
+  if (!kinematics_.configure(
+        params_.kinematics.sum_of_robot_center_projection_on_X_Y_axis,
+        params_.kinematics.wheels_radius,
+        {params_.kinematics.base_frame_offset.x, params_.kinematics.base_frame_offset.y,
+         params_.kinematics.base_frame_offset.theta}))
+  {
+    RCLCPP_FATAL(
+      get_node()->get_logger(),
+      "Kinematic parameters do not describe a valid mecanum base. Check wheels radius and "
+      "geometry.");
+    return CallbackReturn::FAILURE;
+  }
+
+  // Preallocate structure-of-arrays buffers used in the control loop
+  wheel_velocities_.assign(nr_wheels_ * nr_bases_, 0.0);
+  wheel_commands_.assign(nr_wheels_ * nr_bases_, 0.0);
+  wheel_velocities_valid_.assign(nr_bases_, 0.0);
+  for (auto * buffer : odometry_buffers())
+  {
+    reset_base_buffer(*buffer, nr_bases_, state_interfaces_exported_);
+  }
+
+  // topics QoS
+  auto subscribers_qos = rclcpp::SystemDefaultsQoS();
+  subscribers_qos.keep_last(1);
+  subscribers_qos.best_effort();
+
+  // Reference Subscribers
+  ref_timeout_ = rclcpp::Duration::from_seconds(params_.reference_timeout);
+  ref_subscribers_.clear();
+  input_refs_.clear();
+  TwistReference reference;
+  reference.stamp_ns = get_node()->now().nanoseconds();
+  current_refs_.assign(nr_bases_, reference);
+  for (size_t base = 0; base < nr_bases_; ++base)
+  {
+    input_refs_.push_back(std::make_unique<ReferenceMailbox>(reference));
+
+    ref_subscribers_.push_back(get_node()->create_subscription<ControllerReferenceMsg>(
+      "~/" + params_.bases[base] + "/reference", subscribers_qos,
+      [this, base](const std::shared_ptr<ControllerReferenceMsg> msg)
+      { reference_callback(base, msg); }));
+  }
+
+  try
+  {
+    // Tf State publisher
+    tf_odom_s_publisher_ =
+      get_node()->create_publisher<TfStateMsg>("~/tf_odometry", rclcpp::SystemDefaultsQoS());
+    rt_tf_odom_state_publisher_ = std::make_unique<TfStatePublisher>(tf_odom_s_publisher_);
+  }
+  catch (const std::exception & e)
+  {
+    fprintf(
+      stderr, "Exception thrown during publisher creation at configure stage with message : %s \n",
+      e.what());
+    return controller_interface::CallbackReturn::ERROR;
+  }
+
+  rt_tf_odom_state_publisher_->lock();
+  rt_tf_odom_state_publisher_->msg_.transforms.resize(nr_bases_);
+  for (size_t base = 0; base < nr_bases_; ++base)
+  {
+    // the stamp is set to the time of the cycle before each publication
+    auto & transform = rt_tf_odom_state_publisher_->msg_.transforms[base];
+    transform.header.frame_id = params_.bases[base] + "/" + params_.odom_frame_id;
+    transform.child_frame_id = params_.bases[base] + "/" + params_.base_frame_id;
+    transform.transform.translation.z = 0.0;
+  }
+  rt_tf_odom_state_publisher_->unlock();
+
+  RCLCPP_INFO(
+    get_node()->get_logger(), "configure successful, driving %zu bases", nr_bases_);
+  return controller_interface::CallbackReturn::SUCCESS;
+}
+
+void MecanumDriveBatchController::reference_callback(
+  size_t base, const std::shared_ptr<ControllerReferenceMsg> msg)
+{
+  // if no timestamp provided use current time for command timestamp
+  if (msg->header.stamp.sec == 0 && msg->header.stamp.nanosec == 0u)
+  {
+    RCLCPP_WARN(
+      get_node()->get_logger(),
+      "Timestamp in header is missing, using current time as command "
+      "timestamp.");
+    msg->header.stamp = get_node()->now();
+  }
+  const auto age_of_last_command = get_node()->now() - msg->header.stamp;
+
+  if (ref_timeout_ == rclcpp::Duration::from_seconds(0) || age_of_last_command <= ref_timeout_)
+  {
+    TwistReference reference;
+    reference.linear_x = msg->twist.linear.x;
+    reference.linear_y = msg->twist.linear.y;
+    reference.angular_z = msg->twist.angular.z;
+    reference.stamp_ns = rclcpp::Time(msg->header.stamp).nanoseconds();
+    input_refs_[base]->writeFromNonRT(reference);
+  }
+  else
+  {
+    RCLCPP_ERROR(
+      get_node()->get_logger(),
+      "Received message for base '%s' has timestamp %.10f older for %.10f which is more then "
+      "allowed timeout (%.4f).",
+      params_.bases[base].c_str(), rclcpp::Time(msg->header.stamp).seconds(),
+      age_of_last_command.seconds(), ref_timeout_.seconds());
+  }
+}
+
+controller_interface::InterfaceConfiguration
+MecanumDriveBatchController::command_interface_configuration() const
+{
+  controller_interface::InterfaceConfiguration command_interfaces_config;
+  command_interfaces_config.type = controller_interface::interface_configuration_type::INDIVIDUAL;
+
+  command_interfaces_config.names.reserve(command_joint_names_.size());
+  for (const auto & joint : command_joint_names_)
+  {
+    command_interfaces_config.names.push_back(joint + "/" + params_.interface_name);
+  }
+
+  return command_interfaces_config;
+}
+
+controller_interface::InterfaceConfiguration
+MecanumDriveBatchController::state_interface_configuration() const
+{
+  controller_interface::InterfaceConfiguration state_interfaces_config;
+  state_interfaces_config.type = controller_interface::interface_configuration_type::INDIVIDUAL;
+
+  state_interfaces_config.names.reserve(command_joint_names_.size());
+  for (const auto & joint : command_joint_names_)
+  {
+    state_interfaces_config.names.push_back(joint + "/" + params_.interface_name);
+  }
+
+  return state_interfaces_config;
+}
+
+std::vector<hardware_interface::CommandInterface>
+MecanumDriveBatchController::on_export_reference_interfaces()
+{
+  reference_interfaces_.resize(
+    MecanumKinematics::NR_TWIST_COMPONENTS * nr_bases_, std::numeric_limits<double>::quiet_NaN());
+
+  std::vector<hardware_interface::CommandInterface> reference_interfaces;
+  reference_interfaces.reserve(reference_interfaces_.size());
+
+  // component-major layout, i.e., the same component of all bases is contiguous
+  for (size_t component = 0; component < MecanumKinematics::NR_TWIST_COMPONENTS; ++component)
+  {
+    for (size_t base = 0; base < nr_bases_; ++base)
+    {
+      reference_interfaces.push_back(hardware_interface::CommandInterface(
+        get_node()->get_name(), params_.bases[base] + "/" + REFERENCE_INTERFACE_NAMES[component],
+        &reference_interfaces_[component * nr_bases_ + base]));
+    }
+  }
+
+  return reference_interfaces;
+}
+
+std::vector<hardware_interface::StateInterface>
+MecanumDriveBatchController::export_state_interfaces()
+{
+  std::vector<hardware_interface::StateInterface> state_interfaces;
+  state_interfaces.reserve(ODOMETRY_STATE_NAMES.size() * nr_bases_);
+  state_interfaces_exported_ = nr_bases_ > 0;
+
+  const auto buffers = odometry_buffers();
+  for (size_t state = 0; state < ODOMETRY_STATE_NAMES.size(); ++state)
+  {
+    for (size_t base = 0; base < nr_bases_; ++base)
+    {
+      state_interfaces.push_back(hardware_interface::StateInterface(
+        get_node()->get_name(), params_.bases[base] + "/" + ODOMETRY_STATE_NAMES[state],
+        &(*buffers[state])[base]));
+    }
+  }
+  return state_interfaces;
+}
+
+std::array<std::vector<double> *, 6> MecanumDriveBatchController::odometry_buffers()
+{
+  return {&pose_x_, &pose_y_, &pose_theta_, &twist_linear_x_, &twist_linear_y_, &twist_angular_z_};
+}
+
+bool MecanumDriveBatchController::on_set_chained_mode(bool chained_mode)
+{
+  // Always accept switch to/from chained mode
+  return true || chained_mode;
+}
+
+controller_interface::CallbackReturn MecanumDriveBatchController::on_activate(
+  const rclcpp_lifecycle::State & /*previous_state*/)
+{
+  // Set default value in command, drop references received while inactive
+  for (size_t base = 0; base < nr_bases_; ++base)
+  {
+    input_refs_[base]->readFromRT(current_refs_[base]);
+    reset_controller_reference(current_refs_[base]);
+  }
+  subscriber_references_pending_ = false;
+
+  return controller_interface::CallbackReturn::SUCCESS;
+}
+
+controller_interface::CallbackReturn MecanumDriveBatchController::on_deactivate(
+  const rclcpp_lifecycle::State & /*previous_state*/)
+{
+  for (auto & command_interface : command_interfaces_)
+  {
+    command_interface.set_value(std::numeric_limits<double>::quiet_NaN());
+  }
+  return controller_interface::CallbackReturn::SUCCESS;
+}
+
+controller_interface::return_type MecanumDriveBatchController::update_reference_from_subscribers()
+{
+  // Take the newest reference of each base if one was received since the last cycle
+  for (size_t base = 0; base < nr_bases_; ++base)
+  {
+    input_refs_[base]->readFromRT(current_refs_[base]);
+  }
+  // The time of the cycle is only passed to update_and_write_commands(), which checks the age of
+  // the references before using them
+  subscriber_references_pending_ = true;
+
+  return controller_interface::return_type::OK;
+}
+
+void MecanumDriveBatchController::apply_subscriber_references(const rclcpp::Time & time)
+{
+  const int64_t time_ns = time.nanoseconds();
+  for (size_t base = 0; base < nr_bases_; ++base)
+  {
+    auto & current_ref = current_refs_[base];
+    const int64_t age_of_last_command = time_ns - current_ref.stamp_ns;
+
+    if (
+      std::isnan(current_ref.linear_x) || std::isnan(current_ref.linear_y) ||
+      std::isnan(current_ref.angular_z))
+    {
+      continue;
+    }
+
+    // send message only if there is no timeout
+    if (
+      age_of_last_command <= ref_timeout_.nanoseconds() ||
+      ref_timeout_ == rclcpp::Duration::from_seconds(0))
+    {
+      reference_interfaces_[base] = current_ref.linear_x;
+      reference_interfaces_[nr_bases_ + base] = current_ref.linear_y;
+      reference_interfaces_[2 * nr_bases_ + base] = current_ref.angular_z;
+
+      if (ref_timeout_ == rclcpp::Duration::from_seconds(0))
+      {
+        reset_controller_reference(current_ref);
+      }
+    }
+    else
+    {
+      reference_interfaces_[base] = 0.0;
+      reference_interfaces_[nr_bases_ + base] = 0.0;
+      reference_interfaces_[2 * nr_bases_ + base] = 0.0;
+
+      reset_controller_reference(current_ref);
+    }
+  }
+}
+
+controller_interface::return_type MecanumDriveBatchController::update_and_write_commands(
+  const rclcpp::Time & time, const rclcpp::Duration & period)
+{
+  if (subscriber_references_pending_)
+  {
+    subscriber_references_pending_ = false;
+    apply_subscriber_references(time);
+  }
+
+  const double dt = period.seconds();
+  const auto & ik = kinematics_.getInverseMatrix();
+  const auto & fk = kinematics_.getForwardMatrix();
+
+  // Gather wheel states into the wheel-major layout. Invalid states are replaced by zero and
+  // the whole base is masked out of odometry.
+  for (size_t base = 0; base < nr_bases_; ++base)
+  {
+    double valid = 1.0;
+    for (size_t wheel = 0; wheel < nr_wheels_; ++wheel)
+    {
+      const double value = state_interfaces_[base * nr_wheels_ + wheel].get_value();
+      const bool is_nan = std::isnan(value);
+      wheel_velocities_[wheel * nr_bases_ + base] = is_nan ? 0.0 : value;
+      valid = is_nan ? 0.0 : valid;
+    }
+    wheel_velocities_valid_[base] = valid;
+  }
+
+  // FORWARD KINEMATICS (odometry) of all bases.
+  for (size_t base = 0; base < nr_bases_; ++base)
+  {
+    twist_linear_x_[base] = 0.0;
+    twist_linear_y_[base] = 0.0;
+    twist_angular_z_[base] = 0.0;
+  }
+  for (size_t wheel = 0; wheel < nr_wheels_; ++wheel)
+  {
+    const double * wheel_velocities = &wheel_velocities_[wheel * nr_bases_];
+    const double fk_x = fk[0][wheel];
+    const double fk_y = fk[1][wheel];
+    const double fk_z = fk[2][wheel];
+    for (size_t base = 0; base < nr_bases_; ++base)
+    {
+      twist_linear_x_[base] += fk_x * wheel_velocities[base];
+      twist_linear_y_[base] += fk_y * wheel_velocities[base];
+      twist_angular_z_[base] += fk_z * wheel_velocities[base];
+    }
+  }
+
+  // Integration of all bases (Euler), the position is expressed in the odometry frame.
+  if (dt >= 0.0001)
+  {
+    const double base_frame_offset_theta = params_.kinematics.base_frame_offset.theta;
+    for (size_t base = 0; base < nr_bases_; ++base)
+    {
+      const double valid = wheel_velocities_valid_[base];
+      twist_linear_x_[base] *= valid;
+      twist_linear_y_[base] *= valid;
+      twist_angular_z_[base] *= valid;
+
+      pose_theta_[base] += twist_angular_z_[base] * dt;
+      const double heading = pose_theta_[base] - base_frame_offset_theta;
+      const double cos_heading = std::cos(heading);
+      const double sin_heading = std::sin(heading);
+      pose_x_[base] +=
+        (cos_heading * twist_linear_x_[base] - sin_heading * twist_linear_y_[base]) * dt;
+      pose_y_[base] +=
+        (sin_heading * twist_linear_x_[base] + cos_heading * twist_linear_y_[base]) * dt;
+    }
+  }
+
+  // INVERSE KINEMATICS (move robots).
+  // A NaN in any reference component of a base propagates to all its wheel commands.
+  const double * reference_x = &reference_interfaces_[0];
+  const double * reference_y = &reference_interfaces_[nr_bases_];
+  const double * reference_z = &reference_interfaces_[2 * nr_bases_];
+  for (size_t wheel = 0; wheel < nr_wheels_; ++wheel)
+  {
+    double * wheel_commands = &wheel_commands_[wheel * nr_bases_];
+    const double ik_x = ik[wheel][0];
+    const double ik_y = ik[wheel][1];
+    const double ik_z = ik[wheel][2];
+    for (size_t base = 0; base < nr_bases_; ++base)
+    {
+      wheel_commands[base] = ik_x * reference_x[base] + ik_y * reference_y[base] +
+                             ik_z * reference_z[base];
+    }
+  }
+
+  // Scatter wheel commands
+  for (size_t base = 0; base < nr_bases_; ++base)
+  {
+    for (size_t wheel = 0; wheel < nr_wheels_; ++wheel)
+    {
+      const double command = wheel_commands_[wheel * nr_bases_ + base];
+      command_interfaces_[base * nr_wheels_ + wheel].set_value(
+        std::isnan(command) ? 0.0 : command);
+    }
+  }
+
+  // Publish tf /odom frames of all bases in one message
+  if (params_.enable_odom_tf && rt_tf_odom_state_publisher_->trylock())
+  {
+    for (size_t base = 0; base < nr_bases_; ++base)
+    {
+      tf2::Quaternion orientation;
+      orientation.setRPY(0.0, 0.0, pose_theta_[base]);
+
+      auto & transform = rt_tf_odom_state_publisher_->msg_.transforms[base];
+      transform.header.stamp = time;
+      transform.transform.translation.x = pose_x_[base];
+      transform.transform.translation.y = pose_y_[base];
+      transform.transform.rotation = tf2::toMsg(orientation);
+    }
+    rt_tf_odom_state_publisher_->unlockAndPublish();
+  }
+
+  std::fill(
+    reference_interfaces_.begin(), reference_interfaces_.end(),
+    std::numeric_limits<double>::quiet_NaN());
+
+  return controller_interface::return_type::OK;
+}
+
+}  // namespace mecanum_drive_controller
+
+#include "pluginlib/class_list_macros.hpp"
+
+PLUGINLIB_EXPORT_CLASS(
+  mecanum_drive_controller::MecanumDriveBatchController,
+  controller_interface::ChainableControllerInterface)
@@ -14,35 +14,144 @@
 
 #include "mecanum_drive_controller/mecanum_drive_controller.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "controller_interface/helpers.hpp"
 #include "hardware_interface/types/hardware_interface_type_values.hpp"
 #include "lifecycle_msgs/msg/state.hpp"
+#include "rclcpp/exceptions/exceptions.hpp"
 #include "tf2/transform_datatypes.h"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.hpp"
 
 namespace
 {  // utility
 
-using ControllerReferenceMsg =
-  mecanum_drive_controller::MecanumDriveController::ControllerReferenceMsg;
+using mecanum_drive_controller::CycleEvent;
+using mecanum_drive_controller::CyclePhase;
+using mecanum_drive_controller::CycleStatistics;
+using mecanum_drive_controller::TwistReference;
+
+// names of the cycle phases and events in the diagnostics message, in the order of the enums
+constexpr const char * CYCLE_PHASE_NAMES[CycleStatistics::NR_PHASES] = {
+  "cycle period",       "reference",  "forward kinematics", "odometry",
+  "inverse kinematics", "publishing", "update"};
+constexpr const char * CYCLE_EVENT_NAMES[CycleStatistics::NR_EVENTS] = {
+  "dropped odometry publications", "dropped tf publications", "dropped state publications",
+  "stale references", "NaN wheel states", "wheel slip cycles"};
+// min, mean, p99, max and number of samples per phase
+constexpr size_t NR_PHASE_VALUES = 5;
+// values per wheel of the slip state message, in the order written by fill_slip_state()
+constexpr const char * SLIP_STATE_INTERFACES[] = {
+  "residual", "innovation", "slipping", "slip_events"};
+// values of the calibration message, in the order written by fill_calibration()
+constexpr const char * CALIBRATION_KEYS[] = {
+  "wheels_radius",    "sum_of_robot_center_projection_on_X_Y_axis",
+  "linear scale",     "angular scale",
+  "linear variance",  "angular variance",
+  "linear samples",   "angular samples"};
+// stamped topics and values per topic of the latency status, in the order written by
+// fill_diagnostics()
+constexpr const char * LATENCY_TOPIC_NAMES[] = {"reference", "calibration measured twist"};
+constexpr const char * LATENCY_VALUE_NAMES[] = {
+  "min", "mean", "p99", "max", "samples", "smoothed", "jitter", "clock skew samples"};
+// exported state interfaces, the odometry followed by the flags of each wheel, in the order
+// written by update_and_write_commands()
+constexpr const char * ODOMETRY_STATE_NAMES[] = {
+  "pose/x", "pose/y", "pose/yaw", "twist/linear/x", "twist/linear/y", "twist/angular/z"};
+constexpr size_t NR_ODOMETRY_STATES = std::size(ODOMETRY_STATE_NAMES);
+constexpr const char * WHEEL_STATE_NAMES[] = {"slipping", "saturated"};
+// a wheel command within this fraction of the wheel velocity limit is saturated
+constexpr double SATURATION_TOLERANCE = 1e-9;
+// preallocated length of a value string, enough for any int64_t
+constexpr size_t DIAGNOSTICS_VALUE_CAPACITY = 24;
 
 // called from RT control loop
-void reset_controller_reference_msg(
-  const std::shared_ptr<ControllerReferenceMsg> & msg,
-  const std::shared_ptr<rclcpp_lifecycle::LifecycleNode> & node)
+void reset_controller_reference(TwistReference & reference)
 {
-  msg->header.stamp = node->now();
-  msg->twist.linear.x = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.linear.y = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.linear.z = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.angular.x = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.angular.y = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.angular.z = std::numeric_limits<double>::quiet_NaN();
+  reference.linear_x = std::numeric_limits<double>::quiet_NaN();
+  reference.linear_y = std::numeric_limits<double>::quiet_NaN();
+  reference.angular_z = std::numeric_limits<double>::quiet_NaN();
+}
+
+// QoS profile of a topic out of its 'qos.<topic>' parameters, always keep last so that the topic
+// can use intra-process communication
+template <typename QosParams>
+rclcpp::QoS make_qos(const QosParams & params)
+{
+  rclcpp::QoS qos(rclcpp::KeepLast(static_cast<size_t>(params.depth)));
+  if (params.reliability == "reliable")
+  {
+    qos.reliable();
+  }
+  else if (params.reliability == "best_effort")
+  {
+    qos.best_effort();
+  }
+  else
+  {
+    qos.reliability(RMW_QOS_POLICY_RELIABILITY_SYSTEM_DEFAULT);
+  }
+  if (params.deadline > 0.0)
+  {
+    qos.deadline(rclcpp::Duration::from_seconds(params.deadline));
+  }
+  if (params.liveliness == "automatic")
+  {
+    qos.liveliness(RMW_QOS_POLICY_LIVELINESS_AUTOMATIC);
+  }
+  else if (params.liveliness == "manual_by_topic")
+  {
+    qos.liveliness(RMW_QOS_POLICY_LIVELINESS_MANUAL_BY_TOPIC);
+  }
+  if (params.liveliness_lease_duration > 0.0)
+  {
+    qos.liveliness_lease_duration(rclcpp::Duration::from_seconds(params.liveliness_lease_duration));
+  }
+  return qos;
+}
+
+// called from RT control loop
+bool is_changed(double value, double last_value, double threshold)
+{
+  if (std::isnan(value) || std::isnan(last_value))
+  {
+    return std::isnan(value) != std::isnan(last_value);
+  }
+  return std::abs(value - last_value) > threshold;
+}
+
+// Sets the fields which are the same in every message of a realtime publisher
+template <typename PublisherT, typename FillFunction>
+void initialize_message(PublisherT & publisher, FillFunction && fill)
+{
+  publisher.lock();
+  fill(publisher.msg_);
+  publisher.unlock();
+}
+
+// called from RT control loop, fills and publishes a message unless the publisher is busy
+template <typename PublisherT, typename FillFunction>
+bool try_publish(PublisherT & publisher, FillFunction && fill)
+{
+  if (!publisher.trylock())
+  {
+    return false;
+  }
+  fill(publisher.msg_);
+  publisher.unlockAndPublish();
+  return true;
 }
 
 }  // namespace
@@ -93,102 +202,587 @@ controller_interface::CallbackReturn MecanumDriveController::on_configure(
     return CallbackReturn::FAILURE;
   }
 
-  // Set wheel params for the odometry computation
-  odometry_.setWheelsParams(
-    params_.kinematics.sum_of_robot_center_projection_on_X_Y_axis,
-    params_.kinematics.wheels_radius);
+  // Build the constant kinematics model used for IK and odometry
+  const size_t nr_wheels = params_.command_joint_names.size();
 
-  // topics QoS
+  // The exported state interfaces point into exported_state_values_, so once they are handed out
+  // the array is never reallocated
+  const size_t nr_exported_states = NR_ODOMETRY_STATES + std::size(WHEEL_STATE_NAMES) * nr_wheels;
+  if (state_interfaces_exported_ && exported_state_values_.size() != nr_exported_states)
+  {
+    RCLCPP_FATAL(
+      get_node()->get_logger(),
+      "The number of wheels (%zu) can not change after the state interfaces were exported.",
+      nr_wheels);
+    return CallbackReturn::FAILURE;
+  }
+  const std::array<double, PLANAR_POINT_DIM> base_frame_offset = {
+    params_.kinematics.base_frame_offset.x, params_.kinematics.base_frame_offset.y,
+    params_.kinematics.base_frame_offset.theta};
+  bool kinematics_valid = false;
+  if (params_.kinematics.use_wheels_geometry)
+  {
+    std::vector<MecanumKinematics::WheelGeometry> wheels;
+    wheels.reserve(nr_wheels);
+    for (const auto & joint : params_.command_joint_names)
+    {
+      const auto & wheel = params_.kinematics.wheels.command_joint_names_map.at(joint);
+      wheels.push_back(
+        {wheel.position_x, wheel.position_y, wheel.roller_angle,
+         wheel.radius > 0.0 ? wheel.radius : params_.kinematics.wheels_radius});
+    }
+    kinematics_valid =
+      kinematics_.configure(wheels, base_frame_offset) && odometry_.setWheelsGeometry(wheels);
+  }
+  else
+  {
+    if (nr_wheels != MecanumKinematics::NR_DEFAULT_WHEELS)
+    {
+      RCLCPP_FATAL(
+        get_node()->get_logger(),
+        "Exactly %zu wheels are expected when 'kinematics.use_wheels_geometry' is false, got %zu.",
+        MecanumKinematics::NR_DEFAULT_WHEELS, nr_wheels);
+      return CallbackReturn::FAILURE;
+    }
+    kinematics_valid = kinematics_.configure(
+      params_.kinematics.sum_of_robot_center_projection_on_X_Y_axis,
+      params_.kinematics.wheels_radius, base_frame_offset);
+
+    // Set wheel params for the odometry computation
+    odometry_.setWheelsParams(
+      params_.kinematics.sum_of_robot_center_projection_on_X_Y_axis,
+      params_.kinematics.wheels_radius);
+  }
+  odometry_.init(get_node()->now(), base_frame_offset);
+  if (params_.odometry.integration_method == "runge_kutta_2")
+  {
+    odometry_.setIntegrationMethod(IntegrationMethod::RUNGE_KUTTA_2);
+  }
+  else if (params_.odometry.integration_method == "exact")
+  {
+    odometry_.setIntegrationMethod(IntegrationMethod::EXACT);
+  }
+  else
+  {
+    odometry_.setIntegrationMethod(IntegrationMethod::EULER);
+  }
+
+  const auto & twist_filter_params = params_.odometry.twist_filter;
+  TwistFilterConfig twist_filter;
+  if (twist_filter_params.type == "mean")
+  {
+    twist_filter.type = TwistFilterType::MEAN;
+  }
+  else if (twist_filter_params.type == "exponential")
+  {
+    twist_filter.type = TwistFilterType::EXPONENTIAL;
+  }
+  else if (twist_filter_params.type == "butterworth")
+  {
+    twist_filter.type = TwistFilterType::BUTTERWORTH;
+  }
+  else if (twist_filter_params.type == "one_euro")
+  {
+    twist_filter.type = TwistFilterType::ONE_EURO;
+  }
+  twist_filter.window_size = static_cast<size_t>(twist_filter_params.window_size);
+  twist_filter.exponential_alpha = twist_filter_params.exponential_alpha;
+  twist_filter.cutoff_frequency = twist_filter_params.cutoff_frequency;
+  twist_filter.one_euro_beta = twist_filter_params.one_euro_beta;
+  twist_filter.one_euro_derivative_cutoff = twist_filter_params.one_euro_derivative_cutoff;
+  odometry_.setTwistFilter(twist_filter);
+
+  // Odometry covariances, the planar entries start from the configured diagonals
+  const auto & covariance_params = params_.odometry.covariance;
+  dynamic_covariance_ = covariance_params.dynamic;
+  OdometryCovariance::Coefficients covariance_coefficients;
+  covariance_coefficients.linear = covariance_params.linear;
+  covariance_coefficients.angular = covariance_params.angular;
+  covariance_coefficients.linear_to_angular = covariance_params.linear_to_angular;
+  covariance_coefficients.slip_factor = covariance_params.slip_factor;
+  covariance_coefficients.twist_speed = covariance_params.twist_speed;
+  odometry_covariance_.configure(
+    covariance_coefficients,
+    {params_.pose_covariance_diagonal[0], params_.pose_covariance_diagonal[1],
+     params_.pose_covariance_diagonal[5]},
+    {params_.twist_covariance_diagonal[0], params_.twist_covariance_diagonal[1],
+     params_.twist_covariance_diagonal[5]});
+
+  if (!kinematics_valid)
+  {
+    RCLCPP_FATAL(
+      get_node()->get_logger(),
+      "Kinematic parameters do not describe a valid mecanum base. Check wheels radius and "
+      "geometry.");
+    return CallbackReturn::FAILURE;
+  }
+
+  // Preallocate buffers used in the control loop
+  wheel_velocities_.assign(nr_wheels, 0.0);
+  wheel_commands_.assign(nr_wheels, 0.0);
+  if (state_interfaces_exported_)
+  {
+    std::fill(exported_state_values_.begin(), exported_state_values_.end(), 0.0);
+  }
+  else
+  {
+    exported_state_values_.assign(nr_exported_states, 0.0);
+  }
+
+  // QoS of the subscriptions without 'qos.<topic>' parameters
   auto subscribers_qos = rclcpp::SystemDefaultsQoS();
   subscribers_qos.keep_last(1);
   subscribers_qos.best_effort();
 
   // Reference Subscriber
   ref_timeout_ = rclcpp::Duration::from_seconds(params_.reference_timeout);
-  ref_subscriber_ = get_node()->create_subscription<ControllerReferenceMsg>(
-    "~/reference", subscribers_qos,
-    std::bind(&MecanumDriveController::reference_callback, this, std::placeholders::_1));
+  TwistReference reference;
+  reference.stamp_ns = get_node()->now().nanoseconds();
+  input_ref_.reset(reference);
+  current_ref_ = reference;
+
+  const auto intra_process = params_.qos.intra_process ? rclcpp::IntraProcessSetting::Enable
+                                                       : rclcpp::IntraProcessSetting::Disable;
+  // A missed deadline is handed to the control loop, which stops the base as for a timeout
+  reference_deadline_misses_.store(0, std::memory_order_relaxed);
+  handled_reference_deadline_misses_ = 0;
+  reference_deadline_missed_ = false;
+
+  // Latency compensation of the references and measured twists
+  latency_compensation_enabled_ = params_.latency_compensation.enable;
+  reference_latency_.configure(params_.latency_compensation.gain);
+  measurement_latency_.configure(params_.latency_compensation.gain);
+  max_prediction_ns_ =
+    static_cast<int64_t>(std::llround(params_.latency_compensation.max_prediction * 1e9));
+
+  // In chained-only mode no topic is subscribed or published, the references come from the
+  // reference interfaces and the odometry is read through the exported state interfaces
+  ref_subscriber_.reset();
+  rt_odom_state_publisher_.reset();
+  rt_predicted_odom_state_publisher_.reset();
+  rt_tf_odom_state_publisher_.reset();
+  controller_state_publisher_.reset();
+  if (!params_.chained_only)
+  {
+    rclcpp::SubscriptionOptions reference_options;
+    reference_options.use_intra_process_comm = intra_process;
+    if (params_.qos.reference.deadline > 0.0)
+    {
+      // Deadline events come from the middleware, which does not see intra-process deliveries
+      // and would report misses while references arrive
+      if (params_.qos.intra_process)
+      {
+        RCLCPP_WARN(
+          get_node()->get_logger(),
+          "Intra-process communication is disabled for '~/reference' as it has a deadline.");
+      }
+      reference_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Disable;
+      reference_options.event_callbacks.deadline_callback =
+        [this](rclcpp::QOSDeadlineRequestedInfo & /*event*/)
+      {
+        reference_deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+        RCLCPP_WARN(get_node()->get_logger(), "Reference deadline missed, stopping.");
+      };
+    }
+    try
+    {
+      ref_subscriber_ = get_node()->create_subscription<ControllerReferenceMsg>(
+        "~/reference", make_qos(params_.qos.reference),
+        std::bind(&MecanumDriveController::reference_callback, this, std::placeholders::_1),
+        reference_options);
+    }
+    catch (const rclcpp::UnsupportedEventTypeException & e)
+    {
+      RCLCPP_ERROR(
+        get_node()->get_logger(),
+        "The middleware does not support the deadline of '~/reference': %s", e.what());
+      return controller_interface::CallbackReturn::ERROR;
+    }
 
-  std::shared_ptr<ControllerReferenceMsg> msg = std::make_shared<ControllerReferenceMsg>();
-  reset_controller_reference_msg(msg, get_node());
-  input_ref_.writeFromNonRT(msg);
+    rclcpp::PublisherOptions odometry_options;
+    odometry_options.use_intra_process_comm = intra_process;
 
-  try
-  {
-    // Odom state publisher
-    odom_s_publisher_ =
-      get_node()->create_publisher<OdomStateMsg>("~/odometry", rclcpp::SystemDefaultsQoS());
-    rt_odom_state_publisher_ = std::make_unique<OdomStatePublisher>(odom_s_publisher_);
+    try
+    {
+      // Odom state publisher
+      odom_s_publisher_ = get_node()->create_publisher<OdomStateMsg>(
+        "~/odometry", make_qos(params_.qos.odometry), odometry_options);
+      rt_odom_state_publisher_ = std::make_unique<OdomStatePublisher>(odom_s_publisher_);
+    }
+    catch (const std::exception & e)
+    {
+      fprintf(
+        stderr,
+        "Exception thrown during publisher creation at configure stage with message : %s \n",
+        e.what());
+      return controller_interface::CallbackReturn::ERROR;
+    }
+
+    auto initialize_odometry = [this](OdomStateMsg & msg)
+    {
+      msg.header.stamp = get_node()->now();
+      msg.header.frame_id = params_.odom_frame_id;
+      msg.child_frame_id = params_.base_frame_id;
+      msg.pose.pose.position.z = 0;
+
+      constexpr size_t NUM_DIMENSIONS = 6;
+      for (size_t index = 0; index < 6; ++index)
+      {
+        const size_t diagonal_index = NUM_DIMENSIONS * index + index;
+        msg.pose.covariance[diagonal_index] = params_.pose_covariance_diagonal[index];
+        msg.twist.covariance[diagonal_index] = params_.twist_covariance_diagonal[index];
+      }
+    };
+    initialize_message(*rt_odom_state_publisher_, initialize_odometry);
+
+    // The odometry predicted to the arrival of the next reference is published next to the
+    // measured one
+    if (latency_compensation_enabled_)
+    {
+      try
+      {
+        predicted_odom_s_publisher_ = get_node()->create_publisher<OdomStateMsg>(
+          "~/odometry/predicted", make_qos(params_.qos.odometry), odometry_options);
+        rt_predicted_odom_state_publisher_ =
+          std::make_unique<OdomStatePublisher>(predicted_odom_s_publisher_);
+      }
+      catch (const std::exception & e)
+      {
+        fprintf(
+          stderr,
+          "Exception thrown during publisher creation at configure stage with message : %s \n",
+          e.what());
+        return controller_interface::CallbackReturn::ERROR;
+      }
+      initialize_message(*rt_predicted_odom_state_publisher_, initialize_odometry);
+    }
+
+    try
+    {
+      // Tf State publisher
+      tf_odom_s_publisher_ = get_node()->create_publisher<TfStateMsg>(
+        "~/tf_odometry", make_qos(params_.qos.tf_odometry));
+      rt_tf_odom_state_publisher_ = std::make_unique<TfStatePublisher>(tf_odom_s_publisher_);
+    }
+    catch (const std::exception & e)
+    {
+      fprintf(
+        stderr,
+        "Exception thrown during publisher creation at configure stage with message : %s \n",
+        e.what());
+      return controller_interface::CallbackReturn::ERROR;
+    }
+
+    initialize_message(
+      *rt_tf_odom_state_publisher_,
+      [this](TfStateMsg & msg)
+      {
+        msg.transforms.resize(1);
+        msg.transforms[0].header.stamp = get_node()->now();
+        msg.transforms[0].header.frame_id = params_.odom_frame_id;
+        msg.transforms[0].child_frame_id = params_.base_frame_id;
+        msg.transforms[0].transform.translation.z = 0.0;
+      });
+
+    try
+    {
+      // controller State publisher
+      controller_s_publisher_ = get_node()->create_publisher<ControllerStateMsg>(
+        "~/controller_state", make_qos(params_.qos.controller_state));
+      controller_state_publisher_ =
+        std::make_unique<ControllerStatePublisher>(controller_s_publisher_);
+    }
+    catch (const std::exception & e)
+    {
+      fprintf(
+        stderr,
+        "Exception thrown during publisher creation at configure stage "
+        "with message : %s \n",
+        e.what());
+      return controller_interface::CallbackReturn::ERROR;
+    }
+
+    initialize_message(
+      *controller_state_publisher_,
+      [this](ControllerStateMsg & msg)
+      {
+        msg.header.stamp = get_node()->now();
+        msg.header.frame_id = params_.odom_frame_id;
+      });
   }
-  catch (const std::exception & e)
+
+  // Publish periods, 0 publishes in every control cycle
+  auto publish_period_ns = [](double rate)
+  { return rate > 0.0 ? static_cast<int64_t>(std::llround(1e9 / rate)) : int64_t{0}; };
+  odom_publish_scheduler_.configure(publish_period_ns(params_.odom_publish_rate));
+  tf_publish_scheduler_.configure(publish_period_ns(params_.tf_publish_rate));
+  state_publish_scheduler_.configure(publish_period_ns(params_.state_publish_rate));
+  last_published_state_.assign(nr_wheels + NR_REF_ITFS, std::numeric_limits<double>::quiet_NaN());
+
+  // Odometry history, a new one is created so that components holding the previous one keep it
+  pose_at_service_.reset();
+  odometry_history_.reset();
+  if (params_.odometry.history_size > 0)
   {
-    fprintf(
-      stderr, "Exception thrown during publisher creation at configure stage with message : %s \n",
-      e.what());
-    return controller_interface::CallbackReturn::ERROR;
+    odometry_history_ =
+      std::make_shared<OdometryHistory>(static_cast<size_t>(params_.odometry.history_size));
+    pose_at_service_ = get_node()->create_service<PoseAtSrv>(
+      "~/pose_at",
+      std::bind(
+        &MecanumDriveController::pose_at_callback, this, std::placeholders::_1,
+        std::placeholders::_2));
   }
 
-  rt_odom_state_publisher_->lock();
-  rt_odom_state_publisher_->msg_.header.stamp = get_node()->now();
-  rt_odom_state_publisher_->msg_.header.frame_id = params_.odom_frame_id;
-  rt_odom_state_publisher_->msg_.child_frame_id = params_.base_frame_id;
-  rt_odom_state_publisher_->msg_.pose.pose.position.z = 0;
-
-  auto & covariance = rt_odom_state_publisher_->msg_.twist.covariance;
-  constexpr size_t NUM_DIMENSIONS = 6;
-  for (size_t index = 0; index < 6; ++index)
+  // Cycle statistics, the diagnostics message is preallocated so that filling it in the control
+  // loop only copies digits into reserved strings
+  diagnostics_publisher_.reset();
+  if (CycleStatistics::ENABLED && params_.diagnostics_publish_rate > 0.0)
   {
-    const size_t diagonal_index = NUM_DIMENSIONS * index + index;
-    covariance[diagonal_index] = params_.pose_covariance_diagonal[index];
-    covariance[diagonal_index] = params_.twist_covariance_diagonal[index];
+    try
+    {
+      diagnostics_s_publisher_ =
+        get_node()->create_publisher<DiagnosticsMsg>("/diagnostics", rclcpp::SystemDefaultsQoS());
+      diagnostics_publisher_ = std::make_unique<DiagnosticsPublisher>(diagnostics_s_publisher_);
+    }
+    catch (const std::exception & e)
+    {
+      fprintf(
+        stderr,
+        "Exception thrown during publisher creation at configure stage with message : %s \n",
+        e.what());
+      return controller_interface::CallbackReturn::ERROR;
+    }
+
+    diagnostics_publisher_->lock();
+    auto & msg = diagnostics_publisher_->msg_;
+    msg.status.resize(1);
+    auto & status = msg.status.front();
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.name = std::string(get_node()->get_name()) + ": cycle statistics";
+    status.message = "Durations in nanoseconds, histograms reset after each publication";
+    status.values.clear();
+    status.values.reserve(
+      CycleStatistics::NR_PHASES * NR_PHASE_VALUES + CycleStatistics::NR_EVENTS);
+    for (const char * phase : CYCLE_PHASE_NAMES)
+    {
+      for (const char * value : {"min", "mean", "p99", "max", "samples"})
+      {
+        diagnostic_msgs::msg::KeyValue key_value;
+        key_value.key = std::string(phase) + " " + value;
+        key_value.value.reserve(DIAGNOSTICS_VALUE_CAPACITY);
+        // moved, a copy of the string would not keep the reserved capacity
+        status.values.push_back(std::move(key_value));
+      }
+    }
+    for (const char * event : CYCLE_EVENT_NAMES)
+    {
+      diagnostic_msgs::msg::KeyValue key_value;
+      key_value.key = event;
+      key_value.value.reserve(DIAGNOSTICS_VALUE_CAPACITY);
+      status.values.push_back(std::move(key_value));
+    }
+    if (latency_compensation_enabled_)
+    {
+      msg.status.resize(2);
+      auto & latency_status = msg.status.back();
+      latency_status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+      latency_status.name = std::string(get_node()->get_name()) + ": latency";
+      latency_status.message =
+        "Latency from header stamp to reception in nanoseconds, histograms reset after each "
+        "publication";
+      latency_status.values.clear();
+      for (const char * topic : LATENCY_TOPIC_NAMES)
+      {
+        for (const char * value : LATENCY_VALUE_NAMES)
+        {
+          diagnostic_msgs::msg::KeyValue key_value;
+          key_value.key = std::string(topic) + " " + value;
+          key_value.value.reserve(DIAGNOSTICS_VALUE_CAPACITY);
+          latency_status.values.push_back(std::move(key_value));
+        }
+      }
+    }
+    diagnostics_publisher_->unlock();
   }
-  rt_odom_state_publisher_->unlock();
+  diagnostics_publish_scheduler_.configure(publish_period_ns(params_.diagnostics_publish_rate));
 
-  try
+  // Flight recorder, the file is created and its pages locked here so that recording a cycle is
+  // only a copy into memory
+  flight_recorder_.close();
+  if (params_.flight_recorder.enable)
   {
-    // Tf State publisher
-    tf_odom_s_publisher_ =
-      get_node()->create_publisher<TfStateMsg>("~/tf_odometry", rclcpp::SystemDefaultsQoS());
-    rt_tf_odom_state_publisher_ = std::make_unique<TfStatePublisher>(tf_odom_s_publisher_);
+    const std::string file = params_.flight_recorder.file.empty()
+                               ? "/tmp/" + std::string(get_node()->get_name()) +
+                                   "_flight_recorder.bin"
+                               : params_.flight_recorder.file;
+    std::string error;
+    if (!flight_recorder_.open(
+          file, nr_wheels, static_cast<size_t>(params_.flight_recorder.capacity),
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::duration<double>(params_.flight_recorder.flush_period)),
+          error))
+    {
+      RCLCPP_ERROR(get_node()->get_logger(), "Flight recorder: %s", error.c_str());
+      return controller_interface::CallbackReturn::ERROR;
+    }
+    flight_record_.assign(flight_recorder_.nrValues(), 0.0);
+    if (!flight_recorder_.rotatedPath().empty())
+    {
+      RCLCPP_INFO(
+        get_node()->get_logger(), "Previous flight record moved to '%s'",
+        flight_recorder_.rotatedPath().c_str());
+    }
+    RCLCPP_INFO(get_node()->get_logger(), "Recording control cycles into '%s'", file.c_str());
   }
-  catch (const std::exception & e)
+
+  // Limits of the reference twist, all zero keeps the plain IK
+  const auto & limits = params_.limits;
+  twist_limiter_.configure(
+    {AxisLimits{
+       limits.linear_x.max_velocity, limits.linear_x.max_acceleration, limits.linear_x.max_jerk},
+     AxisLimits{
+       limits.linear_y.max_velocity, limits.linear_y.max_acceleration, limits.linear_y.max_jerk},
+     AxisLimits{
+       limits.angular_z.max_velocity, limits.angular_z.max_acceleration,
+       limits.angular_z.max_jerk}},
+    limits.max_wheel_velocity);
+
+  // Outer loop on the body twist estimated by FK
+  const auto & feedback = params_.twist_feedback;
+  twist_feedback_enabled_ = feedback.enable;
+  twist_feedback_.configure(
+    {TwistFeedbackGains{feedback.linear_x.p, feedback.linear_x.i, feedback.linear_x.max_correction},
+     TwistFeedbackGains{feedback.linear_y.p, feedback.linear_y.i, feedback.linear_y.max_correction},
+     TwistFeedbackGains{
+       feedback.angular_z.p, feedback.angular_z.i, feedback.angular_z.max_correction}});
+
+  // Closed-loop wheel control, the wheel velocities computed by IK are tracked by a PID per wheel
+  wheel_pid_enabled_ = params_.wheel_pid.enable;
+  WheelPidBank::Gains wheel_pid_gains;
+  wheel_pid_gains.p = params_.wheel_pid.p;
+  wheel_pid_gains.i = params_.wheel_pid.i;
+  wheel_pid_gains.d = params_.wheel_pid.d;
+  wheel_pid_gains.feedforward = params_.wheel_pid.feedforward;
+  wheel_pid_gains.max_integral = params_.wheel_pid.max_integral;
+  wheel_pid_gains.max_output = params_.wheel_pid.max_output;
+  wheel_pid_.configure(nr_wheels, wheel_pid_gains);
+  wheel_pid_outputs_.assign(nr_wheels, 0.0);
+
+  // Slip detection, the state message is preallocated with one entry per wheel
+  slip_detection_enabled_ = params_.slip_detection.enable;
+  slip_publisher_.reset();
+  if (slip_detection_enabled_)
   {
-    fprintf(
-      stderr, "Exception thrown during publisher creation at configure stage with message : %s \n",
-      e.what());
-    return controller_interface::CallbackReturn::ERROR;
-  }
+    if (nr_wheels <= MecanumKinematics::NR_TWIST_COMPONENTS)
+    {
+      RCLCPP_FATAL(
+        get_node()->get_logger(),
+        "Slip detection needs more than %zu wheels, the FK residual of %zu wheels is always zero.",
+        MecanumKinematics::NR_TWIST_COMPONENTS, nr_wheels);
+      return CallbackReturn::FAILURE;
+    }
+    if (!kinematics_.setDownweightedWheelWeight(params_.slip_detection.slipping_wheel_weight))
+    {
+      RCLCPP_FATAL(get_node()->get_logger(), "Kinematics are singular with a downweighted wheel.");
+      return CallbackReturn::FAILURE;
+    }
+    slip_detector_.configure(
+      nr_wheels, params_.slip_detection.residual_threshold,
+      params_.slip_detection.relative_threshold, params_.slip_detection.downweight_slipping_wheel);
 
-  rt_tf_odom_state_publisher_->lock();
-  rt_tf_odom_state_publisher_->msg_.transforms.resize(1);
-  rt_tf_odom_state_publisher_->msg_.transforms[0].header.stamp = get_node()->now();
-  rt_tf_odom_state_publisher_->msg_.transforms[0].header.frame_id = params_.odom_frame_id;
-  rt_tf_odom_state_publisher_->msg_.transforms[0].child_frame_id = params_.base_frame_id;
-  rt_tf_odom_state_publisher_->msg_.transforms[0].transform.translation.z = 0.0;
-  rt_tf_odom_state_publisher_->unlock();
+    try
+    {
+      slip_s_publisher_ =
+        get_node()->create_publisher<SlipStateMsg>("~/slip_state", rclcpp::SystemDefaultsQoS());
+      slip_publisher_ = std::make_unique<SlipStatePublisher>(slip_s_publisher_);
+    }
+    catch (const std::exception & e)
+    {
+      fprintf(
+        stderr,
+        "Exception thrown during publisher creation at configure stage with message : %s \n",
+        e.what());
+      return controller_interface::CallbackReturn::ERROR;
+    }
 
-  try
-  {
-    // controller State publisher
-    controller_s_publisher_ = get_node()->create_publisher<ControllerStateMsg>(
-      "~/controller_state", rclcpp::SystemDefaultsQoS());
-    controller_state_publisher_ =
-      std::make_unique<ControllerStatePublisher>(controller_s_publisher_);
+    slip_publisher_->lock();
+    auto & msg = slip_publisher_->msg_;
+    msg.joint_names = params_.command_joint_names;
+    msg.interface_values.resize(nr_wheels);
+    for (auto & interface_value : msg.interface_values)
+    {
+      interface_value.interface_names.assign(
+        std::begin(SLIP_STATE_INTERFACES), std::end(SLIP_STATE_INTERFACES));
+      interface_value.values.assign(interface_value.interface_names.size(), 0.0);
+    }
+    slip_publisher_->unlock();
+    slip_publish_scheduler_.configure(publish_period_ns(params_.slip_detection.publish_rate));
   }
-  catch (const std::exception & e)
+
+  // Online calibration, the measured twist is handed to the control loop through a mailbox and
+  // the published message is preallocated
+  calibration_enabled_ = params_.calibration.enable;
+  calibration_subscriber_.reset();
+  calibration_publisher_.reset();
+  if (calibration_enabled_)
   {
-    fprintf(
-      stderr,
-      "Exception thrown during publisher creation at configure stage "
-      "with message : %s \n",
-      e.what());
-    return controller_interface::CallbackReturn::ERROR;
+    calibration_.configure(
+      params_.kinematics.wheels_radius,
+      params_.kinematics.sum_of_robot_center_projection_on_X_Y_axis,
+      params_.calibration.forgetting_factor, params_.calibration.min_linear_velocity,
+      params_.calibration.min_angular_velocity);
+    calibration_timeout_ns_ =
+      static_cast<int64_t>(std::llround(params_.calibration.measurement_timeout * 1e9));
+    calibration_measurement_.reset(TwistReference());
+    calibration_subscriber_ = get_node()->create_subscription<ControllerReferenceMsg>(
+      "~/calibration/measured_twist", subscribers_qos,
+      [this](const std::shared_ptr<ControllerReferenceMsg> msg)
+      {
+        TwistReference measurement;
+        measurement.linear_x = msg->twist.linear.x;
+        measurement.linear_y = msg->twist.linear.y;
+        measurement.angular_z = msg->twist.angular.z;
+        measurement.stamp_ns = rclcpp::Time(msg->header.stamp).nanoseconds();
+        measurement.receive_ns = get_node()->now().nanoseconds();
+        calibration_measurement_.writeFromNonRT(measurement);
+      });
+
+    try
+    {
+      calibration_s_publisher_ =
+        get_node()->create_publisher<CalibrationMsg>("~/calibration", rclcpp::SystemDefaultsQoS());
+      calibration_publisher_ = std::make_unique<CalibrationPublisher>(calibration_s_publisher_);
+    }
+    catch (const std::exception & e)
+    {
+      fprintf(
+        stderr,
+        "Exception thrown during publisher creation at configure stage with message : %s \n",
+        e.what());
+      return controller_interface::CallbackReturn::ERROR;
+    }
+
+    calibration_publisher_->lock();
+    auto & msg = calibration_publisher_->msg_;
+    msg.level = CalibrationMsg::OK;
+    msg.name = std::string(get_node()->get_name()) + ": kinematics calibration";
+    msg.message = "Suggested kinematic parameters";
+    msg.values.clear();
+    for (const char * key : CALIBRATION_KEYS)
+    {
+      diagnostic_msgs::msg::KeyValue key_value;
+      key_value.key = key;
+      key_value.value.reserve(DIAGNOSTICS_VALUE_CAPACITY);
+      msg.values.push_back(std::move(key_value));
+    }
+    calibration_publisher_->unlock();
+    calibration_publish_scheduler_.configure(publish_period_ns(params_.calibration.publish_rate));
   }
 
-  controller_state_publisher_->lock();
-  controller_state_publisher_->msg_.header.stamp = get_node()->now();
-  controller_state_publisher_->msg_.header.frame_id = params_.odom_frame_id;
-  controller_state_publisher_->unlock();
+  if (params_.chained_only)
+  {
+    RCLCPP_INFO(get_node()->get_logger(), "Chained-only mode, no topic is subscribed or published");
+  }
 
   RCLCPP_INFO(get_node()->get_logger(), "configure successful");
   return controller_interface::CallbackReturn::SUCCESS;
@@ -205,11 +799,18 @@ void MecanumDriveController::reference_callback(const std::shared_ptr<Controller
       "timestamp.");
     msg->header.stamp = get_node()->now();
   }
-  const auto age_of_last_command = get_node()->now() - msg->header.stamp;
+  const rclcpp::Time now = get_node()->now();
+  const auto age_of_last_command = now - msg->header.stamp;
 
   if (ref_timeout_ == rclcpp::Duration::from_seconds(0) || age_of_last_command <= ref_timeout_)
   {
-    input_ref_.writeFromNonRT(msg);
+    TwistReference reference;
+    reference.linear_x = msg->twist.linear.x;
+    reference.linear_y = msg->twist.linear.y;
+    reference.angular_z = msg->twist.angular.z;
+    reference.stamp_ns = rclcpp::Time(msg->header.stamp).nanoseconds();
+    reference.receive_ns = now.nanoseconds();
+    input_ref_.writeFromNonRT(reference);
   }
   else
   {
@@ -219,10 +820,29 @@ void MecanumDriveController::reference_callback(const std::shared_ptr<Controller
       "(%.4f).",
       rclcpp::Time(msg->header.stamp).seconds(), age_of_last_command.seconds(),
       ref_timeout_.seconds());
-    reset_controller_reference_msg(msg, get_node());
   }
 }
 
+void MecanumDriveController::pose_at_callback(
+  const std::shared_ptr<PoseAtSrv::Request> request, std::shared_ptr<PoseAtSrv::Response> response)
+{
+  const rclcpp::Time stamp(request->time);
+  OdometrySample sample;
+  if (!odometry_history_ || !odometry_history_->poseAt(stamp.nanoseconds(), sample))
+  {
+    response->success = false;
+    response->message = "Requested time is outside of the odometry history.";
+    return;
+  }
+  response->success = true;
+  response->pose.x = sample.x;
+  response->pose.y = sample.y;
+  response->pose.theta = sample.theta;
+  response->twist.linear.x = sample.linear_x;
+  response->twist.linear.y = sample.linear_y;
+  response->twist.angular.z = sample.angular_z;
+}
+
 controller_interface::InterfaceConfiguration
 MecanumDriveController::command_interface_configuration() const
 {
@@ -230,9 +850,12 @@ MecanumDriveController::command_interface_configuration() const
   command_interfaces_config.type = controller_interface::interface_configuration_type::INDIVIDUAL;
 
   command_interfaces_config.names.reserve(params_.command_joint_names.size());
+  // in closed-loop wheel control the wheels are commanded with the output of the PIDs
+  const auto & interface_name =
+    params_.wheel_pid.enable ? params_.wheel_pid.command_interface : params_.interface_name;
   for (const auto & joint : params_.command_joint_names)
   {
-    command_interfaces_config.names.push_back(joint + "/" + params_.interface_name);
+    command_interfaces_config.names.push_back(joint + "/" + interface_name);
   }
 
   return command_interfaces_config;
@@ -275,17 +898,56 @@ MecanumDriveController::on_export_reference_interfaces()
   return reference_interfaces;
 }
 
+std::vector<hardware_interface::StateInterface> MecanumDriveController::export_state_interfaces()
+{
+  std::vector<hardware_interface::StateInterface> state_interfaces;
+  state_interfaces.reserve(exported_state_values_.size());
+  state_interfaces_exported_ = !exported_state_values_.empty();
+  for (size_t i = 0; i < NR_ODOMETRY_STATES; ++i)
+  {
+    state_interfaces.push_back(hardware_interface::StateInterface(
+      get_node()->get_name(), ODOMETRY_STATE_NAMES[i], &exported_state_values_[i]));
+  }
+  const size_t nr_wheels = wheel_commands_.size();
+  for (size_t flag = 0; flag < std::size(WHEEL_STATE_NAMES); ++flag)
+  {
+    for (size_t i = 0; i < nr_wheels; ++i)
+    {
+      state_interfaces.push_back(hardware_interface::StateInterface(
+        get_node()->get_name(),
+        params_.command_joint_names[i] + "/" + WHEEL_STATE_NAMES[flag],
+        &exported_state_values_[NR_ODOMETRY_STATES + flag * nr_wheels + i]));
+    }
+  }
+  return state_interfaces;
+}
+
 bool MecanumDriveController::on_set_chained_mode(bool chained_mode)
 {
-  // Always accept switch to/from chained mode
-  return true || chained_mode;
+  // Without the reference subscription a chained-only controller never leaves chained mode
+  return chained_mode || !params_.chained_only;
 }
 
 controller_interface::CallbackReturn MecanumDriveController::on_activate(
   const rclcpp_lifecycle::State & /*previous_state*/)
 {
-  // Set default value in command
-  reset_controller_reference_msg(*(input_ref_.readFromRT()), get_node());
+  // Set default value in command, drop a reference received while inactive
+  input_ref_.readFromRT(current_ref_);
+  reset_controller_reference(current_ref_);
+  cycle_statistics_.reset();
+  diagnostics_publish_scheduler_.reset();
+  calibration_publish_scheduler_.reset();
+  slip_detector_.reset();
+  slip_publish_scheduler_.reset();
+  // the base is assumed to stand still when the controller is activated
+  twist_limiter_.reset();
+  twist_feedback_.reset();
+  wheel_pid_.reset();
+  reference_latency_.reset();
+  measurement_latency_.reset();
+  subscriber_reference_pending_ = false;
+  reference_deadline_missed_ = false;
+  handled_reference_deadline_misses_ = reference_deadline_misses_.load(std::memory_order_relaxed);
 
   return controller_interface::CallbackReturn::SUCCESS;
 }
@@ -293,181 +955,457 @@ controller_interface::CallbackReturn MecanumDriveController::on_activate(
 controller_interface::CallbackReturn MecanumDriveController::on_deactivate(
   const rclcpp_lifecycle::State & /*previous_state*/)
 {
-  for (size_t i = 0; i < NR_CMD_ITFS; ++i)
+  for (auto & command_interface : command_interfaces_)
   {
-    command_interfaces_[i].set_value(std::numeric_limits<double>::quiet_NaN());
+    command_interface.set_value(std::numeric_limits<double>::quiet_NaN());
+  }
+  // No wheel is commanded or checked for slip while inactive, the last flags must not be reported
+  if (exported_state_values_.size() > NR_ODOMETRY_STATES)
+  {
+    std::fill(
+      exported_state_values_.begin() + NR_ODOMETRY_STATES, exported_state_values_.end(), 0.0);
   }
   return controller_interface::CallbackReturn::SUCCESS;
 }
 
 controller_interface::return_type MecanumDriveController::update_reference_from_subscribers()
 {
-  auto current_ref = *(input_ref_.readFromRT());
-  rclcpp::Time time = get_node()->now();
-  const auto age_of_last_command = time - (current_ref)->header.stamp;
+  CycleStatistics::ScopedPhase phase(cycle_statistics_, CyclePhase::REFERENCE);
+
+  // Take the newest reference if one was received since the last cycle
+  const bool new_reference = input_ref_.readFromRT(current_ref_);
+  if (new_reference && latency_compensation_enabled_)
+  {
+    reference_latency_.add(current_ref_.stamp_ns, current_ref_.receive_ns);
+  }
+  // A deadline missed before a new reference arrived stops the base
+  const uint64_t deadline_misses = reference_deadline_misses_.load(std::memory_order_relaxed);
+  reference_deadline_missed_ =
+    !new_reference && deadline_misses != handled_reference_deadline_misses_;
+  handled_reference_deadline_misses_ = deadline_misses;
+  // The time of the cycle is only passed to update_and_write_commands(), which checks the age of
+  // the reference before using it
+  subscriber_reference_pending_ = true;
+
+  return controller_interface::return_type::OK;
+}
+
+void MecanumDriveController::apply_subscriber_reference(const rclcpp::Time & time)
+{
+  const int64_t age_of_last_command = time.nanoseconds() - current_ref_.stamp_ns;
+  const bool reference_valid = !std::isnan(current_ref_.linear_x) &&
+                               !std::isnan(current_ref_.linear_y) &&
+                               !std::isnan(current_ref_.angular_z);
 
   // send message only if there is no timeout
-  if (age_of_last_command <= ref_timeout_ || ref_timeout_ == rclcpp::Duration::from_seconds(0))
+  if (
+    (age_of_last_command <= ref_timeout_.nanoseconds() ||
+     ref_timeout_ == rclcpp::Duration::from_seconds(0)) &&
+    !reference_deadline_missed_)
   {
-    if (
-      !std::isnan(current_ref->twist.linear.x) && !std::isnan(current_ref->twist.linear.y) &&
-      !std::isnan(current_ref->twist.angular.z))
+    if (reference_valid)
     {
-      reference_interfaces_[0] = current_ref->twist.linear.x;
-      reference_interfaces_[1] = current_ref->twist.linear.y;
-      reference_interfaces_[2] = current_ref->twist.angular.z;
+      reference_interfaces_[0] = current_ref_.linear_x;
+      reference_interfaces_[1] = current_ref_.linear_y;
+      reference_interfaces_[2] = current_ref_.angular_z;
 
       if (ref_timeout_ == rclcpp::Duration::from_seconds(0))
       {
-        current_ref->twist.linear.x = std::numeric_limits<double>::quiet_NaN();
-        current_ref->twist.linear.y = std::numeric_limits<double>::quiet_NaN();
-        current_ref->twist.angular.z = std::numeric_limits<double>::quiet_NaN();
+        reset_controller_reference(current_ref_);
       }
     }
   }
   else
   {
-    if (
-      !std::isnan(current_ref->twist.linear.x) && !std::isnan(current_ref->twist.linear.y) &&
-      !std::isnan(current_ref->twist.angular.z))
+    if (reference_valid)
     {
       reference_interfaces_[0] = 0.0;
       reference_interfaces_[1] = 0.0;
       reference_interfaces_[2] = 0.0;
 
-      current_ref->twist.linear.x = std::numeric_limits<double>::quiet_NaN();
-      current_ref->twist.linear.y = std::numeric_limits<double>::quiet_NaN();
-      current_ref->twist.angular.z = std::numeric_limits<double>::quiet_NaN();
+      reset_controller_reference(current_ref_);
+      cycle_statistics_.count(CycleEvent::STALE_REFERENCE);
     }
   }
-
-  return controller_interface::return_type::OK;
 }
 
 controller_interface::return_type MecanumDriveController::update_and_write_commands(
   const rclcpp::Time & time, const rclcpp::Duration & period)
 {
+  cycle_statistics_.startCycle();
+  CycleStatistics::ScopedPhase update_phase(cycle_statistics_, CyclePhase::UPDATE);
+
+  if (subscriber_reference_pending_)
+  {
+    subscriber_reference_pending_ = false;
+    apply_subscriber_reference(time);
+  }
+
   // FORWARD KINEMATICS (odometry).
-  double wheel_front_left_vel = state_interfaces_[0].get_value();
-  double wheel_back_left_vel = state_interfaces_[1].get_value();
-  double wheel_back_right_vel = state_interfaces_[2].get_value();
-  double wheel_front_right_vel = state_interfaces_[3].get_value();
+  cycle_statistics_.startPhase(CyclePhase::FORWARD_KINEMATICS);
+  bool wheel_velocities_valid = true;
+  for (size_t i = 0; i < state_interfaces_.size(); ++i)
+  {
+    wheel_velocities_[i] = state_interfaces_[i].get_value();
+    wheel_velocities_valid = wheel_velocities_valid && !std::isnan(wheel_velocities_[i]);
+  }
 
-  if (
-    !std::isnan(wheel_front_left_vel) && !std::isnan(wheel_back_left_vel) &&
-    !std::isnan(wheel_back_right_vel) && !std::isnan(wheel_front_right_vel))
+  if (wheel_velocities_valid)
   {
     // Estimate twist (using joint information) and integrate
-    odometry_.update(
-      wheel_front_left_vel, wheel_back_left_vel, wheel_back_right_vel, wheel_front_right_vel,
-      period.seconds());
+    if (slip_detection_enabled_)
+    {
+      slip_detector_.update(kinematics_, wheel_velocities_, body_twist_);
+      if (slip_detector_.isSlipping())
+      {
+        cycle_statistics_.count(CycleEvent::WHEEL_SLIP);
+      }
+    }
+    else
+    {
+      odometry_.getKinematics().forward(wheel_velocities_, body_twist_);
+    }
+    cycle_statistics_.stopPhase(CyclePhase::FORWARD_KINEMATICS);
+
+    CycleStatistics::ScopedPhase phase(cycle_statistics_, CyclePhase::ODOMETRY);
+    // the body twist is rotated into the odometry frame by the orientation minus the orientation
+    // of the base frame offset, see Odometry::updateFromVelocity()
+    const double heading = odometry_.getRz() - params_.kinematics.base_frame_offset.theta;
+    odometry_.updateFromVelocity(body_twist_[0], body_twist_[1], body_twist_[2], period.seconds());
+    if (dynamic_covariance_)
+    {
+      odometry_covariance_.update(
+        body_twist_, heading, period.seconds(), slip_detector_.isSlipping());
+      double squared_speed = 0.0;
+      for (const double wheel_velocity : wheel_velocities_)
+      {
+        squared_speed += wheel_velocity * wheel_velocity;
+      }
+      odometry_covariance_.updateTwist(
+        std::sqrt(squared_speed / static_cast<double>(wheel_velocities_.size())));
+    }
+  }
+  else
+  {
+    cycle_statistics_.count(CycleEvent::NAN_WHEEL_STATE);
+    // FK is not evaluated, the slip state of the last valid cycle must not be reported
+    slip_detector_.reset();
   }
 
+  // Each measured twist is matched once with the FK twist of the cycle it arrives in
+  TwistReference measurement;
+  const bool new_measurement =
+    calibration_enabled_ && calibration_measurement_.readFromRT(measurement);
+  if (new_measurement && latency_compensation_enabled_)
+  {
+    measurement_latency_.add(measurement.stamp_ns, measurement.receive_ns);
+  }
+  if (
+    new_measurement && wheel_velocities_valid && !slip_detector_.isSlipping() &&
+    std::abs(time.nanoseconds() - measurement.stamp_ns) <= calibration_timeout_ns_)
+  {
+    calibration_.update(
+      body_twist_, {measurement.linear_x, measurement.linear_y, measurement.angular_z});
+  }
+
+  if (odometry_history_)
+  {
+    OdometrySample sample;
+    sample.stamp_ns = time.nanoseconds();
+    sample.x = odometry_.getX();
+    sample.y = odometry_.getY();
+    sample.theta = odometry_.getRz();
+    sample.linear_x = odometry_.getVx();
+    sample.linear_y = odometry_.getVy();
+    sample.angular_z = odometry_.getWz();
+    odometry_history_->push(sample);
+  }
+
+  // Odometry of this cycle for the consumers of the exported state interfaces
+  exported_state_values_[0] = odometry_.getX();
+  exported_state_values_[1] = odometry_.getY();
+  exported_state_values_[2] = odometry_.getRz();
+  exported_state_values_[3] = odometry_.getVx();
+  exported_state_values_[4] = odometry_.getVy();
+  exported_state_values_[5] = odometry_.getWz();
+
   // INVERSE KINEMATICS (move robot).
   // Compute wheels velocities (this is the actual ik):
   // NOTE: the input desired twist (from topic `~/reference`) is a body twist.
-  if (
+  const bool reference_valid =
     !std::isnan(reference_interfaces_[0]) && !std::isnan(reference_interfaces_[1]) &&
-    !std::isnan(reference_interfaces_[2]))
-  {
-    tf2::Quaternion quaternion;
-    quaternion.setRPY(0.0, 0.0, params_.kinematics.base_frame_offset.theta);
-    /// \note The variables meaning:
-    /// rotation_from_base_to_center: Rotation transformation matrix, to transform from
-    /// base frame to center frame
-    /// linear_trans_from_base_to_center: offset/linear transformation matrix, to
-    /// transform from base frame to center frame
-
-    tf2::Matrix3x3 rotation_from_base_to_center = tf2::Matrix3x3((quaternion));
-    tf2::Vector3 velocity_in_base_frame_w_r_t_center_frame_ =
-      rotation_from_base_to_center *
-      tf2::Vector3(reference_interfaces_[0], reference_interfaces_[1], 0.0);
-    tf2::Vector3 linear_trans_from_base_to_center = tf2::Vector3(
-      params_.kinematics.base_frame_offset.x, params_.kinematics.base_frame_offset.y, 0.0);
-
-    velocity_in_center_frame_linear_x_ =
-      velocity_in_base_frame_w_r_t_center_frame_.x() +
-      linear_trans_from_base_to_center.y() * reference_interfaces_[2];
-    velocity_in_center_frame_linear_y_ =
-      velocity_in_base_frame_w_r_t_center_frame_.y() -
-      linear_trans_from_base_to_center.x() * reference_interfaces_[2];
-    velocity_in_center_frame_angular_z_ = reference_interfaces_[2];
-
-    double w_front_left_vel =
-      1.0 / params_.kinematics.wheels_radius *
-      (velocity_in_center_frame_linear_x_ - velocity_in_center_frame_linear_y_ -
-       params_.kinematics.sum_of_robot_center_projection_on_X_Y_axis *
-         velocity_in_center_frame_angular_z_);
-    double w_back_left_vel =
-      1.0 / params_.kinematics.wheels_radius *
-      (velocity_in_center_frame_linear_x_ + velocity_in_center_frame_linear_y_ -
-       params_.kinematics.sum_of_robot_center_projection_on_X_Y_axis *
-         velocity_in_center_frame_angular_z_);
-    double w_back_right_vel =
-      1.0 / params_.kinematics.wheels_radius *
-      (velocity_in_center_frame_linear_x_ - velocity_in_center_frame_linear_y_ +
-       params_.kinematics.sum_of_robot_center_projection_on_X_Y_axis *
-         velocity_in_center_frame_angular_z_);
-    double w_front_right_vel =
-      1.0 / params_.kinematics.wheels_radius *
-      (velocity_in_center_frame_linear_x_ + velocity_in_center_frame_linear_y_ +
-       params_.kinematics.sum_of_robot_center_projection_on_X_Y_axis *
-         velocity_in_center_frame_angular_z_);
-
-    // Set wheels velocities:
-    command_interfaces_[0].set_value(w_front_left_vel);
-    command_interfaces_[1].set_value(w_back_left_vel);
-    command_interfaces_[2].set_value(w_back_right_vel);
-    command_interfaces_[3].set_value(w_front_right_vel);
+    !std::isnan(reference_interfaces_[2]);
+  if (twist_limiter_.isActive() || reference_valid)
+  {
+    CycleStatistics::ScopedPhase phase(cycle_statistics_, CyclePhase::INVERSE_KINEMATICS);
+    // Without a valid reference the base is ramped down to zero within the limits instead of
+    // stopping at once
+    MecanumKinematics::Twist reference_twist = {0.0, 0.0, 0.0};
+    if (reference_valid)
+    {
+      reference_twist = {
+        reference_interfaces_[0], reference_interfaces_[1], reference_interfaces_[2]};
+    }
+    if (twist_limiter_.isActive())
+    {
+      twist_limiter_.limitComponents(reference_twist, period.seconds());
+    }
+    // The error is taken against the limited twist, so a ramp of the limits does not wind up the
+    // integral. Without a valid reference the feedback must not drive the base.
+    const bool corrected = twist_feedback_enabled_ && reference_valid && wheel_velocities_valid;
+    if (corrected)
+    {
+      twist_feedback_.correct(reference_twist, body_twist_, period.seconds());
+    }
+    else if (!reference_valid)
+    {
+      twist_feedback_.reset();
+    }
+    if (twist_limiter_.isActive())
+    {
+      // The corrected twist is bounded by the wheel velocity limit, its scaling stops the
+      // integration of the feedback
+      const double scale = twist_limiter_.desaturate(reference_twist, kinematics_, wheel_commands_);
+      if (corrected)
+      {
+        twist_feedback_.scaleCorrection(scale);
+      }
+    }
+    else
+    {
+      /// \note The IK matrix is built at configure and already contains the transformation
+      /// of the body twist from the base frame to the center frame.
+      kinematics_.inverse(reference_twist, wheel_commands_);
+    }
   }
   else
   {
-    command_interfaces_[0].set_value(0.0);
-    command_interfaces_[1].set_value(0.0);
-    command_interfaces_[2].set_value(0.0);
-    command_interfaces_[3].set_value(0.0);
+    twist_feedback_.reset();
+    std::fill(wheel_commands_.begin(), wheel_commands_.end(), 0.0);
+  }
+
+  // Set wheels velocities, in closed-loop wheel control they are the references of the PIDs
+  if (!wheel_pid_enabled_)
+  {
+    for (size_t i = 0; i < command_interfaces_.size(); ++i)
+    {
+      command_interfaces_[i].set_value(wheel_commands_[i]);
+    }
+  }
+  else if (wheel_velocities_valid)
+  {
+    wheel_pid_.update(wheel_commands_, wheel_velocities_, period.seconds(), wheel_pid_outputs_);
+    for (size_t i = 0; i < command_interfaces_.size(); ++i)
+    {
+      command_interfaces_[i].set_value(wheel_pid_outputs_[i]);
+    }
+  }
+  else
+  {
+    // the loop can not be closed without the wheel velocities
+    wheel_pid_.reset();
+    for (auto & command_interface : command_interfaces_)
+    {
+      command_interface.set_value(0.0);
+    }
+  }
+
+  // Wheel flags of this cycle for the consumers of the exported state interfaces
+  const size_t slipping_offset = NR_ODOMETRY_STATES;
+  const size_t saturated_offset = NR_ODOMETRY_STATES + wheel_commands_.size();
+  const double saturation_limit =
+    twist_limiter_.getMaxWheelVelocity() * (1.0 - SATURATION_TOLERANCE);
+  for (size_t i = 0; i < wheel_commands_.size(); ++i)
+  {
+    const bool saturated =
+      saturation_limit > 0.0 && std::abs(wheel_commands_[i]) >= saturation_limit;
+    exported_state_values_[slipping_offset + i] = slip_detector_.slippingWheel() == i ? 1.0 : 0.0;
+    exported_state_values_[saturated_offset + i] = saturated ? 1.0 : 0.0;
   }
 
   // Publish odometry message
+  cycle_statistics_.startPhase(CyclePhase::PUBLISHING);
   // Compute and store orientation info
   tf2::Quaternion orientation;
   orientation.setRPY(0.0, 0.0, odometry_.getRz());
+  const int64_t time_ns = time.nanoseconds();
 
   // Populate odom message and publish
-  if (rt_odom_state_publisher_->trylock())
+  if (rt_odom_state_publisher_ && odom_publish_scheduler_.isDue(time_ns))
   {
-    rt_odom_state_publisher_->msg_.header.stamp = time;
-    rt_odom_state_publisher_->msg_.pose.pose.position.x = odometry_.getX();
-    rt_odom_state_publisher_->msg_.pose.pose.position.y = odometry_.getY();
-    rt_odom_state_publisher_->msg_.pose.pose.orientation = tf2::toMsg(orientation);
-    rt_odom_state_publisher_->msg_.twist.twist.linear.x = odometry_.getVx();
-    rt_odom_state_publisher_->msg_.twist.twist.linear.y = odometry_.getVy();
-    rt_odom_state_publisher_->msg_.twist.twist.angular.z = odometry_.getWz();
-    rt_odom_state_publisher_->unlockAndPublish();
+    const bool published = try_publish(
+      *rt_odom_state_publisher_,
+      [&](OdomStateMsg & msg)
+      {
+        msg.header.stamp = time;
+        msg.pose.pose.position.x = odometry_.getX();
+        msg.pose.pose.position.y = odometry_.getY();
+        msg.pose.pose.orientation = tf2::toMsg(orientation);
+        msg.twist.twist.linear.x = odometry_.getVx();
+        msg.twist.twist.linear.y = odometry_.getVy();
+        msg.twist.twist.angular.z = odometry_.getWz();
+        if (dynamic_covariance_)
+        {
+          odometry_covariance_.writePose(msg.pose.covariance);
+          odometry_covariance_.writeTwist(msg.twist.covariance);
+        }
+      });
+    if (published)
+    {
+      odom_publish_scheduler_.published(time_ns);
+    }
+    else
+    {
+      cycle_statistics_.count(CycleEvent::DROPPED_ODOM_PUBLISH);
+    }
+
+    // The next reference is computed from this odometry and arrives after the transport latency,
+    // so the pose is extrapolated with the current twist to that time
+    if (rt_predicted_odom_state_publisher_)
+    {
+      const int64_t horizon_ns = std::min(
+        static_cast<int64_t>(std::llround(reference_latency_.latency())), max_prediction_ns_);
+      std::array<double, 3> predicted_pose;
+      predictPose(
+        {odometry_.getX(), odometry_.getY(), odometry_.getRz()},
+        {odometry_.getVx(), odometry_.getVy(), odometry_.getWz()}, 1e-9 * horizon_ns,
+        predicted_pose);
+      tf2::Quaternion predicted_orientation;
+      predicted_orientation.setRPY(0.0, 0.0, predicted_pose[2]);
+      try_publish(
+        *rt_predicted_odom_state_publisher_,
+        [&](OdomStateMsg & msg)
+        {
+          msg.header.stamp = rclcpp::Time(time_ns + horizon_ns, time.get_clock_type());
+          msg.pose.pose.position.x = predicted_pose[0];
+          msg.pose.pose.position.y = predicted_pose[1];
+          msg.pose.pose.orientation = tf2::toMsg(predicted_orientation);
+          msg.twist.twist.linear.x = odometry_.getVx();
+          msg.twist.twist.linear.y = odometry_.getVy();
+          msg.twist.twist.angular.z = odometry_.getWz();
+          if (dynamic_covariance_)
+          {
+            odometry_covariance_.writePose(msg.pose.covariance);
+            odometry_covariance_.writeTwist(msg.twist.covariance);
+          }
+        });
+    }
   }
 
   // Publish tf /odom frame
-  if (params_.enable_odom_tf && rt_tf_odom_state_publisher_->trylock())
+  if (rt_tf_odom_state_publisher_ && params_.enable_odom_tf && tf_publish_scheduler_.isDue(time_ns))
+  {
+    const bool published = try_publish(
+      *rt_tf_odom_state_publisher_,
+      [&](TfStateMsg & msg)
+      {
+        msg.transforms.front().header.stamp = time;
+        msg.transforms.front().transform.translation.x = odometry_.getX();
+        msg.transforms.front().transform.translation.y = odometry_.getY();
+        msg.transforms.front().transform.rotation = tf2::toMsg(orientation);
+      });
+    if (published)
+    {
+      tf_publish_scheduler_.published(time_ns);
+    }
+    else
+    {
+      cycle_statistics_.count(CycleEvent::DROPPED_TF_PUBLISH);
+    }
+  }
+
+  // With a change threshold the state is published when a wheel velocity or a reference changed
+  // by more than the threshold since the last message, and at the publish rate (if set)
+  bool state_due = false;
+  if (controller_state_publisher_ && params_.state_publish_change_threshold > 0.0)
+  {
+    const double threshold = params_.state_publish_change_threshold;
+    const size_t nr_wheels = wheel_velocities_.size();
+    for (size_t i = 0; i < nr_wheels && !state_due; ++i)
+    {
+      state_due = is_changed(wheel_velocities_[i], last_published_state_[i], threshold);
+    }
+    for (size_t i = 0; i < NR_REF_ITFS && !state_due; ++i)
+    {
+      state_due =
+        is_changed(reference_interfaces_[i], last_published_state_[nr_wheels + i], threshold);
+    }
+    state_due = state_due ||
+                (state_publish_scheduler_.period() > 0 && state_publish_scheduler_.isDue(time_ns));
+  }
+  else if (controller_state_publisher_)
+  {
+    state_due = state_publish_scheduler_.isDue(time_ns);
+  }
+
+  if (state_due)
+  {
+    const bool published = try_publish(
+      *controller_state_publisher_,
+      [&](ControllerStateMsg & msg)
+      {
+        msg.header.stamp = time;
+        // The state message is defined for the classic 4 wheel base only
+        if (wheel_velocities_.size() == NR_STATE_ITFS)
+        {
+          msg.front_left_wheel_velocity = wheel_velocities_[0];
+          msg.back_left_wheel_velocity = wheel_velocities_[1];
+          msg.back_right_wheel_velocity = wheel_velocities_[2];
+          msg.front_right_wheel_velocity = wheel_velocities_[3];
+        }
+        msg.reference_velocity.linear.x = reference_interfaces_[0];
+        msg.reference_velocity.linear.y = reference_interfaces_[1];
+        msg.reference_velocity.angular.z = reference_interfaces_[2];
+      });
+    if (published)
+    {
+      state_publish_scheduler_.published(time_ns);
+      std::copy(wheel_velocities_.begin(), wheel_velocities_.end(), last_published_state_.begin());
+      std::copy(
+        reference_interfaces_.begin(), reference_interfaces_.end(),
+        last_published_state_.begin() + static_cast<std::ptrdiff_t>(wheel_velocities_.size()));
+    }
+    else
+    {
+      cycle_statistics_.count(CycleEvent::DROPPED_STATE_PUBLISH);
+    }
+  }
+  cycle_statistics_.stopPhase(CyclePhase::PUBLISHING);
+
+  // Publish cycle statistics of the last window, then start a new one
+  if (
+    diagnostics_publisher_ && diagnostics_publish_scheduler_.isDue(time_ns) &&
+    diagnostics_publisher_->trylock())
+  {
+    diagnostics_publisher_->msg_.header.stamp = time;
+    fill_diagnostics(diagnostics_publisher_->msg_);
+    diagnostics_publisher_->unlockAndPublish();
+    diagnostics_publish_scheduler_.published(time_ns);
+    cycle_statistics_.resetHistograms();
+    reference_latency_.resetHistogram();
+    measurement_latency_.resetHistogram();
+  }
+
+  if (slip_publisher_ && slip_publish_scheduler_.isDue(time_ns) && slip_publisher_->trylock())
   {
-    rt_tf_odom_state_publisher_->msg_.transforms.front().header.stamp = time;
-    rt_tf_odom_state_publisher_->msg_.transforms.front().transform.translation.x = odometry_.getX();
-    rt_tf_odom_state_publisher_->msg_.transforms.front().transform.translation.y = odometry_.getY();
-    rt_tf_odom_state_publisher_->msg_.transforms.front().transform.rotation =
-      tf2::toMsg(orientation);
-    rt_tf_odom_state_publisher_->unlockAndPublish();
+    slip_publisher_->msg_.header.stamp = time;
+    fill_slip_state(slip_publisher_->msg_);
+    slip_publisher_->unlockAndPublish();
+    slip_publish_scheduler_.published(time_ns);
   }
 
-  if (controller_state_publisher_->trylock())
+  if (
+    calibration_publisher_ && calibration_publish_scheduler_.isDue(time_ns) &&
+    calibration_publisher_->trylock())
   {
-    controller_state_publisher_->msg_.header.stamp = get_node()->now();
-    controller_state_publisher_->msg_.front_left_wheel_velocity = state_interfaces_[0].get_value();
-    controller_state_publisher_->msg_.back_left_wheel_velocity = state_interfaces_[1].get_value();
-    controller_state_publisher_->msg_.back_right_wheel_velocity = state_interfaces_[2].get_value();
-    controller_state_publisher_->msg_.front_right_wheel_velocity = state_interfaces_[3].get_value();
-    controller_state_publisher_->msg_.reference_velocity.linear.x = reference_interfaces_[0];
-    controller_state_publisher_->msg_.reference_velocity.linear.y = reference_interfaces_[1];
-    controller_state_publisher_->msg_.reference_velocity.angular.z = reference_interfaces_[2];
-    controller_state_publisher_->unlockAndPublish();
+    fill_calibration(calibration_publisher_->msg_);
+    calibration_publisher_->unlockAndPublish();
+    calibration_publish_scheduler_.published(time_ns);
+  }
+
+  if (flight_recorder_.isOpen())
+  {
+    record_cycle(time);
   }
 
   reference_interfaces_[0] = std::numeric_limits<double>::quiet_NaN();
@@ -477,6 +1415,113 @@ controller_interface::return_type MecanumDriveController::update_and_write_comma
   return controller_interface::return_type::OK;
 }
 
+void MecanumDriveController::fill_diagnostics(DiagnosticsMsg & msg)
+{
+  // the values are written into strings reserved at configure, so no allocation happens here
+  char buffer[DIAGNOSTICS_VALUE_CAPACITY];
+  auto set_value = [&buffer](std::string & value, long long number)
+  {
+    const int length = std::snprintf(buffer, sizeof(buffer), "%lld", number);
+    value.assign(buffer, static_cast<size_t>(std::max(length, 0)));
+  };
+
+  auto value = msg.status.front().values.begin();
+  for (size_t i = 0; i < CycleStatistics::NR_PHASES; ++i)
+  {
+    const auto & histogram = cycle_statistics_.histogram(static_cast<CyclePhase>(i));
+    set_value((value++)->value, histogram.min());
+    set_value((value++)->value, histogram.mean());
+    set_value((value++)->value, histogram.percentile(0.99));
+    set_value((value++)->value, histogram.max());
+    set_value((value++)->value, static_cast<long long>(histogram.count()));
+  }
+  for (size_t i = 0; i < CycleStatistics::NR_EVENTS; ++i)
+  {
+    const auto event = static_cast<CycleEvent>(i);
+    set_value((value++)->value, static_cast<long long>(cycle_statistics_.events(event)));
+  }
+
+  if (msg.status.size() > 1)
+  {
+    value = msg.status.back().values.begin();
+    for (const LatencyEstimator * latency : {&reference_latency_, &measurement_latency_})
+    {
+      const auto & histogram = latency->histogram();
+      set_value((value++)->value, histogram.min());
+      set_value((value++)->value, histogram.mean());
+      set_value((value++)->value, histogram.percentile(0.99));
+      set_value((value++)->value, histogram.max());
+      set_value((value++)->value, static_cast<long long>(histogram.count()));
+      set_value((value++)->value, std::llround(latency->latency()));
+      set_value((value++)->value, std::llround(latency->jitter()));
+      set_value((value++)->value, static_cast<long long>(latency->negativeSamples()));
+    }
+  }
+}
+
+void MecanumDriveController::record_cycle(const rclcpp::Time & time)
+{
+  // record layout as documented in FlightRecorderHeader
+  const size_t nr_wheels = wheel_velocities_.size();
+  double * value = flight_record_.data();
+  for (size_t i = 0; i < nr_wheels; ++i)
+  {
+    *value++ = wheel_velocities_[i];
+  }
+  for (size_t i = 0; i < nr_wheels; ++i)
+  {
+    *value++ = command_interfaces_[i].get_value();
+  }
+  for (size_t i = 0; i < NR_REF_ITFS; ++i)
+  {
+    *value++ = reference_interfaces_[i];
+  }
+  *value++ = odometry_.getX();
+  *value++ = odometry_.getY();
+  *value++ = odometry_.getRz();
+  *value++ = odometry_.getVx();
+  *value++ = odometry_.getVy();
+  *value++ = odometry_.getWz();
+  flight_recorder_.write(time.nanoseconds(), flight_record_.data());
+}
+
+void MecanumDriveController::fill_slip_state(SlipStateMsg & msg)
+{
+  const auto & residuals = slip_detector_.residuals();
+  const auto & innovations = slip_detector_.innovations();
+  const auto & slip_events = slip_detector_.slipEvents();
+  for (size_t i = 0; i < msg.interface_values.size(); ++i)
+  {
+    auto & values = msg.interface_values[i].values;
+    values[0] = residuals[i];
+    values[1] = innovations[i];
+    values[2] = slip_detector_.slippingWheel() == i ? 1.0 : 0.0;
+    values[3] = static_cast<double>(slip_events[i]);
+  }
+}
+
+void MecanumDriveController::fill_calibration(CalibrationMsg & msg)
+{
+  // the values are written into strings reserved at configure, so no allocation happens here
+  char buffer[DIAGNOSTICS_VALUE_CAPACITY];
+  auto set_value = [&buffer](std::string & value, const char * format, auto number)
+  {
+    const int length = std::snprintf(buffer, sizeof(buffer), format, number);
+    value.assign(buffer, static_cast<size_t>(std::max(length, 0)));
+  };
+
+  const auto estimate = calibration_.estimate();
+  auto value = msg.values.begin();
+  set_value((value++)->value, "%.6g", estimate.wheels_radius);
+  set_value((value++)->value, "%.6g", estimate.sum_of_robot_center_projection_on_X_Y_axis);
+  set_value((value++)->value, "%.6g", estimate.linear_scale);
+  set_value((value++)->value, "%.6g", estimate.angular_scale);
+  set_value((value++)->value, "%.3g", estimate.linear_variance);
+  set_value((value++)->value, "%.3g", estimate.angular_variance);
+  set_value((value++)->value, "%zu", estimate.nr_linear_samples);
+  set_value((value++)->value, "%zu", estimate.nr_angular_samples);
+}
+
 }  // namespace mecanum_drive_controller
 
 #include "pluginlib/class_list_macros.hpp"
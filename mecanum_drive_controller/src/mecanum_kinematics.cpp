@@ -0,0 +1,224 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+
+#include <cmath>
+
+namespace
+{
+// Threshold under which the wheels are considered not to span the planar twist space
+constexpr double SINGULARITY_THRESHOLD = 1e-12;
+}  // namespace
+
+namespace mecanum_drive_controller
+{
+MecanumKinematics::MecanumKinematics() : base_frame_offset_({0.0, 0.0, 0.0}) {}
+
+bool MecanumKinematics::configure(
+  double sum_of_robot_center_projection_on_X_Y_axis, double wheels_radius,
+  const Twist & base_frame_offset)
+{
+  const double lxly = sum_of_robot_center_projection_on_X_Y_axis;
+
+  /// \note Mecanum IK at the center frame, rows front_left, back_left, back_right, front_right:
+  /// 1 / wheels_radius * [1, -1, -lxly; 1, 1, -lxly; 1, -1, lxly; 1, 1, lxly]
+  center_ik_ = {
+    {1.0 / wheels_radius, -1.0 / wheels_radius, -lxly / wheels_radius},
+    {1.0 / wheels_radius, 1.0 / wheels_radius, -lxly / wheels_radius},
+    {1.0 / wheels_radius, -1.0 / wheels_radius, lxly / wheels_radius},
+    {1.0 / wheels_radius, 1.0 / wheels_radius, lxly / wheels_radius},
+  };
+  base_frame_offset_ = base_frame_offset;
+
+  return build();
+}
+
+bool MecanumKinematics::configure(
+  const std::vector<WheelGeometry> & wheels, const Twist & base_frame_offset)
+{
+  center_ik_.clear();
+  center_ik_.reserve(wheels.size());
+  for (const auto & wheel : wheels)
+  {
+    const double sin_roller = std::sin(wheel.roller_angle);
+    if (std::abs(sin_roller) < SINGULARITY_THRESHOLD || wheel.radius <= 0.0)
+    {
+      center_ik_.clear();
+      return false;
+    }
+    /// \note The wheel has to provide the component of the contact point velocity
+    /// (vx - wz * y, vy + wz * x) which is not absorbed by the free rolling rollers.
+    const double cot_roller = std::cos(wheel.roller_angle) / sin_roller;
+    center_ik_.push_back(
+      {1.0 / wheel.radius, cot_roller / wheel.radius,
+       (-wheel.position_y + wheel.position_x * cot_roller) / wheel.radius});
+  }
+  base_frame_offset_ = base_frame_offset;
+
+  return build();
+}
+
+bool MecanumKinematics::setBaseFrameOffset(const Twist & base_frame_offset)
+{
+  base_frame_offset_ = base_frame_offset;
+  return build();
+}
+
+bool MecanumKinematics::setDownweightedWheelWeight(double weight)
+{
+  downweighted_wheel_weight_ = weight;
+  return build();
+}
+
+bool MecanumKinematics::build()
+{
+  const size_t nr_wheels = center_ik_.size();
+  const double cos_theta = std::cos(base_frame_offset_[2]);
+  const double sin_theta = std::sin(base_frame_offset_[2]);
+
+  /// \note The matrices are composed of:
+  /// T: transformation of a body twist from the base frame to the center frame
+  ///    [c, -s, y_off; s, c, -x_off; 0, 0, 1]
+  /// J: wheels Jacobian at the center frame (center_ik_)
+  /// IK = J * T and FK = T^-1 * pinv(J), with pinv(J) = (J^T * J)^-1 * J^T.
+  const std::array<Twist, NR_TWIST_COMPONENTS> t = {{
+    {cos_theta, -sin_theta, base_frame_offset_[1]},
+    {sin_theta, cos_theta, -base_frame_offset_[0]},
+    {0.0, 0.0, 1.0},
+  }};
+
+  const std::vector<double> weights(nr_wheels, 1.0);
+  if (nr_wheels < NR_TWIST_COMPONENTS || !buildForward(weights, fk_))
+  {
+    ik_.clear();
+    for (auto & fk_row : fk_)
+    {
+      fk_row.clear();
+    }
+    downweighted_fk_.clear();
+    return false;
+  }
+
+  ik_.resize(nr_wheels);
+  for (size_t w = 0; w < nr_wheels; ++w)
+  {
+    for (size_t i = 0; i < NR_TWIST_COMPONENTS; ++i)
+    {
+      ik_[w][i] = 0.0;
+      for (size_t k = 0; k < NR_TWIST_COMPONENTS; ++k)
+      {
+        ik_[w][i] += center_ik_[w][k] * t[k][i];
+      }
+    }
+  }
+
+  // FK with one wheel downweighted, the unweighted FK if the other wheels alone are singular
+  downweighted_fk_.resize(nr_wheels);
+  for (size_t w = 0; w < nr_wheels; ++w)
+  {
+    std::vector<double> downweighted = weights;
+    downweighted[w] = downweighted_wheel_weight_;
+    if (!buildForward(downweighted, downweighted_fk_[w]))
+    {
+      downweighted_fk_[w] = fk_;
+    }
+  }
+
+  return true;
+}
+
+bool MecanumKinematics::buildForward(
+  const std::vector<double> & weights, ForwardMatrix & fk) const
+{
+  const size_t nr_wheels = center_ik_.size();
+  const double cos_theta = std::cos(base_frame_offset_[2]);
+  const double sin_theta = std::sin(base_frame_offset_[2]);
+
+  /// \note Weighted least squares FK = T^-1 * (J^T * W * J)^-1 * J^T * W, W = diag(weights)
+  const std::array<Twist, NR_TWIST_COMPONENTS> t_inv = {{
+    {cos_theta, sin_theta, sin_theta * base_frame_offset_[0] - cos_theta * base_frame_offset_[1]},
+    {-sin_theta, cos_theta, cos_theta * base_frame_offset_[0] + sin_theta * base_frame_offset_[1]},
+    {0.0, 0.0, 1.0},
+  }};
+
+  // J^T * W * J
+  std::array<Twist, NR_TWIST_COMPONENTS> jtj;
+  for (auto & jtj_row : jtj)
+  {
+    jtj_row.fill(0.0);
+  }
+  for (size_t w = 0; w < nr_wheels; ++w)
+  {
+    const auto & row = center_ik_[w];
+    for (size_t i = 0; i < NR_TWIST_COMPONENTS; ++i)
+    {
+      for (size_t j = 0; j < NR_TWIST_COMPONENTS; ++j)
+      {
+        jtj[i][j] += weights[w] * row[i] * row[j];
+      }
+    }
+  }
+
+  // (J^T * W * J)^-1 using the adjugate
+  const double det = jtj[0][0] * (jtj[1][1] * jtj[2][2] - jtj[1][2] * jtj[2][1]) -
+                     jtj[0][1] * (jtj[1][0] * jtj[2][2] - jtj[1][2] * jtj[2][0]) +
+                     jtj[0][2] * (jtj[1][0] * jtj[2][1] - jtj[1][1] * jtj[2][0]);
+  if (!(std::abs(det) >= SINGULARITY_THRESHOLD))
+  {
+    return false;
+  }
+  const std::array<Twist, NR_TWIST_COMPONENTS> jtj_inv = {{
+    {(jtj[1][1] * jtj[2][2] - jtj[1][2] * jtj[2][1]) / det,
+     (jtj[0][2] * jtj[2][1] - jtj[0][1] * jtj[2][2]) / det,
+     (jtj[0][1] * jtj[1][2] - jtj[0][2] * jtj[1][1]) / det},
+    {(jtj[1][2] * jtj[2][0] - jtj[1][0] * jtj[2][2]) / det,
+     (jtj[0][0] * jtj[2][2] - jtj[0][2] * jtj[2][0]) / det,
+     (jtj[0][2] * jtj[1][0] - jtj[0][0] * jtj[1][2]) / det},
+    {(jtj[1][0] * jtj[2][1] - jtj[1][1] * jtj[2][0]) / det,
+     (jtj[0][1] * jtj[2][0] - jtj[0][0] * jtj[2][1]) / det,
+     (jtj[0][0] * jtj[1][1] - jtj[0][1] * jtj[1][0]) / det},
+  }};
+
+  // T^-1 * (J^T * W * J)^-1
+  std::array<Twist, NR_TWIST_COMPONENTS> t_inv_jtj_inv;
+  for (size_t i = 0; i < NR_TWIST_COMPONENTS; ++i)
+  {
+    for (size_t j = 0; j < NR_TWIST_COMPONENTS; ++j)
+    {
+      t_inv_jtj_inv[i][j] = 0.0;
+      for (size_t k = 0; k < NR_TWIST_COMPONENTS; ++k)
+      {
+        t_inv_jtj_inv[i][j] += t_inv[i][k] * jtj_inv[k][j];
+      }
+    }
+  }
+
+  for (size_t i = 0; i < NR_TWIST_COMPONENTS; ++i)
+  {
+    fk[i].resize(nr_wheels);
+    for (size_t w = 0; w < nr_wheels; ++w)
+    {
+      fk[i][w] = 0.0;
+      for (size_t k = 0; k < NR_TWIST_COMPONENTS; ++k)
+      {
+        fk[i][w] += t_inv_jtj_inv[i][k] * center_ik_[w][k] * weights[w];
+      }
+    }
+  }
+
+  return true;
+}
+
+}  // namespace mecanum_drive_controller
@@ -14,25 +14,13 @@
 
 #include "mecanum_drive_controller/odometry.hpp"
 
-#include "tf2/transform_datatypes.h"
-#include "tf2_geometry_msgs/tf2_geometry_msgs.hpp"
-
 namespace mecanum_drive_controller
 {
 Odometry::Odometry()
 : timestamp_(0.0),
-  position_x_in_base_frame_(0.0),
-  position_y_in_base_frame_(0.0),
-  orientation_z_in_base_frame_(0.0),
-  velocity_in_base_frame_linear_x(0.0),
-  velocity_in_base_frame_linear_y(0.0),
-  velocity_in_base_frame_angular_z(0.0),
+  base_frame_offset_({0.0, 0.0, 0.0}),
   sum_of_robot_center_projection_on_X_Y_axis_(0.0),
-  wheels_radius_(0.0),
-  velocity_rolling_window_size_(10),
-  linear_x_accumulator_(10),
-  linear_y_accumulator_(10),
-  angular_accumulator_(10)
+  wheels_radius_(0.0)
 {
 }
 
@@ -46,13 +34,12 @@ void Odometry::init(
   base_frame_offset_[0] = base_frame_offset[0];
   base_frame_offset_[1] = base_frame_offset[1];
   base_frame_offset_[2] = base_frame_offset[2];
+  kinematics_.setBaseFrameOffset(base_frame_offset_);
 
   resetAccumulators();
 }
 
-bool Odometry::update(
-  double wheel_front_left_vel, double wheel_back_left_vel, double wheel_back_right_vel,
-  double wheel_front_right_vel, const double dt)
+bool Odometry::update(const std::vector<double> & wheel_velocities, const double dt)
 {
   /// We cannot estimate the speed with very small time intervals:
   // const double dt = (time - timestamp_).toSec();
@@ -61,68 +48,44 @@ bool Odometry::update(
   /// Compute FK (i.e. compute mobile robot's body twist out of its wheels velocities):
   /// NOTE: the mecanum IK gives the body speed at the center frame, we then offset this velocity
   ///       at the base frame.
-  /// NOTE: in the diff drive the velocity is filtered out, but we prefer to return it raw and
-  ///       let the user perform post-processing at will.
-  ///       We prefer this way of doing as filtering introduces delay (which makes it difficult
-  ///       to interpret and compare behavior curves).
-
-  /// \note The variables meaning:
-  /// angular_transformation_from_center_2_base: Rotation transformation matrix, to transform
-  /// from center frame to base frame
-  /// linear_transformation_from_center_2_base: offset/linear transformation matrix,
-  /// to transform from center frame to base frame
-
-  double velocity_in_center_frame_linear_x =
-    0.25 * wheels_radius_ *
-    (wheel_front_left_vel + wheel_back_left_vel + wheel_back_right_vel + wheel_front_right_vel);
-  double velocity_in_center_frame_linear_y =
-    0.25 * wheels_radius_ *
-    (-wheel_front_left_vel + wheel_back_left_vel - wheel_back_right_vel + wheel_front_right_vel);
-  double velocity_in_center_frame_angular_z =
-    0.25 * wheels_radius_ / sum_of_robot_center_projection_on_X_Y_axis_ *
-    (-wheel_front_left_vel - wheel_back_left_vel + wheel_back_right_vel + wheel_front_right_vel);
-
-  tf2::Quaternion orientation_R_c_b;
-  orientation_R_c_b.setRPY(0.0, 0.0, -base_frame_offset_[2]);
-
-  tf2::Matrix3x3 angular_transformation_from_center_2_base = tf2::Matrix3x3((orientation_R_c_b));
-  tf2::Vector3 velocity_in_center_frame_w_r_t_base_frame_ =
-    angular_transformation_from_center_2_base *
-    tf2::Vector3(velocity_in_center_frame_linear_x, velocity_in_center_frame_linear_y, 0.0);
-  tf2::Vector3 linear_transformation_from_center_2_base =
-    angular_transformation_from_center_2_base *
-    tf2::Vector3(-base_frame_offset_[0], -base_frame_offset_[1], 0.0);
-
-  velocity_in_base_frame_linear_x =
-    velocity_in_center_frame_w_r_t_base_frame_.x() +
-    linear_transformation_from_center_2_base.y() * velocity_in_center_frame_angular_z;
-  velocity_in_base_frame_linear_y =
-    velocity_in_center_frame_w_r_t_base_frame_.y() -
-    linear_transformation_from_center_2_base.x() * velocity_in_center_frame_angular_z;
-  velocity_in_base_frame_angular_z = velocity_in_center_frame_angular_z;
+  /// NOTE: the pose is integrated from the raw velocity, as filtering introduces delay. Only the
+  ///       returned twist is filtered, by default it is raw as well (see setTwistFilter()).
+
+  /// The FK matrix already contains the transformation from the center to the base frame.
+  MecanumKinematics::Twist velocity_in_base_frame;
+  kinematics_.forward(wheel_velocities, velocity_in_base_frame);
+
+  return updateFromVelocity(
+    velocity_in_base_frame[0], velocity_in_base_frame[1], velocity_in_base_frame[2], dt);
+}
+
+bool Odometry::updateFromVelocity(
+  const double linear_x, const double linear_y, const double angular_z, const double dt)
+{
+  if (dt < 0.0001) return false;  // Interval too small to integrate with
+
+  twist_filter_.filter({linear_x, linear_y, angular_z}, dt);
 
   /// Integration.
   /// NOTE: the position is expressed in the odometry frame , unlike the twist which is
   ///       expressed in the body frame.
-  
-  angular_accumulator_.accumulate(velocity_in_base_frame_angular_z * dt);
-  orientation_z_in_base_frame_ += angular_accumulator_.getRollingMean();
-  // orientation_z_in_base_frame_ += velocity_in_base_frame_angular_z * dt;
-
-  tf2::Quaternion orientation_R_b_odom;
-  orientation_R_b_odom.setRPY(0.0, 0.0, -base_frame_offset_[2]+orientation_z_in_base_frame_);
-
-  tf2::Matrix3x3 angular_transformation_from_base_2_odom = tf2::Matrix3x3((orientation_R_b_odom));
-  tf2::Vector3 velocity_in_base_frame_w_r_t_odom_frame_ =
-    angular_transformation_from_base_2_odom *
-    tf2::Vector3(velocity_in_base_frame_linear_x, velocity_in_base_frame_linear_y, 0.0);
-
-  linear_x_accumulator_.accumulate(velocity_in_base_frame_w_r_t_odom_frame_.x()* dt);
-  linear_y_accumulator_.accumulate(velocity_in_base_frame_w_r_t_odom_frame_.y()* dt);
-  position_x_in_base_frame_ += linear_x_accumulator_.getRollingMean();
-  position_y_in_base_frame_ += linear_y_accumulator_.getRollingMean();
-  // position_x_in_base_frame_ += velocity_in_base_frame_w_r_t_odom_frame_.x() * dt;
-  // position_y_in_base_frame_ += velocity_in_base_frame_w_r_t_odom_frame_.y() * dt;
+  /// The method is a template parameter of the kernel, so each case is inlined separately.
+  switch (integration_method_)
+  {
+    case IntegrationMethod::RUNGE_KUTTA_2:
+      integration_kernel_.integrate<RungeKutta2Integration>(
+        linear_x, linear_y, angular_z, dt, -base_frame_offset_[2]);
+      break;
+    case IntegrationMethod::EXACT:
+      integration_kernel_.integrate<ExactIntegration>(
+        linear_x, linear_y, angular_z, dt, -base_frame_offset_[2]);
+      break;
+    case IntegrationMethod::EULER:
+    default:
+      integration_kernel_.integrate<EulerIntegration>(
+        linear_x, linear_y, angular_z, dt, -base_frame_offset_[2]);
+      break;
+  }
 
   return true;
 }
@@ -132,13 +95,19 @@ void Odometry::setWheelsParams(
 {
   sum_of_robot_center_projection_on_X_Y_axis_ = sum_of_robot_center_projection_on_X_Y_axis;
   wheels_radius_ = wheels_radius;
+  kinematics_.configure(
+    sum_of_robot_center_projection_on_X_Y_axis_, wheels_radius_, base_frame_offset_);
+}
+
+bool Odometry::setWheelsGeometry(const std::vector<MecanumKinematics::WheelGeometry> & wheels)
+{
+  return kinematics_.configure(wheels, base_frame_offset_);
 }
 
 void Odometry::resetAccumulators()
 {
-  linear_x_accumulator_ = RollingMeanAccumulator(velocity_rolling_window_size_);
-  linear_y_accumulator_ = RollingMeanAccumulator(velocity_rolling_window_size_);
-  angular_accumulator_ = RollingMeanAccumulator(velocity_rolling_window_size_);
+  integration_kernel_.reset();
+  twist_filter_.reset();
 }
 
 }  // namespace mecanum_drive_controller
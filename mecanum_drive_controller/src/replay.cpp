@@ -0,0 +1,448 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mecanum_drive_controller/replay.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#include "mecanum_drive_controller/flight_recorder.hpp"
+#include "mecanum_drive_controller/odometry.hpp"
+
+namespace mecanum_drive_controller
+{
+namespace
+{
+constexpr size_t NR_REFERENCES = WheelLog::NR_REFERENCES;
+
+// Content of a CSV column
+enum class Column
+{
+  IGNORED,
+  STAMP,
+  WHEEL_STATE,
+  WHEEL_COMMAND,
+  REFERENCE
+};
+
+// Parses the wheel index after the prefix of a column name, e.g., 'wheel_state_<i>'. Indices are
+// bounded by the number of columns, as each wheel needs its own state column.
+bool parseWheelIndex(
+  const std::string & name, size_t prefix_length, size_t nr_columns, size_t & index)
+{
+  const char * text = name.c_str() + prefix_length;
+  if (*text < '0' || *text > '9')
+  {
+    return false;
+  }
+  char * end = nullptr;
+  errno = 0;
+  const unsigned long value = std::strtoul(text, &end, 10);  // NOLINT(runtime/int)
+  if (errno != 0 || *end != '\0' || value >= nr_columns)
+  {
+    return false;
+  }
+  index = static_cast<size_t>(value);
+  return true;
+}
+
+bool loadFlightRecorder(const std::string & path, WheelLog & log, std::string & error)
+{
+  FlightRecorderReader reader;
+  if (!reader.open(path, error))
+  {
+    return false;
+  }
+  const size_t nr_wheels = reader.header().nr_wheels;
+  log.nr_wheels = nr_wheels;
+  log.stamps_ns.resize(reader.size());
+  log.wheel_states.resize(reader.size() * nr_wheels);
+  log.wheel_commands.resize(reader.size() * nr_wheels);
+  log.references.resize(reader.size() * NR_REFERENCES);
+
+  std::vector<double> values;
+  for (size_t i = 0; i < reader.size(); ++i)
+  {
+    reader.read(i, log.stamps_ns[i], values);
+    // record layout as documented in FlightRecorderHeader
+    std::copy_n(values.begin(), nr_wheels, log.wheel_states.begin() + i * nr_wheels);
+    std::copy_n(values.begin() + nr_wheels, nr_wheels, log.wheel_commands.begin() + i * nr_wheels);
+    std::copy_n(
+      values.begin() + 2 * nr_wheels, NR_REFERENCES, log.references.begin() + i * NR_REFERENCES);
+  }
+  return true;
+}
+
+bool loadCsv(std::ifstream & file, const std::string & path, WheelLog & log, std::string & error)
+{
+  std::string line;
+  if (!std::getline(file, line))
+  {
+    error = "'" + path + "' is empty";
+    return false;
+  }
+
+  // map the header to the content and index of each column
+  std::vector<Column> columns;
+  std::vector<size_t> indices;
+  size_t nr_references = 0;
+  if (!line.empty() && line.back() == '\r')
+  {
+    line.pop_back();
+  }
+  const size_t nr_columns = static_cast<size_t>(std::count(line.begin(), line.end(), ',')) + 1;
+  size_t start = 0;
+  while (start <= line.size())
+  {
+    size_t end = line.find(',', start);
+    end = end == std::string::npos ? line.size() : end;
+    const std::string name = line.substr(start, end - start);
+    Column column = Column::IGNORED;
+    size_t index = 0;
+    if (name == "stamp_ns")
+    {
+      column = Column::STAMP;
+    }
+    else if (name.rfind("wheel_state_", 0) == 0 || name.rfind("wheel_command_", 0) == 0)
+    {
+      const bool is_state = name.rfind("wheel_state_", 0) == 0;
+      column = is_state ? Column::WHEEL_STATE : Column::WHEEL_COMMAND;
+      const size_t prefix_length = std::strlen(is_state ? "wheel_state_" : "wheel_command_");
+      if (!parseWheelIndex(name, prefix_length, nr_columns, index))
+      {
+        error = "'" + path + "' column " + std::to_string(columns.size() + 1) + ": invalid wheel " +
+                "index in '" + name + "'";
+        return false;
+      }
+      if (is_state)
+      {
+        log.nr_wheels = std::max(log.nr_wheels, index + 1);
+      }
+    }
+    else if (name == "reference_linear_x" || name == "reference_linear_y")
+    {
+      column = Column::REFERENCE;
+      index = name == "reference_linear_x" ? 0 : 1;
+      ++nr_references;
+    }
+    else if (name == "reference_angular_z")
+    {
+      column = Column::REFERENCE;
+      index = 2;
+      ++nr_references;
+    }
+    columns.push_back(column);
+    indices.push_back(index);
+    start = end + 1;
+  }
+  if (
+    std::find(columns.begin(), columns.end(), Column::STAMP) == columns.end() ||
+    log.nr_wheels == 0)
+  {
+    error = "'" + path + "' has no 'stamp_ns' or 'wheel_state_<i>' columns";
+    return false;
+  }
+
+  // each wheel needs exactly one state column, commands are used only if all wheels have one
+  std::vector<size_t> nr_state_columns(log.nr_wheels, 0);
+  std::vector<size_t> nr_command_columns(log.nr_wheels, 0);
+  size_t nr_commands = 0;
+  for (size_t i = 0; i < columns.size(); ++i)
+  {
+    if (columns[i] != Column::WHEEL_STATE && columns[i] != Column::WHEEL_COMMAND)
+    {
+      continue;
+    }
+    if (indices[i] >= log.nr_wheels)
+    {
+      error = "'" + path + "' column " + std::to_string(i + 1) + ": wheel index " +
+              std::to_string(indices[i]) + " has no 'wheel_state_<i>' column";
+      return false;
+    }
+    auto & nr_columns = columns[i] == Column::WHEEL_STATE ? nr_state_columns : nr_command_columns;
+    if (++nr_columns[indices[i]] > 1)
+    {
+      error = "'" + path + "' column " + std::to_string(i + 1) + ": duplicate wheel index " +
+              std::to_string(indices[i]);
+      return false;
+    }
+    nr_commands += columns[i] == Column::WHEEL_COMMAND ? 1 : 0;
+  }
+  const auto missing_state = std::find(nr_state_columns.begin(), nr_state_columns.end(), 0u);
+  if (missing_state != nr_state_columns.end())
+  {
+    error = "'" + path + "' has no 'wheel_state_" +
+            std::to_string(missing_state - nr_state_columns.begin()) + "' column";
+    return false;
+  }
+  const bool has_commands = nr_commands == log.nr_wheels;
+  const bool has_references = nr_references == NR_REFERENCES;
+
+  size_t line_number = 1;
+  while (std::getline(file, line))
+  {
+    ++line_number;
+    if (line.empty() || line == "\r")
+    {
+      continue;
+    }
+    const size_t row = log.size();
+    log.stamps_ns.push_back(0);
+    log.wheel_states.resize((row + 1) * log.nr_wheels, std::numeric_limits<double>::quiet_NaN());
+    if (has_commands)
+    {
+      log.wheel_commands.resize((row + 1) * log.nr_wheels);
+    }
+    if (has_references)
+    {
+      log.references.resize((row + 1) * NR_REFERENCES);
+    }
+
+    const char * cursor = line.c_str();
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+      char * end = nullptr;
+      if (columns[i] == Column::STAMP)
+      {
+        log.stamps_ns[row] = std::strtoll(cursor, &end, 10);
+      }
+      else
+      {
+        const double value = std::strtod(cursor, &end);
+        if (columns[i] == Column::WHEEL_STATE)
+        {
+          log.wheel_states[row * log.nr_wheels + indices[i]] = value;
+        }
+        else if (columns[i] == Column::WHEEL_COMMAND && has_commands)
+        {
+          log.wheel_commands[row * log.nr_wheels + indices[i]] = value;
+        }
+        else if (columns[i] == Column::REFERENCE && has_references)
+        {
+          log.references[row * NR_REFERENCES + indices[i]] = value;
+        }
+      }
+      if (end == cursor || (*end != ',' && *end != '\0' && *end != '\r'))
+      {
+        error = "'" + path + "' line " + std::to_string(line_number) + ": malformed column " +
+                std::to_string(i + 1);
+        return false;
+      }
+      cursor = *end == ',' ? end + 1 : end;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void WheelLog::clear()
+{
+  nr_wheels = 0;
+  stamps_ns.clear();
+  wheel_states.clear();
+  wheel_commands.clear();
+  references.clear();
+}
+
+bool loadWheelLog(const std::string & path, WheelLog & log, std::string & error)
+{
+  log.clear();
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+  {
+    error = "cannot open '" + path + "'";
+    return false;
+  }
+
+  uint64_t magic = 0;
+  if (file.read(reinterpret_cast<char *>(&magic), sizeof(magic)) &&
+      magic == FlightRecorderHeader::MAGIC)
+  {
+    file.close();
+    return loadFlightRecorder(path, log, error);
+  }
+  file.clear();
+  file.seekg(0);
+  return loadCsv(file, path, log, error);
+}
+
+bool replay(
+  const WheelLog & log, const ReplayParameters & parameters, ReplayResult & result,
+  std::string & error)
+{
+  result = ReplayResult();
+
+  // same setup as in MecanumDriveController::on_configure
+  MecanumKinematics kinematics;
+  Odometry odometry;
+  bool kinematics_valid = false;
+  if (!parameters.wheels_geometry.empty())
+  {
+    if (parameters.wheels_geometry.size() != log.nr_wheels)
+    {
+      error = "the geometry of " + std::to_string(parameters.wheels_geometry.size()) +
+              " wheels does not match the " + std::to_string(log.nr_wheels) + " wheels of the log";
+      return false;
+    }
+    std::vector<MecanumKinematics::WheelGeometry> wheels = parameters.wheels_geometry;
+    for (auto & wheel : wheels)
+    {
+      wheel.radius = wheel.radius > 0.0 ? wheel.radius : parameters.wheels_radius;
+    }
+    kinematics_valid = kinematics.configure(wheels, parameters.base_frame_offset) &&
+                       odometry.setWheelsGeometry(wheels);
+  }
+  else
+  {
+    if (log.nr_wheels != MecanumKinematics::NR_DEFAULT_WHEELS)
+    {
+      error = "a log of " + std::to_string(log.nr_wheels) +
+              " wheels needs the geometry of each wheel";
+      return false;
+    }
+    kinematics_valid = kinematics.configure(
+      parameters.sum_of_robot_center_projection_on_X_Y_axis, parameters.wheels_radius,
+      parameters.base_frame_offset);
+    odometry.setWheelsParams(
+      parameters.sum_of_robot_center_projection_on_X_Y_axis, parameters.wheels_radius);
+  }
+  if (!kinematics_valid)
+  {
+    error = "the kinematic parameters do not describe a valid base";
+    return false;
+  }
+  odometry.init(rclcpp::Time(0), parameters.base_frame_offset);
+  odometry.setIntegrationMethod(parameters.integration_method);
+
+  const bool replay_commands = !log.references.empty() && !log.wheel_commands.empty();
+  std::vector<double> wheel_velocities(log.nr_wheels);
+  std::vector<double> wheel_commands(log.nr_wheels);
+  MecanumKinematics::Twist body_twist;
+  MecanumKinematics::Twist reference;
+  double squared_command_error = 0.0;
+  size_t nr_commands = 0;
+
+  for (size_t i = 1; i < log.size(); ++i)
+  {
+    const double * wheel_states = log.wheel_states.data() + i * log.nr_wheels;
+    bool wheel_velocities_valid = true;
+    for (size_t j = 0; j < log.nr_wheels; ++j)
+    {
+      wheel_velocities[j] = wheel_states[j];
+      wheel_velocities_valid = wheel_velocities_valid && !std::isnan(wheel_states[j]);
+    }
+
+    if (wheel_velocities_valid)
+    {
+      const double previous_x = odometry.getX();
+      const double previous_y = odometry.getY();
+      kinematics.forward(wheel_velocities, body_twist);
+      const double dt = static_cast<double>(log.stamps_ns[i] - log.stamps_ns[i - 1]) * 1e-9;
+      if (odometry.updateFromVelocity(body_twist[0], body_twist[1], body_twist[2], dt))
+      {
+        result.path_length +=
+          std::hypot(odometry.getX() - previous_x, odometry.getY() - previous_y);
+        ++result.nr_integrated;
+      }
+    }
+    else
+    {
+      ++result.nr_skipped;
+    }
+
+    if (replay_commands)
+    {
+      std::copy_n(log.references.data() + i * NR_REFERENCES, NR_REFERENCES, reference.begin());
+      if (!std::isnan(reference[0]) && !std::isnan(reference[1]) && !std::isnan(reference[2]))
+      {
+        kinematics.inverse(reference, wheel_commands);
+        const double * recorded_commands = log.wheel_commands.data() + i * log.nr_wheels;
+        for (size_t j = 0; j < log.nr_wheels; ++j)
+        {
+          const double difference = wheel_commands[j] - recorded_commands[j];
+          squared_command_error += difference * difference;
+        }
+        nr_commands += log.nr_wheels;
+      }
+    }
+  }
+
+  result.x = odometry.getX();
+  result.y = odometry.getY();
+  result.theta = odometry.getRz();
+  result.command_rms_error = nr_commands > 0
+                               ? std::sqrt(squared_command_error / nr_commands)
+                               : std::numeric_limits<double>::quiet_NaN();
+  return true;
+}
+
+std::vector<ReplayFileResult> replayFiles(
+  const std::vector<std::string> & files, const std::vector<ReplayParameters> & parameter_sets,
+  size_t nr_threads)
+{
+  std::vector<ReplayFileResult> file_results(files.size());
+  std::atomic<size_t> next_file{0};
+
+  auto worker = [&]()
+  {
+    // the log is reused, so a worker allocates only for its largest file
+    WheelLog log;
+    for (size_t i = next_file++; i < files.size(); i = next_file++)
+    {
+      ReplayFileResult & file_result = file_results[i];
+      file_result.file = files[i];
+      if (!loadWheelLog(files[i], log, file_result.error))
+      {
+        continue;
+      }
+      file_result.nr_cycles = log.size();
+      file_result.results.resize(parameter_sets.size());
+      for (size_t j = 0; j < parameter_sets.size() && file_result.error.empty(); ++j)
+      {
+        std::string error;
+        if (!replay(log, parameter_sets[j], file_result.results[j], error))
+        {
+          file_result.error = error + " (parameter set " + std::to_string(j) + ")";
+        }
+      }
+    }
+  };
+
+  if (nr_threads == 0)
+  {
+    nr_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  nr_threads = std::min(nr_threads, std::max<size_t>(files.size(), 1));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < nr_threads; ++i)
+  {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto & thread : threads)
+  {
+    thread.join();
+  }
+  return file_results;
+}
+
+}  // namespace mecanum_drive_controller
@@ -0,0 +1,231 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays recorded wheel data through the odometry and IK of the mecanum drive controller for
+// every combination of the given kinematic parameters, and prints the results as CSV.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mecanum_drive_controller/replay.hpp"
+
+namespace
+{
+void print_usage(const char * program)
+{
+  fprintf(
+    stderr,
+    "Usage: %s [options] <file>...\n"
+    "Files are flight recorder files or their CSV conversion.\n"
+    "Options:\n"
+    "  --wheels_radius <values>                                [m], required\n"
+    "  --sum_of_robot_center_projection_on_X_Y_axis <values>   [m], required for 4 wheels\n"
+    "  --wheels_geometry <x>,<y>,<roller_angle>,<radius>,...   per wheel, replaces the sum\n"
+    "  --base_frame_offset <x>,<y>,<theta>                     default 0,0,0\n"
+    "  --integration_method euler|runge_kutta_2|exact          default euler\n"
+    "  --threads <n>                                           default one per core\n"
+    "<values> is a comma separated list of values or ranges <first>:<step>:<last>.\n"
+    "A wheel radius of 0 in --wheels_geometry takes the values of --wheels_radius.\n",
+    program);
+}
+
+// parses e.g. "0.05,0.06" or "0.05:0.001:0.06"
+bool parse_values(const char * text, std::vector<double> & values)
+{
+  values.clear();
+  const char * cursor = text;
+  while (*cursor != '\0')
+  {
+    char * end = nullptr;
+    const double first = std::strtod(cursor, &end);
+    if (end == cursor)
+    {
+      return false;
+    }
+    if (*end == ':')
+    {
+      cursor = end + 1;
+      const double step = std::strtod(cursor, &end);
+      if (end == cursor || *end != ':' || step <= 0.0)
+      {
+        return false;
+      }
+      cursor = end + 1;
+      const double last = std::strtod(cursor, &end);
+      if (end == cursor)
+      {
+        return false;
+      }
+      // counting the steps avoids accumulating rounding errors
+      for (long i = 0; first + i * step <= last + 1e-9 * step; ++i)
+      {
+        values.push_back(first + i * step);
+      }
+    }
+    else
+    {
+      values.push_back(first);
+    }
+    if (*end != ',' && *end != '\0')
+    {
+      return false;
+    }
+    cursor = *end == ',' ? end + 1 : end;
+  }
+  return !values.empty();
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  using mecanum_drive_controller::IntegrationMethod;
+  using mecanum_drive_controller::ReplayParameters;
+
+  std::vector<double> wheels_radii;
+  std::vector<double> sums_of_projections;
+  std::vector<double> base_frame_offset = {0.0, 0.0, 0.0};
+  std::vector<double> wheels_geometry;
+  IntegrationMethod integration_method = IntegrationMethod::EULER;
+  size_t nr_threads = 0;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string argument = argv[i];
+    const bool has_value = i + 1 < argc;
+    bool valid = true;
+    if (argument == "--wheels_radius" && has_value)
+    {
+      valid = parse_values(argv[++i], wheels_radii);
+    }
+    else if (argument == "--sum_of_robot_center_projection_on_X_Y_axis" && has_value)
+    {
+      valid = parse_values(argv[++i], sums_of_projections);
+    }
+    else if (argument == "--wheels_geometry" && has_value)
+    {
+      valid = parse_values(argv[++i], wheels_geometry) && wheels_geometry.size() % 4 == 0;
+    }
+    else if (argument == "--base_frame_offset" && has_value)
+    {
+      valid = parse_values(argv[++i], base_frame_offset) && base_frame_offset.size() == 3;
+    }
+    else if (argument == "--integration_method" && has_value)
+    {
+      const std::string method = argv[++i];
+      if (method == "runge_kutta_2")
+      {
+        integration_method = IntegrationMethod::RUNGE_KUTTA_2;
+      }
+      else if (method == "exact")
+      {
+        integration_method = IntegrationMethod::EXACT;
+      }
+      else
+      {
+        valid = method == "euler";
+      }
+    }
+    else if (argument == "--threads" && has_value)
+    {
+      nr_threads = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (argument.rfind("--", 0) == 0)
+    {
+      valid = false;
+    }
+    else
+    {
+      files.push_back(argument);
+    }
+    if (!valid)
+    {
+      fprintf(stderr, "Invalid argument '%s'\n", argument.c_str());
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (
+    files.empty() || wheels_radii.empty() ||
+    (sums_of_projections.empty() && wheels_geometry.empty()))
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+  if (sums_of_projections.empty())
+  {
+    // not used with the geometry of each wheel
+    sums_of_projections.push_back(0.0);
+  }
+
+  std::vector<ReplayParameters> parameter_sets;
+  for (const double wheels_radius : wheels_radii)
+  {
+    for (const double sum_of_projections : sums_of_projections)
+    {
+      ReplayParameters parameters;
+      parameters.wheels_radius = wheels_radius;
+      parameters.sum_of_robot_center_projection_on_X_Y_axis = sum_of_projections;
+      parameters.base_frame_offset = {
+        base_frame_offset[0], base_frame_offset[1], base_frame_offset[2]};
+      parameters.integration_method = integration_method;
+      for (size_t j = 0; j < wheels_geometry.size(); j += 4)
+      {
+        parameters.wheels_geometry.push_back(
+          {wheels_geometry[j], wheels_geometry[j + 1], wheels_geometry[j + 2],
+           wheels_geometry[j + 3]});
+      }
+      parameter_sets.push_back(parameters);
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto file_results =
+    mecanum_drive_controller::replayFiles(files, parameter_sets, nr_threads);
+  const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+  printf(
+    "file,wheels_radius,sum_of_robot_center_projection_on_X_Y_axis,cycles,skipped_cycles,x,y,"
+    "theta,path_length,command_rms_error\n");
+  int exit_code = 0;
+  size_t nr_replayed_cycles = 0;
+  for (const auto & file_result : file_results)
+  {
+    if (!file_result.error.empty())
+    {
+      fprintf(stderr, "%s: %s\n", file_result.file.c_str(), file_result.error.c_str());
+      exit_code = 1;
+      continue;
+    }
+    for (size_t i = 0; i < parameter_sets.size(); ++i)
+    {
+      const auto & result = file_result.results[i];
+      printf(
+        "%s,%.17g,%.17g,%zu,%zu,%.17g,%.17g,%.17g,%.17g,%.17g\n", file_result.file.c_str(),
+        parameter_sets[i].wheels_radius,
+        parameter_sets[i].sum_of_robot_center_projection_on_X_Y_axis, file_result.nr_cycles,
+        result.nr_skipped, result.x, result.y, result.theta, result.path_length,
+        result.command_rms_error);
+      nr_replayed_cycles += file_result.nr_cycles;
+    }
+  }
+  fprintf(
+    stderr, "Replayed %zu cycles in %.3f s (%.3g cycles/s)\n", nr_replayed_cycles,
+    duration.count(), nr_replayed_cycles / duration.count());
+  return exit_code;
+}
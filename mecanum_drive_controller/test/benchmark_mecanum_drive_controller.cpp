@@ -0,0 +1,188 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of the control loop of the mecanum drive controller.
+// Run by ament_add_google_benchmark, which stores the results as JSON in the test results
+// directory, or directly, e.g. with --benchmark_out=results.json --benchmark_out_format=json.
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hardware_interface/loaned_command_interface.hpp"
+#include "hardware_interface/loaned_state_interface.hpp"
+#include "mecanum_drive_controller/mecanum_drive_controller.hpp"
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+#include "mecanum_drive_controller/odometry.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+using mecanum_drive_controller::MecanumDriveController;
+using mecanum_drive_controller::MecanumKinematics;
+using mecanum_drive_controller::Odometry;
+
+namespace
+{
+constexpr double WHEELS_RADIUS = 0.5;              // [m]
+constexpr double SUM_OF_CENTER_PROJECTIONS = 1.0;  // [m]
+constexpr double CONTROL_PERIOD = 0.001;           // [s], 1 kHz loop
+constexpr int64_t CONTROL_PERIOD_NS = 1000000;     // [ns]
+constexpr double NO_PUBLICATION_RATE = 1e-6;       // [Hz], no publication while measuring
+
+const std::vector<std::string> JOINT_NAMES = {
+  "front_left_wheel_joint", "back_left_wheel_joint", "back_right_wheel_joint",
+  "front_right_wheel_joint"};
+
+// Controller with mock command and state interfaces, configured and activated
+class ControllerSetup
+{
+public:
+  explicit ControllerSetup(bool with_publishers)
+  {
+    controller_ = std::make_unique<MecanumDriveController>();
+    if (controller_->init("test_mecanum_drive_controller") != controller_interface::return_type::OK)
+    {
+      throw std::runtime_error("controller init failed");
+    }
+    if (!with_publishers)
+    {
+      auto node = controller_->get_node();
+      node->set_parameter(rclcpp::Parameter("odom_publish_rate", NO_PUBLICATION_RATE));
+      node->set_parameter(rclcpp::Parameter("state_publish_rate", NO_PUBLICATION_RATE));
+      node->set_parameter(rclcpp::Parameter("enable_odom_tf", false));
+    }
+
+    std::vector<hardware_interface::LoanedCommandInterface> command_ifs;
+    std::vector<hardware_interface::LoanedStateInterface> state_ifs;
+    command_itfs_.reserve(JOINT_NAMES.size());
+    state_itfs_.reserve(JOINT_NAMES.size());
+    for (size_t i = 0; i < JOINT_NAMES.size(); ++i)
+    {
+      command_itfs_.emplace_back(JOINT_NAMES[i], "velocity", &joint_command_values_[i]);
+      command_ifs.emplace_back(command_itfs_.back());
+      state_itfs_.emplace_back(JOINT_NAMES[i], "velocity", &joint_state_values_[i]);
+      state_ifs.emplace_back(state_itfs_.back());
+    }
+    controller_->assign_interfaces(std::move(command_ifs), std::move(state_ifs));
+
+    if (
+      controller_->on_configure(rclcpp_lifecycle::State()) !=
+      controller_interface::CallbackReturn::SUCCESS)
+    {
+      throw std::runtime_error("controller configure failed");
+    }
+    reference_interfaces_ = controller_->export_reference_interfaces();
+    controller_->on_activate(rclcpp_lifecycle::State());
+  }
+
+  MecanumDriveController & controller() { return *controller_; }
+
+  // sets the references like a preceding controller in chained mode
+  void setReferences()
+  {
+    reference_interfaces_[0].set_value(0.5);
+    reference_interfaces_[1].set_value(0.2);
+    reference_interfaces_[2].set_value(0.1);
+  }
+
+private:
+  std::unique_ptr<MecanumDriveController> controller_;
+  std::array<double, 4> joint_state_values_ = {0.1, 0.2, 0.3, 0.4};
+  std::array<double, 4> joint_command_values_ = {0.0, 0.0, 0.0, 0.0};
+  std::vector<hardware_interface::CommandInterface> command_itfs_;
+  std::vector<hardware_interface::StateInterface> state_itfs_;
+  std::vector<hardware_interface::CommandInterface> reference_interfaces_;
+};
+
+}  // namespace
+
+static void BM_OdometryUpdate(benchmark::State & state)
+{
+  Odometry odometry;
+  odometry.setWheelsParams(SUM_OF_CENTER_PROJECTIONS, WHEELS_RADIUS);
+  odometry.init(rclcpp::Time(0), {0.0, 0.0, 0.0});
+  const std::vector<double> wheel_velocities = {0.1, 0.2, 0.3, 0.4};
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(odometry.update(wheel_velocities, CONTROL_PERIOD));
+    benchmark::ClobberMemory();
+  }
+  benchmark::DoNotOptimize(odometry.getX());
+}
+BENCHMARK(BM_OdometryUpdate);
+
+static void BM_InverseKinematics(benchmark::State & state)
+{
+  MecanumKinematics kinematics;
+  kinematics.configure(SUM_OF_CENTER_PROJECTIONS, WHEELS_RADIUS, {0.1, 0.0, 0.0});
+  std::vector<double> wheel_commands(MecanumKinematics::NR_DEFAULT_WHEELS);
+  const MecanumKinematics::Twist twist = {0.5, 0.2, 0.1};
+
+  for (auto _ : state)
+  {
+    kinematics.inverse(twist, wheel_commands);
+    benchmark::DoNotOptimize(wheel_commands.data());
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_InverseKinematics);
+
+static void BM_UpdateReferenceFromSubscribers(benchmark::State & state)
+{
+  ControllerSetup setup(false);
+  auto & controller = setup.controller();
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(controller.update_reference_from_subscribers());
+  }
+}
+BENCHMARK(BM_UpdateReferenceFromSubscribers);
+
+// Full cycle with references set as in chained mode. With argument 1 the odometry, tf and state
+// are published in every cycle, with 0 they are not published
+static void BM_UpdateAndWriteCommands(benchmark::State & state)
+{
+  ControllerSetup setup(state.range(0) != 0);
+  auto & controller = setup.controller();
+  const rclcpp::Duration period = rclcpp::Duration::from_nanoseconds(CONTROL_PERIOD_NS);
+  int64_t time_ns = 0;
+
+  for (auto _ : state)
+  {
+    setup.setReferences();
+    time_ns += CONTROL_PERIOD_NS;
+    benchmark::DoNotOptimize(
+      controller.update_and_write_commands(rclcpp::Time(time_ns, RCL_ROS_TIME), period));
+  }
+}
+BENCHMARK(BM_UpdateAndWriteCommands)->ArgName("publishers")->Arg(0)->Arg(1);
+
+int main(int argc, char ** argv)
+{
+  ::benchmark::Initialize(&argc, argv);
+  // the controller parameters are the ones of the controller tests
+  std::vector<const char *> args(argv, argv + argc);
+  args.insert(args.end(), {"--ros-args", "--params-file", BENCHMARK_PARAMS_FILE});
+  rclcpp::init(static_cast<int>(args.size()), args.data());
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstdint>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/cycle_statistics.hpp"
+
+using mecanum_drive_controller::CycleEvent;
+using mecanum_drive_controller::CyclePhase;
+using mecanum_drive_controller::CycleStatistics;
+using mecanum_drive_controller::DurationHistogram;
+
+TEST(CycleStatisticsTest, when_value_added_expect_it_within_bounds_of_its_bin)
+{
+  for (int64_t value : {0l, 1l, 3l, 4l, 5l, 7l, 8l, 1000l, 1023l, 1024l, 123456789l, 1l << 62})
+  {
+    const size_t index = DurationHistogram::binIndex(value);
+    ASSERT_LT(index, DurationHistogram::NR_BINS);
+    EXPECT_LE(value, DurationHistogram::binUpperBound(index)) << value;
+    if (index > 0)
+    {
+      EXPECT_GT(value, DurationHistogram::binUpperBound(index - 1)) << value;
+    }
+  }
+}
+
+TEST(CycleStatisticsTest, when_samples_added_expect_min_max_mean_and_percentile)
+{
+  DurationHistogram histogram;
+  EXPECT_EQ(histogram.percentile(0.99), 0);
+
+  // 990 cycles of 20 us and 10 outliers of 500 us
+  for (size_t i = 0; i < 990; ++i)
+  {
+    histogram.add(20000);
+  }
+  for (size_t i = 0; i < 10; ++i)
+  {
+    histogram.add(500000);
+  }
+
+  EXPECT_EQ(histogram.count(), 1000u);
+  EXPECT_EQ(histogram.min(), 20000);
+  EXPECT_EQ(histogram.max(), 500000);
+  EXPECT_EQ(histogram.mean(), 24800);
+  // 25% bin resolution
+  EXPECT_GE(histogram.percentile(0.99), 20000);
+  EXPECT_LT(histogram.percentile(0.99), 25000);
+  EXPECT_EQ(histogram.percentile(1.0), 500000);
+
+  histogram.reset();
+  EXPECT_EQ(histogram.count(), 0u);
+  EXPECT_EQ(histogram.max(), 0);
+}
+
+TEST(CycleStatisticsTest, when_histograms_reset_expect_events_kept)
+{
+  CycleStatistics statistics;
+  statistics.addDuration(CyclePhase::ODOMETRY, std::chrono::microseconds(5));
+  {
+    CycleStatistics::ScopedPhase phase(statistics, CyclePhase::UPDATE);
+  }
+  statistics.count(CycleEvent::STALE_REFERENCE);
+  statistics.count(CycleEvent::STALE_REFERENCE);
+
+  if (CycleStatistics::ENABLED)
+  {
+    EXPECT_EQ(statistics.histogram(CyclePhase::ODOMETRY).max(), 5000);
+    EXPECT_EQ(statistics.histogram(CyclePhase::UPDATE).count(), 1u);
+    EXPECT_EQ(statistics.events(CycleEvent::STALE_REFERENCE), 2u);
+  }
+
+  statistics.resetHistograms();
+  EXPECT_EQ(statistics.histogram(CyclePhase::ODOMETRY).count(), 0u);
+  EXPECT_EQ(statistics.histogram(CyclePhase::UPDATE).count(), 0u);
+  EXPECT_EQ(statistics.events(CycleEvent::STALE_REFERENCE), CycleStatistics::ENABLED ? 2u : 0u);
+}
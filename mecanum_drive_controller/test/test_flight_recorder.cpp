@@ -0,0 +1,129 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/flight_recorder.hpp"
+
+using mecanum_drive_controller::FlightRecorder;
+using mecanum_drive_controller::FlightRecorderReader;
+
+class FlightRecorderTest : public ::testing::Test
+{
+public:
+  void SetUp()
+  {
+    path_ = "/tmp/test_flight_recorder_" + std::to_string(::getpid()) + ".bin";
+  }
+
+  void TearDown()
+  {
+    std::remove(path_.c_str());
+    for (const auto & path : rotated_paths_)
+    {
+      std::remove(path.c_str());
+    }
+  }
+
+protected:
+  // record with all values equal to the cycle number
+  static std::vector<double> make_values(size_t nr_values, int64_t cycle)
+  {
+    return std::vector<double>(nr_values, static_cast<double>(cycle));
+  }
+
+  std::string path_;
+  std::vector<std::string> rotated_paths_;
+};
+
+TEST_F(FlightRecorderTest, when_records_written_expect_them_read_back_oldest_first)
+{
+  FlightRecorder recorder;
+  std::string error;
+  ASSERT_TRUE(recorder.open(path_, 4, 10, std::chrono::milliseconds(1), error)) << error;
+  ASSERT_EQ(recorder.nrValues(), 2 * 4 + FlightRecorder::NR_BASE_VALUES);
+
+  // 25 records in a file of 10, the first 15 are overwritten
+  for (int64_t cycle = 0; cycle < 25; ++cycle)
+  {
+    recorder.write(cycle * 1000, make_values(recorder.nrValues(), cycle).data());
+  }
+  recorder.close();
+
+  FlightRecorderReader reader;
+  ASSERT_TRUE(reader.open(path_, error)) << error;
+  EXPECT_EQ(reader.header().nr_wheels, 4u);
+  EXPECT_EQ(reader.header().nr_records, 25u);
+  ASSERT_EQ(reader.size(), 10u);
+
+  int64_t stamp_ns = 0;
+  std::vector<double> values;
+  for (size_t i = 0; i < reader.size(); ++i)
+  {
+    const int64_t cycle = 15 + static_cast<int64_t>(i);
+    reader.read(i, stamp_ns, values);
+    EXPECT_EQ(stamp_ns, cycle * 1000);
+    EXPECT_EQ(values, make_values(recorder.nrValues(), cycle));
+  }
+}
+
+TEST_F(FlightRecorderTest, when_file_exists_expect_it_kept_under_rotated_name)
+{
+  FlightRecorder recorder;
+  std::string error;
+  ASSERT_TRUE(recorder.open(path_, 4, 10, std::chrono::milliseconds(1), error)) << error;
+  EXPECT_TRUE(recorder.rotatedPath().empty());
+  for (int64_t cycle = 0; cycle < 3; ++cycle)
+  {
+    recorder.write(cycle * 1000, make_values(recorder.nrValues(), cycle).data());
+  }
+  recorder.close();
+
+  // reopening twice within the same second must not overwrite the first rotation either
+  for (int run = 0; run < 2; ++run)
+  {
+    ASSERT_TRUE(recorder.open(path_, 4, 10, std::chrono::milliseconds(1), error)) << error;
+    ASSERT_FALSE(recorder.rotatedPath().empty());
+    EXPECT_EQ(recorder.rotatedPath().rfind(path_ + ".", 0), 0u);
+    rotated_paths_.push_back(recorder.rotatedPath());
+    recorder.close();
+  }
+  EXPECT_NE(rotated_paths_[0], rotated_paths_[1]);
+
+  FlightRecorderReader reader;
+  ASSERT_TRUE(reader.open(rotated_paths_[0], error)) << error;
+  EXPECT_EQ(reader.header().nr_records, 3u);
+  ASSERT_TRUE(reader.open(path_, error)) << error;
+  EXPECT_EQ(reader.header().nr_records, 0u);
+}
+
+TEST_F(FlightRecorderTest, when_file_is_not_a_flight_recorder_expect_error)
+{
+  FILE * file = std::fopen(path_.c_str(), "w");
+  ASSERT_NE(file, nullptr);
+  std::fputs("no flight recorder file, but long enough for the header", file);
+  std::fclose(file);
+
+  FlightRecorderReader reader;
+  std::string error;
+  EXPECT_FALSE(reader.open(path_, error));
+  EXPECT_FALSE(error.empty());
+}
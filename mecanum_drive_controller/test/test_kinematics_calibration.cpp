@@ -0,0 +1,79 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <random>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/kinematics_calibration.hpp"
+
+using mecanum_drive_controller::KinematicsCalibration;
+using Twist = mecanum_drive_controller::MecanumKinematics::Twist;
+
+TEST(KinematicsCalibrationTest, when_wheels_worn_expect_radius_and_wheelbase_estimated)
+{
+  const double radius = 0.05;
+  const double sum_of_projections = 0.4;
+  // true parameters: the wheels wore down by 4 %, the base is 5 % wider than configured
+  const double true_radius = 0.048;
+  const double true_sum_of_projections = 0.42;
+  const double linear_scale = true_radius / radius;
+  const double angular_scale =
+    (true_radius / true_sum_of_projections) / (radius / sum_of_projections);
+
+  KinematicsCalibration calibration;
+  calibration.configure(radius, sum_of_projections, 0.999, 0.05, 0.1);
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> velocity(-1.0, 1.0);
+  std::normal_distribution<double> noise(0.0, 0.01);
+  for (int i = 0; i < 5000; ++i)
+  {
+    const Twist fk_twist = {velocity(generator), velocity(generator), velocity(generator)};
+    const Twist measured = {
+      linear_scale * fk_twist[0] + noise(generator), linear_scale * fk_twist[1] + noise(generator),
+      angular_scale * fk_twist[2] + noise(generator)};
+    calibration.update(fk_twist, measured);
+  }
+
+  const auto estimate = calibration.estimate();
+  EXPECT_NEAR(estimate.linear_scale, linear_scale, 1e-3);
+  EXPECT_NEAR(estimate.angular_scale, angular_scale, 1e-3);
+  EXPECT_NEAR(estimate.wheels_radius, true_radius, 1e-4);
+  EXPECT_NEAR(estimate.sum_of_robot_center_projection_on_X_Y_axis, true_sum_of_projections, 1e-3);
+  EXPECT_LT(estimate.linear_variance, 1e-2);
+  EXPECT_GT(estimate.nr_linear_samples, 0u);
+  EXPECT_GT(estimate.nr_angular_samples, 0u);
+}
+
+TEST(KinematicsCalibrationTest, when_standing_still_or_measurement_invalid_expect_no_update)
+{
+  KinematicsCalibration calibration;
+  calibration.configure(0.05, 0.4, 0.99, 0.05, 0.1);
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    // noise of a standing robot below the thresholds
+    calibration.update({0.001, 0.0, 0.002}, {0.02, -0.01, 0.05});
+    calibration.update({0.5, 0.0, 0.5}, {NAN, 0.0, 0.5});
+  }
+
+  const auto estimate = calibration.estimate();
+  EXPECT_EQ(estimate.linear_scale, 1.0);
+  EXPECT_EQ(estimate.angular_scale, 1.0);
+  EXPECT_EQ(estimate.nr_linear_samples, 0u);
+  EXPECT_EQ(estimate.nr_angular_samples, 0u);
+  EXPECT_DOUBLE_EQ(estimate.wheels_radius, 0.05);
+  EXPECT_DOUBLE_EQ(estimate.sum_of_robot_center_projection_on_X_Y_axis, 0.4);
+}
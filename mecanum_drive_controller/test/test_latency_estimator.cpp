@@ -0,0 +1,83 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/latency_estimator.hpp"
+
+using mecanum_drive_controller::LatencyEstimator;
+
+TEST(LatencyEstimatorTest, when_latency_jitters_expect_smoothed_mean_and_jitter)
+{
+  LatencyEstimator estimator;
+  estimator.configure(0.05);
+
+  // 30 to 80 ms latency, uniformly distributed: mean 55 ms, mean absolute deviation 12.5 ms
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<int64_t> latency(30000000, 80000000);
+  int64_t stamp_ns = 1000000000;
+  for (int i = 0; i < 2000; ++i)
+  {
+    stamp_ns += 20000000;
+    estimator.add(stamp_ns, stamp_ns + latency(generator));
+  }
+
+  EXPECT_NEAR(estimator.latency(), 55e6, 5e6);
+  EXPECT_NEAR(estimator.jitter(), 12.5e6, 3e6);
+  EXPECT_EQ(estimator.samples(), 2000u);
+  EXPECT_EQ(estimator.negativeSamples(), 0u);
+  EXPECT_EQ(estimator.histogram().count(), 2000u);
+  EXPECT_GE(estimator.histogram().min(), 30000000);
+  EXPECT_LE(estimator.histogram().max(), 80000000);
+
+  estimator.resetHistogram();
+  EXPECT_EQ(estimator.histogram().count(), 0u);
+  EXPECT_NEAR(estimator.latency(), 55e6, 5e6);
+}
+
+TEST(LatencyEstimatorTest, when_stamped_in_future_expect_counted_and_clamped)
+{
+  LatencyEstimator estimator;
+  estimator.configure(0.5);
+  estimator.add(2000, 1000);
+  EXPECT_EQ(estimator.negativeSamples(), 1u);
+  EXPECT_EQ(estimator.latency(), 0.0);
+
+  estimator.reset();
+  EXPECT_EQ(estimator.samples(), 0u);
+  EXPECT_EQ(estimator.negativeSamples(), 0u);
+}
+
+TEST(LatencyEstimatorTest, when_pose_predicted_expect_arc_of_constant_twist)
+{
+  std::array<double, 3> predicted;
+  mecanum_drive_controller::predictPose({1.0, 2.0, M_PI_2}, {0.5, 0.0, 0.0}, 0.2, predicted);
+  EXPECT_NEAR(predicted[0], 1.0, 1e-12);
+  EXPECT_NEAR(predicted[1], 2.1, 1e-12);
+  EXPECT_NEAR(predicted[2], M_PI_2, 1e-12);
+
+  // quarter circle of radius 1 from the origin, heading along x
+  mecanum_drive_controller::predictPose({0.0, 0.0, 0.0}, {M_PI_2, 0.0, M_PI_2}, 1.0, predicted);
+  EXPECT_NEAR(predicted[0], 1.0, 1e-12);
+  EXPECT_NEAR(predicted[1], 1.0, 1e-12);
+  EXPECT_NEAR(predicted[2], M_PI_2, 1e-12);
+
+  predicted = {0.0, 0.0, 0.0};
+  mecanum_drive_controller::predictPose(predicted, {0.0, 1.0, 0.0}, 0.5, predicted);
+  EXPECT_NEAR(predicted[1], 0.5, 1e-12);
+}
@@ -40,5 +40,11 @@ TEST(TestLoadMecanumDriveController, when_loading_controller_expect_no_exception
       "mecanum_drive_controller/MecanumDriveController"),
     nullptr);
 
+  ASSERT_NE(
+    cm.load_controller(
+      "test_mecanum_drive_batch_controller",
+      "mecanum_drive_controller/MecanumDriveBatchController"),
+    nullptr);
+
   rclcpp::shutdown();
 }
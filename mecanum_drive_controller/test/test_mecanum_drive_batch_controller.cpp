@@ -0,0 +1,300 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "hardware_interface/loaned_command_interface.hpp"
+#include "hardware_interface/loaned_state_interface.hpp"
+#include "mecanum_drive_controller/mecanum_drive_batch_controller.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/utilities.hpp"
+
+namespace
+{
+constexpr auto NODE_SUCCESS = controller_interface::CallbackReturn::SUCCESS;
+}  // namespace
+
+// subclassing and friending so we can access member variables
+class TestableMecanumDriveBatchController
+: public mecanum_drive_controller::MecanumDriveBatchController
+{
+  FRIEND_TEST(
+    MecanumDriveBatchControllerTest, when_controller_configured_expect_per_base_interfaces);
+  FRIEND_TEST(
+    MecanumDriveBatchControllerTest,
+    when_controller_in_chained_mode_expect_commands_computed_for_each_base);
+  FRIEND_TEST(
+    MecanumDriveBatchControllerTest, when_wheel_state_of_base_is_nan_expect_only_its_odometry_held);
+  FRIEND_TEST(
+    MecanumDriveBatchControllerTest,
+    when_using_sim_time_expect_timeout_and_stamps_from_update_time);
+  FRIEND_TEST(MecanumDriveBatchControllerTest, when_updated_expect_per_base_odometry_states);
+};
+
+class MecanumDriveBatchControllerTest : public ::testing::Test
+{
+public:
+  void SetUp() { controller_ = std::make_unique<TestableMecanumDriveBatchController>(); }
+
+  void TearDown() { controller_.reset(nullptr); }
+
+protected:
+  void SetUpController(const std::string controller_name = "test_mecanum_drive_batch_controller")
+  {
+    ASSERT_EQ(controller_->init(controller_name), controller_interface::return_type::OK);
+
+    std::vector<hardware_interface::LoanedCommandInterface> command_ifs;
+    command_itfs_.reserve(joint_command_values_.size());
+    command_ifs.reserve(joint_command_values_.size());
+    std::vector<hardware_interface::LoanedStateInterface> state_ifs;
+    state_itfs_.reserve(joint_state_values_.size());
+    state_ifs.reserve(joint_state_values_.size());
+
+    for (size_t i = 0; i < joint_command_values_.size(); ++i)
+    {
+      command_itfs_.emplace_back(hardware_interface::CommandInterface(
+        command_joint_names_[i], interface_name_, &joint_command_values_[i]));
+      command_ifs.emplace_back(command_itfs_.back());
+      state_itfs_.emplace_back(hardware_interface::StateInterface(
+        command_joint_names_[i], interface_name_, &joint_state_values_[i]));
+      state_ifs.emplace_back(state_itfs_.back());
+    }
+
+    controller_->assign_interfaces(std::move(command_ifs), std::move(state_ifs));
+  }
+
+  std::vector<std::string> command_joint_names_ = {
+    "robot_1/front_left_wheel_joint", "robot_1/back_left_wheel_joint",
+    "robot_1/back_right_wheel_joint", "robot_1/front_right_wheel_joint",
+    "robot_2/front_left_wheel_joint", "robot_2/back_left_wheel_joint",
+    "robot_2/back_right_wheel_joint", "robot_2/front_right_wheel_joint"};
+  std::string interface_name_ = "velocity";
+
+  std::array<double, 8> joint_state_values_ = {0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1};
+  std::array<double, 8> joint_command_values_ = {101.101, 101.101, 101.101, 101.101,
+                                                 101.101, 101.101, 101.101, 101.101};
+
+  std::vector<hardware_interface::StateInterface> state_itfs_;
+  std::vector<hardware_interface::CommandInterface> command_itfs_;
+
+  std::unique_ptr<TestableMecanumDriveBatchController> controller_;
+};
+
+TEST_F(MecanumDriveBatchControllerTest, when_controller_configured_expect_per_base_interfaces)
+{
+  SetUpController();
+
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  ASSERT_EQ(controller_->nr_bases_, 2u);
+
+  auto command_intefaces = controller_->command_interface_configuration();
+  ASSERT_EQ(command_intefaces.names.size(), command_joint_names_.size());
+  for (size_t i = 0; i < command_intefaces.names.size(); ++i)
+  {
+    EXPECT_EQ(command_intefaces.names[i], command_joint_names_[i] + "/" + interface_name_);
+  }
+
+  auto reference_interfaces = controller_->export_reference_interfaces();
+  const std::vector<std::string> reference_interface_names = {
+    "robot_1/linear/x/velocity",  "robot_2/linear/x/velocity",  "robot_1/linear/y/velocity",
+    "robot_2/linear/y/velocity",  "robot_1/angular/z/velocity", "robot_2/angular/z/velocity"};
+  ASSERT_EQ(reference_interfaces.size(), reference_interface_names.size());
+  for (size_t i = 0; i < reference_interface_names.size(); ++i)
+  {
+    EXPECT_EQ(reference_interfaces[i].get_interface_name(), reference_interface_names[i]);
+  }
+}
+
+TEST_F(
+  MecanumDriveBatchControllerTest,
+  when_controller_in_chained_mode_expect_commands_computed_for_each_base)
+{
+  SetUpController();
+
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  auto reference_interfaces = controller_->export_reference_interfaces();
+  controller_->set_chained_mode(true);
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+
+  // robot_1 drives forward, robot_2 turns in place
+  controller_->reference_interfaces_[0] = 1.5;
+  controller_->reference_interfaces_[1] = 0.0;
+  controller_->reference_interfaces_[2] = 0.0;
+  controller_->reference_interfaces_[3] = 0.0;
+  controller_->reference_interfaces_[4] = 0.0;
+  controller_->reference_interfaces_[5] = 1.0;
+
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+
+  //  1.0 / 0.5 * (1.5 - 0.0 - 1 * 0.0)
+  for (size_t i = 0; i < 4; ++i)
+  {
+    EXPECT_EQ(joint_command_values_[i], 3.0);
+  }
+  //  1.0 / 0.5 * (0.0 -/+ 0.0 -/+ 1 * 1.0)
+  EXPECT_EQ(joint_command_values_[4], -2.0);
+  EXPECT_EQ(joint_command_values_[5], -2.0);
+  EXPECT_EQ(joint_command_values_[6], 2.0);
+  EXPECT_EQ(joint_command_values_[7], 2.0);
+
+  for (const auto & interface : controller_->reference_interfaces_)
+  {
+    EXPECT_TRUE(std::isnan(interface));
+  }
+}
+
+TEST_F(
+  MecanumDriveBatchControllerTest, when_wheel_state_of_base_is_nan_expect_only_its_odometry_held)
+{
+  SetUpController();
+
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  auto reference_interfaces = controller_->export_reference_interfaces();
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+
+  joint_state_values_[5] = std::numeric_limits<double>::quiet_NaN();
+
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+
+  // 0.25 * 0.5 * 4 * 0.1 * 0.01
+  EXPECT_NEAR(controller_->pose_x_[0], 0.0005, 1e-12);
+  EXPECT_EQ(controller_->pose_x_[1], 0.0);
+
+  // no references, expect zero commands for both bases
+  for (const auto & command : joint_command_values_)
+  {
+    EXPECT_EQ(command, 0.0);
+  }
+}
+
+TEST_F(MecanumDriveBatchControllerTest, when_updated_expect_per_base_odometry_states)
+{
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  auto reference_interfaces = controller_->export_reference_interfaces();
+  auto state_interfaces = controller_->export_state_interfaces();
+  ASSERT_EQ(state_interfaces.size(), 12u);
+  EXPECT_EQ(state_interfaces[0].get_name(), "test_mecanum_drive_batch_controller/robot_1/pose/x");
+  EXPECT_EQ(
+    state_interfaces[11].get_name(),
+    "test_mecanum_drive_batch_controller/robot_2/twist/angular/z");
+
+  // the interfaces stay valid after the next configure
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  controller_->set_chained_mode(true);
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+
+  // robot_2 turns in place
+  joint_state_values_[4] = -0.1;
+  joint_state_values_[5] = -0.1;
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+
+  // 0.25 * 0.5 * 4 * 0.1
+  EXPECT_NEAR(state_interfaces[6].get_value(), 0.05, 1e-12);
+  EXPECT_EQ(state_interfaces[7].get_value(), 0.0);
+  EXPECT_EQ(state_interfaces[10].get_value(), 0.0);
+  EXPECT_GT(state_interfaces[11].get_value(), 0.0);
+  for (size_t base = 0; base < 2; ++base)
+  {
+    EXPECT_EQ(state_interfaces[base].get_value(), controller_->pose_x_[base]);
+    EXPECT_EQ(state_interfaces[2 + base].get_value(), controller_->pose_y_[base]);
+    EXPECT_EQ(state_interfaces[4 + base].get_value(), controller_->pose_theta_[base]);
+  }
+  EXPECT_GT(state_interfaces[0].get_value(), 0.0);
+  EXPECT_GT(state_interfaces[5].get_value(), 0.0);
+}
+
+// The control loop only uses the time passed to update(): with use_sim_time and no /clock the
+// node time stays at zero, so the reference timeout and the stamps follow the simulated time
+TEST_F(
+  MecanumDriveBatchControllerTest, when_using_sim_time_expect_timeout_and_stamps_from_update_time)
+{
+  SetUpController();
+  controller_->get_node()->set_parameter(rclcpp::Parameter("use_sim_time", true));
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  auto reference_interfaces = controller_->export_reference_interfaces();
+  controller_->set_chained_mode(false);
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  ASSERT_EQ(controller_->get_node()->now().nanoseconds(), 0);
+
+  rclcpp::Node test_subscription_node("test_subscription_node");
+  auto tf_subscription = test_subscription_node.create_subscription<
+    TestableMecanumDriveBatchController::TfStateMsg>(
+    "/test_mecanum_drive_batch_controller/tf_odometry", 10,
+    [](const TestableMecanumDriveBatchController::TfStateMsg::SharedPtr) {});
+
+  const rclcpp::Time start(1000, 0, RCL_ROS_TIME);
+  const auto period = rclcpp::Duration::from_seconds(0.01);
+  mecanum_drive_controller::TwistReference reference;
+  reference.stamp_ns = start.nanoseconds();
+  reference.linear_x = 1.5;
+  reference.linear_y = 0.0;
+  reference.angular_z = 0.0;
+  controller_->input_refs_[0]->writeFromNonRT(reference);
+
+  // 50 ms old at the simulated time, within the reference timeout of 100 ms
+  const rclcpp::Time time = start + rclcpp::Duration::from_seconds(0.05);
+  ASSERT_EQ(controller_->update(time, period), controller_interface::return_type::OK);
+  for (size_t i = 0; i < 4; ++i)
+  {
+    EXPECT_EQ(joint_command_values_[i], 3.0);
+    EXPECT_EQ(joint_command_values_[4 + i], 0.0);
+  }
+
+  // the transforms of all bases are stamped with the time of the cycle
+  rclcpp::WaitSet wait_set;
+  wait_set.add_subscription(tf_subscription);
+  ASSERT_EQ(
+    wait_set.wait(std::chrono::milliseconds(500)).kind(), rclcpp::WaitResultKind::Ready);
+  TestableMecanumDriveBatchController::TfStateMsg tf_msg;
+  rclcpp::MessageInfo msg_info;
+  ASSERT_TRUE(tf_subscription->take(tf_msg, msg_info));
+  ASSERT_EQ(tf_msg.transforms.size(), 2u);
+  for (const auto & transform : tf_msg.transforms)
+  {
+    EXPECT_EQ(rclcpp::Time(transform.header.stamp).nanoseconds(), time.nanoseconds());
+  }
+
+  // 500 ms old at the simulated time, the reference is discarded
+  ASSERT_EQ(
+    controller_->update(start + rclcpp::Duration::from_seconds(0.5), period),
+    controller_interface::return_type::OK);
+  for (size_t i = 0; i < 4; ++i)
+  {
+    EXPECT_EQ(joint_command_values_[i], 0.0);
+  }
+  EXPECT_TRUE(std::isnan(controller_->current_refs_[0].linear_x));
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  rclcpp::init(argc, argv);
+  int result = RUN_ALL_TESTS();
+  rclcpp::shutdown();
+  return result;
+}
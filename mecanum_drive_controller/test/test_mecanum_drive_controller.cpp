@@ -14,9 +14,13 @@
 
 #include "test_mecanum_drive_controller.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -113,11 +117,10 @@ TEST_F(MecanumDriveControllerTest, when_controller_is_activated_expect_reference
   ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
   ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
 
-  // check that the message is reset
-  auto msg = controller_->input_ref_.readFromNonRT();
-  EXPECT_TRUE(std::isnan((*msg)->twist.linear.x));
+  // check that the reference is reset
+  EXPECT_TRUE(std::isnan(controller_->current_ref_.linear_x));
 
-  ASSERT_TRUE(std::isnan((*msg)->twist.angular.z));
+  ASSERT_TRUE(std::isnan(controller_->current_ref_.angular_z));
 }
 
 TEST_F(MecanumDriveControllerTest, when_controller_active_and_update_called_expect_success)
@@ -235,11 +238,11 @@ TEST_F(MecanumDriveControllerTest, when_reference_msg_is_too_old_expect_unset_re
   ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
   ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
 
-  auto reference = *(controller_->input_ref_.readFromNonRT());
-  auto old_timestamp = reference->header.stamp;
-  EXPECT_TRUE(std::isnan(reference->twist.linear.x));
-  EXPECT_TRUE(std::isnan(reference->twist.linear.y));
-  EXPECT_TRUE(std::isnan(reference->twist.angular.z));
+  auto reference = controller_->input_ref_.readFromNonRT();
+  auto old_timestamp = reference.stamp_ns;
+  EXPECT_TRUE(std::isnan(reference.linear_x));
+  EXPECT_TRUE(std::isnan(reference.linear_y));
+  EXPECT_TRUE(std::isnan(reference.angular_z));
 
   // reference_callback() is implicitly called when publish_commands() is called
   // reference_msg is published with provided time stamp when publish_commands( time_stamp)
@@ -248,10 +251,10 @@ TEST_F(MecanumDriveControllerTest, when_reference_msg_is_too_old_expect_unset_re
     controller_->get_node()->now() - controller_->ref_timeout_ -
     rclcpp::Duration::from_seconds(0.1));
   ASSERT_TRUE(controller_->wait_for_commands(executor));
-  ASSERT_EQ(old_timestamp, (*(controller_->input_ref_.readFromNonRT()))->header.stamp);
-  EXPECT_TRUE(std::isnan((reference)->twist.linear.x));
-  EXPECT_TRUE(std::isnan((reference)->twist.linear.y));
-  EXPECT_TRUE(std::isnan((reference)->twist.angular.z));
+  ASSERT_EQ(old_timestamp, controller_->input_ref_.readFromNonRT().stamp_ns);
+  EXPECT_TRUE(std::isnan(controller_->input_ref_.readFromNonRT().linear_x));
+  EXPECT_TRUE(std::isnan(controller_->input_ref_.readFromNonRT().linear_y));
+  EXPECT_TRUE(std::isnan(controller_->input_ref_.readFromNonRT().angular_z));
 }
 
 // when time stamp is zero expect that time stamp is set to current time stamp
@@ -267,10 +270,10 @@ TEST_F(
   ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
 
   auto reference = controller_->input_ref_.readFromNonRT();
-  auto old_timestamp = (*reference)->header.stamp;
-  EXPECT_TRUE(std::isnan((*reference)->twist.linear.x));
-  EXPECT_TRUE(std::isnan((*reference)->twist.linear.y));
-  EXPECT_TRUE(std::isnan((*reference)->twist.angular.z));
+  auto old_timestamp = reference.stamp_ns;
+  EXPECT_TRUE(std::isnan(reference.linear_x));
+  EXPECT_TRUE(std::isnan(reference.linear_y));
+  EXPECT_TRUE(std::isnan(reference.angular_z));
 
   // reference_callback() is implicitly called when publish_commands() is called
   // reference_msg is published with provided time stamp when publish_commands( time_stamp)
@@ -278,13 +281,15 @@ TEST_F(
   publish_commands(rclcpp::Time(0));
 
   ASSERT_TRUE(controller_->wait_for_commands(executor));
-  ASSERT_EQ(old_timestamp.sec, (*(controller_->input_ref_.readFromNonRT()))->header.stamp.sec);
-  EXPECT_FALSE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.linear.x));
-  EXPECT_FALSE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.angular.z));
-  EXPECT_EQ((*(controller_->input_ref_.readFromNonRT()))->twist.linear.x, 1.5);
-  EXPECT_EQ((*(controller_->input_ref_.readFromNonRT()))->twist.linear.y, 0.0);
-  EXPECT_EQ((*(controller_->input_ref_.readFromNonRT()))->twist.angular.z, 0.0);
-  EXPECT_NE((*(controller_->input_ref_.readFromNonRT()))->header.stamp.sec, 0.0);
+  // compare full seconds of the stamps, as the sec field of the message header
+  ASSERT_EQ(
+    old_timestamp / 1000000000, controller_->input_ref_.readFromNonRT().stamp_ns / 1000000000);
+  EXPECT_FALSE(std::isnan(controller_->input_ref_.readFromNonRT().linear_x));
+  EXPECT_FALSE(std::isnan(controller_->input_ref_.readFromNonRT().angular_z));
+  EXPECT_EQ(controller_->input_ref_.readFromNonRT().linear_x, 1.5);
+  EXPECT_EQ(controller_->input_ref_.readFromNonRT().linear_y, 0.0);
+  EXPECT_EQ(controller_->input_ref_.readFromNonRT().angular_z, 0.0);
+  EXPECT_NE(controller_->input_ref_.readFromNonRT().stamp_ns, 0);
 }
 
 // when the reference_msg has valid timestamp then the timeout check in reference_callback()
@@ -300,8 +305,8 @@ TEST_F(MecanumDriveControllerTest, when_message_has_valid_timestamp_expect_refer
   ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
 
   auto reference = controller_->input_ref_.readFromNonRT();
-  EXPECT_TRUE(std::isnan((*reference)->twist.linear.x));
-  EXPECT_TRUE(std::isnan((*reference)->twist.angular.z));
+  EXPECT_TRUE(std::isnan(reference.linear_x));
+  EXPECT_TRUE(std::isnan(reference.angular_z));
 
   // reference_callback() is implicitly called when publish_commands() is called
   // reference_msg is published with provided time stamp when publish_commands( time_stamp)
@@ -309,11 +314,11 @@ TEST_F(MecanumDriveControllerTest, when_message_has_valid_timestamp_expect_refer
   publish_commands(controller_->get_node()->now());
 
   ASSERT_TRUE(controller_->wait_for_commands(executor));
-  EXPECT_FALSE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.linear.x));
-  EXPECT_FALSE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.angular.z));
-  EXPECT_EQ((*(controller_->input_ref_.readFromNonRT()))->twist.linear.x, 1.5);
-  EXPECT_EQ((*(controller_->input_ref_.readFromNonRT()))->twist.linear.y, 0.0);
-  EXPECT_EQ((*(controller_->input_ref_.readFromNonRT()))->twist.angular.z, 0.0);
+  EXPECT_FALSE(std::isnan(controller_->input_ref_.readFromNonRT().linear_x));
+  EXPECT_FALSE(std::isnan(controller_->input_ref_.readFromNonRT().angular_z));
+  EXPECT_EQ(controller_->input_ref_.readFromNonRT().linear_x, 1.5);
+  EXPECT_EQ(controller_->input_ref_.readFromNonRT().linear_y, 0.0);
+  EXPECT_EQ(controller_->input_ref_.readFromNonRT().angular_z, 0.0);
 }
 
 // when not in chainable mode and ref_msg_timedout expect
@@ -342,23 +347,22 @@ TEST_F(
   // set command statically
   joint_command_values_[1] = command_lin_x;
 
-  std::shared_ptr<ControllerReferenceMsg> msg = std::make_shared<ControllerReferenceMsg>();
+  mecanum_drive_controller::TwistReference msg;
 
-  msg->header.stamp = controller_->get_node()->now() - controller_->ref_timeout_ -
-                      rclcpp::Duration::from_seconds(0.1);
-  msg->twist.linear.x = TEST_LINEAR_VELOCITY_X;
-  msg->twist.linear.y = TEST_LINEAR_VELOCITY_y;
-  msg->twist.linear.z = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.angular.x = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.angular.y = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.angular.z = TEST_ANGULAR_VELOCITY_Z;
+  msg.stamp_ns = (controller_->get_node()->now() - controller_->ref_timeout_ -
+                  rclcpp::Duration::from_seconds(0.1))
+                   .nanoseconds();
+  msg.linear_x = TEST_LINEAR_VELOCITY_X;
+  msg.linear_y = TEST_LINEAR_VELOCITY_y;
+  msg.angular_z = TEST_ANGULAR_VELOCITY_Z;
   controller_->input_ref_.writeFromNonRT(msg);
-  const auto age_of_last_command =
-    controller_->get_node()->now() - (*(controller_->input_ref_.readFromNonRT()))->header.stamp;
+  const auto age_of_last_command = rclcpp::Duration::from_nanoseconds(
+    controller_->get_node()->now().nanoseconds() -
+    controller_->input_ref_.readFromNonRT().stamp_ns);
 
   // age_of_last_command > ref_timeout_
   ASSERT_FALSE(age_of_last_command <= controller_->ref_timeout_);
-  ASSERT_EQ((*(controller_->input_ref_.readFromRT()))->twist.linear.x, TEST_LINEAR_VELOCITY_X);
+  ASSERT_EQ(controller_->input_ref_.readFromNonRT().linear_x, TEST_LINEAR_VELOCITY_X);
   ASSERT_EQ(
     controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
     controller_interface::return_type::OK);
@@ -374,21 +378,20 @@ TEST_F(
     EXPECT_EQ(controller_->command_interfaces_[i].get_value(), 0.0);
   }
 
-  std::shared_ptr<ControllerReferenceMsg> msg_2 = std::make_shared<ControllerReferenceMsg>();
-  msg_2->header.stamp = controller_->get_node()->now() - rclcpp::Duration::from_seconds(0.01);
-  msg_2->twist.linear.x = TEST_LINEAR_VELOCITY_X;
-  msg_2->twist.linear.y = TEST_LINEAR_VELOCITY_y;
-  msg_2->twist.linear.z = std::numeric_limits<double>::quiet_NaN();
-  msg_2->twist.angular.x = std::numeric_limits<double>::quiet_NaN();
-  msg_2->twist.angular.y = std::numeric_limits<double>::quiet_NaN();
-  msg_2->twist.angular.z = TEST_ANGULAR_VELOCITY_Z;
+  mecanum_drive_controller::TwistReference msg_2;
+  msg_2.stamp_ns =
+    (controller_->get_node()->now() - rclcpp::Duration::from_seconds(0.01)).nanoseconds();
+  msg_2.linear_x = TEST_LINEAR_VELOCITY_X;
+  msg_2.linear_y = TEST_LINEAR_VELOCITY_y;
+  msg_2.angular_z = TEST_ANGULAR_VELOCITY_Z;
   controller_->input_ref_.writeFromNonRT(msg_2);
-  const auto age_of_last_command_2 =
-    controller_->get_node()->now() - (*(controller_->input_ref_.readFromNonRT()))->header.stamp;
+  const auto age_of_last_command_2 = rclcpp::Duration::from_nanoseconds(
+    controller_->get_node()->now().nanoseconds() -
+    controller_->input_ref_.readFromNonRT().stamp_ns);
 
   // age_of_last_command_2 < ref_timeout_
   ASSERT_TRUE(age_of_last_command_2 <= controller_->ref_timeout_);
-  ASSERT_EQ((*(controller_->input_ref_.readFromRT()))->twist.linear.x, TEST_LINEAR_VELOCITY_X);
+  ASSERT_EQ(controller_->input_ref_.readFromNonRT().linear_x, TEST_LINEAR_VELOCITY_X);
   ASSERT_EQ(
     controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
     controller_interface::return_type::OK);
@@ -401,7 +404,7 @@ TEST_F(
   // velocity_in_center_frame_angular_z_);
   //  joint_command_values_[1] = 1.0 / 0.5 * (1.5 - 0.0 - 1 * 0.0)
   EXPECT_EQ(joint_command_values_[1], 3.0);
-  ASSERT_EQ((*(controller_->input_ref_.readFromRT()))->twist.linear.x, TEST_LINEAR_VELOCITY_X);
+  ASSERT_EQ(controller_->current_ref_.linear_x, TEST_LINEAR_VELOCITY_X);
   for (const auto & interface : controller_->reference_interfaces_)
   {
     EXPECT_TRUE(std::isnan(interface));
@@ -488,21 +491,20 @@ TEST_F(
   joint_command_values_[1] = command_lin_x;
 
   controller_->ref_timeout_ = rclcpp::Duration::from_seconds(0.0);
-  std::shared_ptr<ControllerReferenceMsg> msg = std::make_shared<ControllerReferenceMsg>();
-
-  msg->header.stamp = controller_->get_node()->now() - rclcpp::Duration::from_seconds(0.0);
-  msg->twist.linear.x = TEST_LINEAR_VELOCITY_X;
-  msg->twist.linear.y = TEST_LINEAR_VELOCITY_y;
-  msg->twist.linear.z = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.angular.x = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.angular.y = std::numeric_limits<double>::quiet_NaN();
-  msg->twist.angular.z = TEST_ANGULAR_VELOCITY_Z;
+  mecanum_drive_controller::TwistReference msg;
+
+  msg.stamp_ns =
+    (controller_->get_node()->now() - rclcpp::Duration::from_seconds(0.0)).nanoseconds();
+  msg.linear_x = TEST_LINEAR_VELOCITY_X;
+  msg.linear_y = TEST_LINEAR_VELOCITY_y;
+  msg.angular_z = TEST_ANGULAR_VELOCITY_Z;
   controller_->input_ref_.writeFromNonRT(msg);
-  const auto age_of_last_command =
-    controller_->get_node()->now() - (*(controller_->input_ref_.readFromNonRT()))->header.stamp;
+  const auto age_of_last_command = rclcpp::Duration::from_nanoseconds(
+    controller_->get_node()->now().nanoseconds() -
+    controller_->input_ref_.readFromNonRT().stamp_ns);
 
   ASSERT_FALSE(age_of_last_command <= controller_->ref_timeout_);
-  ASSERT_EQ((*(controller_->input_ref_.readFromRT()))->twist.linear.x, TEST_LINEAR_VELOCITY_X);
+  ASSERT_EQ(controller_->input_ref_.readFromNonRT().linear_x, TEST_LINEAR_VELOCITY_X);
   ASSERT_EQ(
     controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
     controller_interface::return_type::OK);
@@ -516,7 +518,7 @@ TEST_F(
   // velocity_in_center_frame_angular_z_);
   //  joint_command_values_[1] = 1.0 / 0.5 * (1.5 - 0.0 - 1 * 0.0)
   EXPECT_EQ(joint_command_values_[1], 3.0);
-  ASSERT_TRUE(std::isnan((*(controller_->input_ref_.readFromRT()))->twist.linear.x));
+  ASSERT_TRUE(std::isnan(controller_->current_ref_.linear_x));
 }
 
 TEST_F(
@@ -529,9 +531,9 @@ TEST_F(
   ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
   ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
 
-  EXPECT_TRUE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.linear.x));
-  EXPECT_TRUE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.linear.y));
-  EXPECT_TRUE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.angular.z));
+  EXPECT_TRUE(std::isnan(controller_->input_ref_.readFromNonRT().linear_x));
+  EXPECT_TRUE(std::isnan(controller_->input_ref_.readFromNonRT().linear_y));
+  EXPECT_TRUE(std::isnan(controller_->input_ref_.readFromNonRT().angular_z));
   controller_->ref_timeout_ = rclcpp::Duration::from_seconds(0.0);
 
   // reference_callback() is called implicitly when publish_commands() is called.
@@ -541,12 +543,464 @@ TEST_F(
 
   ASSERT_TRUE(controller_->wait_for_commands(executor));
 
-  EXPECT_FALSE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.linear.x));
-  EXPECT_FALSE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.linear.y));
-  EXPECT_FALSE(std::isnan((*(controller_->input_ref_.readFromNonRT()))->twist.angular.z));
-  EXPECT_EQ((*(controller_->input_ref_.readFromNonRT()))->twist.linear.x, 1.5);
-  EXPECT_EQ((*(controller_->input_ref_.readFromNonRT()))->twist.linear.y, 0.0);
-  EXPECT_EQ((*(controller_->input_ref_.readFromNonRT()))->twist.angular.z, 0.0);
+  EXPECT_FALSE(std::isnan(controller_->input_ref_.readFromNonRT().linear_x));
+  EXPECT_FALSE(std::isnan(controller_->input_ref_.readFromNonRT().linear_y));
+  EXPECT_FALSE(std::isnan(controller_->input_ref_.readFromNonRT().angular_z));
+  EXPECT_EQ(controller_->input_ref_.readFromNonRT().linear_x, 1.5);
+  EXPECT_EQ(controller_->input_ref_.readFromNonRT().linear_y, 0.0);
+  EXPECT_EQ(controller_->input_ref_.readFromNonRT().angular_z, 0.0);
+}
+
+// reference_callback() is called from a second thread at ~10 kHz while the control loop runs,
+// configure with -DMECANUM_DRIVE_CONTROLLER_SANITIZE_THREAD=ON to check the hand-over of the
+// reference for data races
+TEST_F(
+  MecanumDriveControllerTest,
+  when_reference_callback_runs_concurrently_with_update_expect_consistent_commands)
+{
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+
+  std::atomic<bool> running{true};
+  std::thread reference_thread(
+    [&]()
+    {
+      auto msg = std::make_shared<ControllerReferenceMsg>();
+      for (size_t i = 0; running; ++i)
+      {
+        const double velocity = 0.001 * static_cast<double>(i % 1000 + 1);
+        msg->header.stamp = controller_->get_node()->now();
+        msg->twist.linear.x = velocity;
+        msg->twist.linear.y = 2.0 * velocity;
+        msg->twist.angular.z = 0.0;
+        controller_->reference_callback(msg);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    });
+
+  size_t nr_commands = 0;
+  for (size_t i = 0; i < 500; ++i)
+  {
+    ASSERT_EQ(
+      controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.001)),
+      controller_interface::return_type::OK);
+    // front_left = 2 * (vx - vy) = -2 * vx, back_left = 2 * (vx + vy) = 6 * vx, unless the
+    // reference fields were mixed up from different messages
+    if (joint_command_values_[0] != 0.0)
+    {
+      EXPECT_DOUBLE_EQ(joint_command_values_[1], -3.0 * joint_command_values_[0]);
+      ++nr_commands;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  running = false;
+  reference_thread.join();
+
+  EXPECT_GT(nr_commands, 0u);
+}
+
+// The control loop only uses the time passed to update(): with use_sim_time and no /clock the
+// node time stays at zero, so the reference timeout and the stamps follow the simulated time
+TEST_F(MecanumDriveControllerTest, when_using_sim_time_expect_timeout_and_stamps_from_update_time)
+{
+  SetUpController();
+  controller_->get_node()->set_parameter(rclcpp::Parameter("use_sim_time", true));
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  controller_->set_chained_mode(false);
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  ASSERT_EQ(controller_->get_node()->now().nanoseconds(), 0);
+
+  rclcpp::Node test_subscription_node("test_subscription_node");
+  auto state_subscription = test_subscription_node.create_subscription<ControllerStateMsg>(
+    "/test_mecanum_drive_controller/controller_state", 10,
+    [](const ControllerStateMsg::SharedPtr) {});
+  auto odom_subscription = test_subscription_node.create_subscription<OdomStateMsg>(
+    "/test_mecanum_drive_controller/odometry", 10, [](const OdomStateMsg::SharedPtr) {});
+
+  const rclcpp::Time start(1000, 0, RCL_ROS_TIME);
+  const auto period = rclcpp::Duration::from_seconds(0.01);
+  mecanum_drive_controller::TwistReference reference;
+  reference.stamp_ns = start.nanoseconds();
+  reference.linear_x = TEST_LINEAR_VELOCITY_X;
+  reference.linear_y = TEST_LINEAR_VELOCITY_y;
+  reference.angular_z = TEST_ANGULAR_VELOCITY_Z;
+  controller_->input_ref_.writeFromNonRT(reference);
+
+  // 50 ms old at the simulated time, within the reference timeout of 100 ms
+  const rclcpp::Time time = start + rclcpp::Duration::from_seconds(0.05);
+  ASSERT_EQ(controller_->update(time, period), controller_interface::return_type::OK);
+  EXPECT_EQ(joint_command_values_[1], 3.0);
+
+  // both messages are stamped with the time of the cycle
+  auto wait_for_message = [](rclcpp::SubscriptionBase::SharedPtr subscription)
+  {
+    rclcpp::WaitSet wait_set;
+    wait_set.add_subscription(subscription);
+    return wait_set.wait(std::chrono::milliseconds(500)).kind() == rclcpp::WaitResultKind::Ready;
+  };
+  ASSERT_TRUE(wait_for_message(state_subscription));
+  ASSERT_TRUE(wait_for_message(odom_subscription));
+  ControllerStateMsg state_msg;
+  OdomStateMsg odom_msg;
+  rclcpp::MessageInfo msg_info;
+  ASSERT_TRUE(state_subscription->take(state_msg, msg_info));
+  ASSERT_TRUE(odom_subscription->take(odom_msg, msg_info));
+  EXPECT_EQ(rclcpp::Time(state_msg.header.stamp).nanoseconds(), time.nanoseconds());
+  EXPECT_EQ(rclcpp::Time(odom_msg.header.stamp).nanoseconds(), time.nanoseconds());
+  // constant covariances of the parameters
+  EXPECT_EQ(odom_msg.pose.covariance[35], 35.0);
+  EXPECT_EQ(odom_msg.twist.covariance[35], 35.0);
+
+  // 500 ms old at the simulated time, the reference is discarded
+  ASSERT_EQ(
+    controller_->update(start + rclcpp::Duration::from_seconds(0.5), period),
+    controller_interface::return_type::OK);
+  EXPECT_EQ(joint_command_values_[1], 0.0);
+  EXPECT_TRUE(std::isnan(controller_->current_ref_.linear_x));
+}
+
+TEST_F(MecanumDriveControllerTest, when_reference_deadline_missed_expect_commands_set_to_zero)
+{
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  controller_->set_chained_mode(false);
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+
+  const auto qos = controller_->ref_subscriber_->get_actual_qos();
+  EXPECT_EQ(qos.reliability(), rclcpp::ReliabilityPolicy::BestEffort);
+  EXPECT_EQ(qos.depth(), 1u);
+
+  mecanum_drive_controller::TwistReference reference;
+  reference.stamp_ns = controller_->get_node()->now().nanoseconds();
+  reference.linear_x = TEST_LINEAR_VELOCITY_X;
+  reference.linear_y = TEST_LINEAR_VELOCITY_y;
+  reference.angular_z = TEST_ANGULAR_VELOCITY_Z;
+  controller_->input_ref_.writeFromNonRT(reference);
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  EXPECT_EQ(joint_command_values_[1], 3.0);
+
+  // deadline event of the subscription, the reference is still within the reference timeout
+  controller_->reference_deadline_misses_++;
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  EXPECT_EQ(joint_command_values_[1], 0.0);
+  EXPECT_TRUE(std::isnan(controller_->current_ref_.linear_x));
+
+  // a new reference is used again
+  reference.stamp_ns = controller_->get_node()->now().nanoseconds();
+  controller_->input_ref_.writeFromNonRT(reference);
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  EXPECT_EQ(joint_command_values_[1], 3.0);
+}
+
+TEST_F(MecanumDriveControllerTest, when_chained_only_expect_no_topics_and_odometry_state_interfaces)
+{
+  SetUpController();
+  controller_->get_node()->set_parameter(rclcpp::Parameter("chained_only", true));
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  EXPECT_EQ(controller_->ref_subscriber_, nullptr);
+  EXPECT_EQ(controller_->rt_odom_state_publisher_, nullptr);
+  EXPECT_EQ(controller_->rt_tf_odom_state_publisher_, nullptr);
+  EXPECT_EQ(controller_->controller_state_publisher_, nullptr);
+  EXPECT_FALSE(controller_->set_chained_mode(false));
+  ASSERT_TRUE(controller_->set_chained_mode(true));
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+
+  auto state_interfaces = controller_->export_state_interfaces();
+  ASSERT_EQ(state_interfaces.size(), 6u + 2u * NR_CMD_ITFS);
+  EXPECT_EQ(state_interfaces[0].get_name(), "test_mecanum_drive_controller/pose/x");
+  EXPECT_EQ(state_interfaces[5].get_name(), "test_mecanum_drive_controller/twist/angular/z");
+  EXPECT_EQ(
+    state_interfaces[6].get_name(),
+    "test_mecanum_drive_controller/front_left_wheel_joint/slipping");
+  EXPECT_EQ(
+    state_interfaces[13].get_name(),
+    "test_mecanum_drive_controller/front_right_wheel_joint/saturated");
+
+  controller_->reference_interfaces_[0] = TEST_LINEAR_VELOCITY_X;
+  controller_->reference_interfaces_[1] = TEST_LINEAR_VELOCITY_y;
+  controller_->reference_interfaces_[2] = TEST_ANGULAR_VELOCITY_Z;
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  EXPECT_EQ(joint_command_values_[1], 3.0);
+
+  // the interfaces hold the odometry of the cycle just run
+  EXPECT_GT(state_interfaces[0].get_value(), 0.0);
+  EXPECT_EQ(state_interfaces[0].get_value(), controller_->odometry_.getX());
+  EXPECT_EQ(state_interfaces[1].get_value(), controller_->odometry_.getY());
+  EXPECT_EQ(state_interfaces[2].get_value(), controller_->odometry_.getRz());
+  EXPECT_EQ(state_interfaces[3].get_value(), controller_->odometry_.getVx());
+  EXPECT_EQ(state_interfaces[4].get_value(), controller_->odometry_.getVy());
+  EXPECT_EQ(state_interfaces[5].get_value(), controller_->odometry_.getWz());
+  for (size_t i = 6; i < state_interfaces.size(); ++i)
+  {
+    EXPECT_EQ(state_interfaces[i].get_value(), 0.0);
+  }
+}
+
+TEST_F(MecanumDriveControllerTest, when_reconfigured_expect_exported_state_interfaces_still_valid)
+{
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  auto state_interfaces = controller_->export_state_interfaces();
+  ASSERT_EQ(state_interfaces.size(), 6u + 2u * NR_CMD_ITFS);
+  const double * values = controller_->exported_state_values_.data();
+
+  // the interfaces exported before point into the same storage after the next configure
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  EXPECT_EQ(controller_->exported_state_values_.data(), values);
+  ASSERT_TRUE(controller_->set_chained_mode(true));
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+
+  controller_->reference_interfaces_[0] = TEST_LINEAR_VELOCITY_X;
+  controller_->reference_interfaces_[1] = TEST_LINEAR_VELOCITY_y;
+  controller_->reference_interfaces_[2] = TEST_ANGULAR_VELOCITY_Z;
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  EXPECT_GT(state_interfaces[0].get_value(), 0.0);
+  EXPECT_EQ(state_interfaces[0].get_value(), controller_->odometry_.getX());
+  EXPECT_EQ(state_interfaces[3].get_value(), controller_->odometry_.getVx());
+}
+
+TEST_F(MecanumDriveControllerTest, when_wheel_velocity_limited_expect_saturated_state_interfaces)
+{
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  controller_->twist_limiter_.configure({}, 2.0);
+  ASSERT_TRUE(controller_->set_chained_mode(true));
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  auto state_interfaces = controller_->export_state_interfaces();
+  const size_t saturated_offset = 6u + NR_CMD_ITFS;
+
+  // pure rotation of 0.5 rad/s: 1.0 rad/s per wheel
+  controller_->reference_interfaces_[0] = 0.0;
+  controller_->reference_interfaces_[1] = 0.0;
+  controller_->reference_interfaces_[2] = 0.5;
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  for (size_t i = 0; i < NR_CMD_ITFS; ++i)
+  {
+    EXPECT_EQ(std::abs(joint_command_values_[i]), 1.0);
+    EXPECT_EQ(state_interfaces[saturated_offset + i].get_value(), 0.0);
+  }
+
+  // 3.0 rad/s per wheel, scaled down to the limit
+  controller_->reference_interfaces_[0] = TEST_LINEAR_VELOCITY_X;
+  controller_->reference_interfaces_[1] = 0.0;
+  controller_->reference_interfaces_[2] = 0.0;
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  for (size_t i = 0; i < NR_CMD_ITFS; ++i)
+  {
+    EXPECT_DOUBLE_EQ(joint_command_values_[i], 2.0);
+    EXPECT_EQ(state_interfaces[saturated_offset + i].get_value(), 1.0);
+  }
+
+  // the flags are cleared while the controller is inactive, the odometry is kept
+  ASSERT_EQ(controller_->on_deactivate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  for (size_t i = 0; i < NR_CMD_ITFS; ++i)
+  {
+    EXPECT_EQ(state_interfaces[saturated_offset + i].get_value(), 0.0);
+  }
+  EXPECT_EQ(state_interfaces[0].get_value(), controller_->odometry_.getX());
+}
+
+TEST_F(MecanumDriveControllerTest, when_twist_feedback_enabled_expect_corrected_reference)
+{
+  using mecanum_drive_controller::TwistFeedbackGains;
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  controller_->twist_feedback_enabled_ = true;
+  controller_->twist_feedback_.configure(
+    {TwistFeedbackGains{1.0, 0.0, 0.5}, TwistFeedbackGains{}, TwistFeedbackGains{}});
+  ASSERT_TRUE(controller_->set_chained_mode(true));
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+
+  // the wheels turn with 0.1 rad/s, i.e., FK estimates 0.05 m/s along x
+  controller_->reference_interfaces_[0] = TEST_LINEAR_VELOCITY_X;
+  controller_->reference_interfaces_[1] = 0.0;
+  controller_->reference_interfaces_[2] = 0.0;
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  // the correction of 1.45 m/s is clamped to 0.5 m/s
+  EXPECT_DOUBLE_EQ(controller_->twist_feedback_.getCorrection()[0], 0.5);
+  for (size_t i = 0; i < NR_CMD_ITFS; ++i)
+  {
+    EXPECT_DOUBLE_EQ(joint_command_values_[i], 4.0);
+  }
+
+  // without a reference the wheels stop and the feedback is reset
+  controller_->reference_interfaces_[0] = std::numeric_limits<double>::quiet_NaN();
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  EXPECT_EQ(joint_command_values_[1], 0.0);
+  EXPECT_EQ(controller_->twist_feedback_.getCorrection()[0], 0.0);
+}
+
+TEST_F(MecanumDriveControllerTest, when_twist_feedback_and_limits_enabled_expect_limited_commands)
+{
+  using mecanum_drive_controller::AxisLimits;
+  using mecanum_drive_controller::TwistFeedbackGains;
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  controller_->twist_limiter_.configure({}, 2.0);
+  controller_->twist_feedback_enabled_ = true;
+  controller_->twist_feedback_.configure(
+    {TwistFeedbackGains{1.0, 10.0, 0.5}, TwistFeedbackGains{}, TwistFeedbackGains{}});
+  ASSERT_TRUE(controller_->set_chained_mode(true));
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  auto state_interfaces = controller_->export_state_interfaces();
+  const size_t saturated_offset = 6u + NR_CMD_ITFS;
+
+  // the base lags behind (FK estimates 0.05 m/s), the correction pushes the wheels to the limit
+  for (int cycle = 0; cycle < 10; ++cycle)
+  {
+    controller_->reference_interfaces_[0] = 0.9;
+    controller_->reference_interfaces_[1] = 0.0;
+    controller_->reference_interfaces_[2] = 0.0;
+    ASSERT_EQ(
+      controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+      controller_interface::return_type::OK);
+    EXPECT_GT(controller_->twist_feedback_.getCorrection()[0], 0.1);
+    for (size_t i = 0; i < NR_CMD_ITFS; ++i)
+    {
+      EXPECT_LE(std::abs(joint_command_values_[i]), 2.0 + 1e-9);
+      // without the limit the corrected reference would give more than 2.0 rad/s
+      EXPECT_EQ(state_interfaces[saturated_offset + i].get_value(), 1.0);
+    }
+    // the wheel velocity limit stops the integration
+    EXPECT_EQ(controller_->twist_feedback_.getIntegrals()[0], 0.0);
+  }
+
+  // while the acceleration limit ramps the reference up, the base follows the commands one cycle
+  // late: the error against the limited twist is one step of the ramp, the integral stays small
+  // instead of winding up towards the unlimited reference
+  controller_->twist_limiter_.configure(
+    {AxisLimits{0.0, 1.0, 0.0}, AxisLimits{}, AxisLimits{}}, 2.0);
+  controller_->twist_feedback_.configure(
+    {TwistFeedbackGains{0.5, 10.0, 0.5}, TwistFeedbackGains{}, TwistFeedbackGains{}});
+  joint_state_values_.fill(0.0);
+  for (int cycle = 0; cycle < 50; ++cycle)
+  {
+    ASSERT_EQ(
+      controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+      controller_interface::return_type::OK);
+    EXPECT_LT(std::abs(controller_->twist_feedback_.getIntegrals()[0]), 0.02);
+    std::copy(
+      joint_command_values_.begin(), joint_command_values_.end(), joint_state_values_.begin());
+  }
+  EXPECT_NEAR(controller_->twist_limiter_.getVelocity()[0], 0.5, 1e-9);
+}
+
+TEST_F(MecanumDriveControllerTest, when_reference_nan_with_feedback_and_limits_expect_ramp_to_zero)
+{
+  using mecanum_drive_controller::AxisLimits;
+  using mecanum_drive_controller::TwistFeedbackGains;
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  controller_->twist_limiter_.configure(
+    {AxisLimits{0.0, 1.0, 0.0}, AxisLimits{}, AxisLimits{}}, 2.0);
+  controller_->twist_feedback_enabled_ = true;
+  controller_->twist_feedback_.configure(
+    {TwistFeedbackGains{0.5, 10.0, 0.5}, TwistFeedbackGains{}, TwistFeedbackGains{}});
+  ASSERT_TRUE(controller_->set_chained_mode(true));
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+
+  // ramp up to 0.4 m/s, the base follows the commands
+  controller_->reference_interfaces_[0] = 0.4;
+  controller_->reference_interfaces_[1] = 0.0;
+  controller_->reference_interfaces_[2] = 0.0;
+  for (int cycle = 0; cycle < 100; ++cycle)
+  {
+    ASSERT_EQ(
+      controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+      controller_interface::return_type::OK);
+    std::copy(
+      joint_command_values_.begin(), joint_command_values_.end(), joint_state_values_.begin());
+  }
+  ASSERT_NEAR(joint_command_values_[0], 0.8, 1e-3);
+
+  // the reference is lost while the wheels still turn: only the limits ramp the commands down,
+  // the feedback must not drive the base against the zero twist
+  controller_->reference_interfaces_[0] = std::numeric_limits<double>::quiet_NaN();
+  for (int cycle = 1; cycle <= 60; ++cycle)
+  {
+    ASSERT_EQ(
+      controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+      controller_interface::return_type::OK);
+    EXPECT_EQ(controller_->twist_feedback_.getCorrection()[0], 0.0);
+    EXPECT_EQ(controller_->twist_feedback_.getIntegrals()[0], 0.0);
+    for (size_t i = 0; i < NR_CMD_ITFS; ++i)
+    {
+      EXPECT_NEAR(joint_command_values_[i], 2.0 * std::max(0.4 - 0.01 * cycle, 0.0), 1e-9);
+    }
+  }
+}
+
+TEST_F(MecanumDriveControllerTest, when_configured_expect_preallocated_diagnostics_values)
+{
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  if (!controller_->diagnostics_publisher_)
+  {
+    GTEST_SKIP() << "diagnostics compiled out";
+  }
+
+  // filling the values in the control loop must not allocate
+  const auto & status = controller_->diagnostics_publisher_->msg_.status.front();
+  ASSERT_FALSE(status.values.empty());
+  for (const auto & key_value : status.values)
+  {
+    EXPECT_GE(key_value.value.capacity(), 24u) << key_value.key;
+  }
+}
+
+TEST_F(MecanumDriveControllerTest, when_wheel_states_nan_expect_slip_flags_cleared)
+{
+  SetUpController();
+  ASSERT_EQ(controller_->on_configure(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  controller_->slip_detection_enabled_ = true;
+  controller_->slip_detector_.configure(NR_CMD_ITFS, 0.5, 0.05, true);
+  ASSERT_TRUE(controller_->set_chained_mode(true));
+  ASSERT_EQ(controller_->on_activate(rclcpp_lifecycle::State()), NODE_SUCCESS);
+  auto state_interfaces = controller_->export_state_interfaces();
+  const size_t slipping_offset = 6u;
+
+  controller_->reference_interfaces_[0] = 0.0;
+  controller_->reference_interfaces_[1] = 0.0;
+  controller_->reference_interfaces_[2] = 0.0;
+  // wheel 2 spins up
+  joint_state_values_[2] = 5.0;
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  ASSERT_TRUE(controller_->slip_detector_.isSlipping());
+  EXPECT_EQ(
+    state_interfaces[slipping_offset + controller_->slip_detector_.slippingWheel()].get_value(),
+    1.0);
+
+  // no FK in this cycle, the slip of the last cycle must not be reported
+  joint_state_values_[2] = std::numeric_limits<double>::quiet_NaN();
+  ASSERT_EQ(
+    controller_->update(controller_->get_node()->now(), rclcpp::Duration::from_seconds(0.01)),
+    controller_interface::return_type::OK);
+  EXPECT_FALSE(controller_->slip_detector_.isSlipping());
+  for (size_t i = 0; i < NR_CMD_ITFS; ++i)
+  {
+    EXPECT_EQ(state_interfaces[slipping_offset + i].get_value(), 0.0);
+  }
 }
 
 int main(int argc, char ** argv)
@@ -79,6 +79,26 @@ class TestableMecanumDriveController : public mecanum_drive_controller::MecanumD
   FRIEND_TEST(
     MecanumDriveControllerTest,
     when_ref_timeout_zero_for_reference_callback_expect_reference_msg_being_used_only_once);
+  FRIEND_TEST(
+    MecanumDriveControllerTest,
+    when_reference_callback_runs_concurrently_with_update_expect_consistent_commands);
+  FRIEND_TEST(
+    MecanumDriveControllerTest, when_using_sim_time_expect_timeout_and_stamps_from_update_time);
+  FRIEND_TEST(
+    MecanumDriveControllerTest, when_reference_deadline_missed_expect_commands_set_to_zero);
+  FRIEND_TEST(
+    MecanumDriveControllerTest, when_chained_only_expect_no_topics_and_odometry_state_interfaces);
+  FRIEND_TEST(
+    MecanumDriveControllerTest, when_wheel_velocity_limited_expect_saturated_state_interfaces);
+  FRIEND_TEST(MecanumDriveControllerTest, when_twist_feedback_enabled_expect_corrected_reference);
+  FRIEND_TEST(MecanumDriveControllerTest, when_configured_expect_preallocated_diagnostics_values);
+  FRIEND_TEST(
+    MecanumDriveControllerTest, when_twist_feedback_and_limits_enabled_expect_limited_commands);
+  FRIEND_TEST(
+    MecanumDriveControllerTest, when_reference_nan_with_feedback_and_limits_expect_ramp_to_zero);
+  FRIEND_TEST(MecanumDriveControllerTest, when_wheel_states_nan_expect_slip_flags_cleared);
+  FRIEND_TEST(
+    MecanumDriveControllerTest, when_reconfigured_expect_exported_state_interfaces_still_valid);
 
 public:
   controller_interface::CallbackReturn on_configure(
@@ -86,7 +106,7 @@ public:
   {
     auto ret = mecanum_drive_controller::MecanumDriveController::on_configure(previous_state);
     // Only if on_configure is successful create subscription
-    if (ret == CallbackReturn::SUCCESS)
+    if (ret == CallbackReturn::SUCCESS && ref_subscriber_)
     {
       ref_subscriber_wait_set_.add_subscription(ref_subscriber_);
     }
@@ -0,0 +1,126 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+
+using mecanum_drive_controller::MecanumKinematics;
+
+namespace
+{
+// Floating-point value comparison threshold
+const double EPS = 1e-9;
+}  // namespace
+
+TEST(MecanumKinematicsTest, when_base_frame_offset_is_zero_expect_classic_mecanum_ik)
+{
+  MecanumKinematics kinematics;
+  ASSERT_TRUE(kinematics.configure(1.0, 0.5, {0.0, 0.0, 0.0}));
+  ASSERT_EQ(kinematics.size(), MecanumKinematics::NR_DEFAULT_WHEELS);
+
+  std::vector<double> wheel_velocities(kinematics.size());
+  kinematics.inverse({1.5, 0.0, 0.0}, wheel_velocities);
+  for (const auto & wheel_velocity : wheel_velocities)
+  {
+    EXPECT_EQ(wheel_velocity, 3.0);
+  }
+
+  kinematics.inverse({0.0, 0.0, 1.0}, wheel_velocities);
+  EXPECT_NEAR(wheel_velocities[0], -2.0, EPS);
+  EXPECT_NEAR(wheel_velocities[1], -2.0, EPS);
+  EXPECT_NEAR(wheel_velocities[2], 2.0, EPS);
+  EXPECT_NEAR(wheel_velocities[3], 2.0, EPS);
+}
+
+TEST(MecanumKinematicsTest, when_base_frame_offset_is_set_expect_fk_to_invert_ik)
+{
+  MecanumKinematics kinematics;
+  ASSERT_TRUE(kinematics.configure(0.7, 0.05, {0.1, -0.2, 0.3}));
+
+  const MecanumKinematics::Twist twist = {0.4, -0.3, 0.5};
+  std::vector<double> wheel_velocities(kinematics.size());
+  kinematics.inverse(twist, wheel_velocities);
+
+  MecanumKinematics::Twist twist_from_fk;
+  kinematics.forward(wheel_velocities, twist_from_fk);
+  for (size_t i = 0; i < twist.size(); ++i)
+  {
+    EXPECT_NEAR(twist_from_fk[i], twist[i], EPS);
+  }
+}
+
+TEST(MecanumKinematicsTest, when_wheels_geometry_describes_classic_base_expect_same_ik)
+{
+  const double lxly = 0.7;
+  MecanumKinematics classic_kinematics;
+  ASSERT_TRUE(classic_kinematics.configure(lxly, 0.05, {0.1, -0.2, 0.3}));
+
+  // front_left, back_left, back_right, front_right
+  const std::vector<MecanumKinematics::WheelGeometry> wheels = {
+    {0.5 * lxly, 0.5 * lxly, -M_PI_4, 0.05},
+    {-0.5 * lxly, 0.5 * lxly, M_PI_4, 0.05},
+    {-0.5 * lxly, -0.5 * lxly, -M_PI_4, 0.05},
+    {0.5 * lxly, -0.5 * lxly, M_PI_4, 0.05}};
+  MecanumKinematics kinematics;
+  ASSERT_TRUE(kinematics.configure(wheels, {0.1, -0.2, 0.3}));
+
+  std::vector<double> classic_wheel_velocities(classic_kinematics.size());
+  std::vector<double> wheel_velocities(kinematics.size());
+  classic_kinematics.inverse({0.4, -0.3, 0.5}, classic_wheel_velocities);
+  kinematics.inverse({0.4, -0.3, 0.5}, wheel_velocities);
+  for (size_t i = 0; i < wheel_velocities.size(); ++i)
+  {
+    EXPECT_NEAR(wheel_velocities[i], classic_wheel_velocities[i], EPS);
+  }
+}
+
+TEST(MecanumKinematicsTest, when_base_has_six_wheels_expect_fk_to_invert_ik)
+{
+  const std::vector<MecanumKinematics::WheelGeometry> wheels = {
+    {0.6, 0.3, -M_PI_4, 0.05},  {0.0, 0.3, M_PI_4, 0.05},   {-0.6, 0.3, -M_PI_4, 0.05},
+    {-0.6, -0.3, M_PI_4, 0.05}, {0.0, -0.3, -M_PI_4, 0.05}, {0.6, -0.3, M_PI_4, 0.05}};
+  MecanumKinematics kinematics;
+  ASSERT_TRUE(kinematics.configure(wheels, {0.0, 0.0, 0.0}));
+  ASSERT_EQ(kinematics.size(), wheels.size());
+
+  const MecanumKinematics::Twist twist = {-0.2, 0.7, -0.4};
+  std::vector<double> wheel_velocities(kinematics.size());
+  kinematics.inverse(twist, wheel_velocities);
+
+  MecanumKinematics::Twist twist_from_fk;
+  kinematics.forward(wheel_velocities, twist_from_fk);
+  for (size_t i = 0; i < twist.size(); ++i)
+  {
+    EXPECT_NEAR(twist_from_fk[i], twist[i], EPS);
+  }
+}
+
+TEST(MecanumKinematicsTest, when_wheels_do_not_span_twist_space_expect_configure_failure)
+{
+  MecanumKinematics kinematics;
+  // two wheels are not enough
+  EXPECT_FALSE(kinematics.configure(
+    std::vector<MecanumKinematics::WheelGeometry>{
+      {0.5, 0.5, -M_PI_4, 0.05}, {-0.5, 0.5, M_PI_4, 0.05}},
+    {0.0, 0.0, 0.0}));
+  // all rollers parallel and wheels on the same line
+  EXPECT_FALSE(kinematics.configure(
+    std::vector<MecanumKinematics::WheelGeometry>{
+      {0.5, 0.0, M_PI_4, 0.05}, {0.0, 0.0, M_PI_4, 0.05}, {-0.5, 0.0, M_PI_4, 0.05}},
+    {0.0, 0.0, 0.0}));
+  EXPECT_FALSE(kinematics.configure(0.0, 0.0, {0.0, 0.0, 0.0}));
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/odometry_covariance.hpp"
+
+using mecanum_drive_controller::OdometryCovariance;
+
+namespace
+{
+OdometryCovariance::Coefficients coefficients()
+{
+  OdometryCovariance::Coefficients coefficients;
+  coefficients.linear = 0.01;
+  coefficients.angular = 0.02;
+  coefficients.linear_to_angular = 0.0;
+  coefficients.slip_factor = 10.0;
+  coefficients.twist_speed = 0.1;
+  return coefficients;
+}
+}  // namespace
+
+TEST(OdometryCovarianceTest, when_standing_still_expect_initial_covariance)
+{
+  OdometryCovariance covariance;
+  covariance.configure(coefficients(), {0.1, 0.2, 0.3}, {0.01, 0.02, 0.03});
+  for (int i = 0; i < 100; ++i)
+  {
+    covariance.update({0.0, 0.0, 0.0}, 0.5, 0.01, false);
+  }
+  const auto & pose = covariance.poseCovariance();
+  EXPECT_EQ(pose[0][0], 0.1);
+  EXPECT_EQ(pose[1][1], 0.2);
+  EXPECT_EQ(pose[2][2], 0.3);
+  EXPECT_EQ(pose[0][1], 0.0);
+
+  OdometryCovariance::Covariance6 message = {};
+  covariance.writePose(message);
+  EXPECT_EQ(message[0], 0.1);
+  EXPECT_EQ(message[7], 0.2);
+  EXPECT_EQ(message[35], 0.3);
+  covariance.writeTwist(message);
+  EXPECT_EQ(message[35], 0.03);
+}
+
+TEST(OdometryCovarianceTest, when_driving_expect_covariance_grows_with_distance_and_rotation)
+{
+  OdometryCovariance covariance;
+  covariance.configure(coefficients(), {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+
+  // rotation in place by 1 rad
+  for (int i = 0; i < 100; ++i)
+  {
+    covariance.update({0.0, 0.0, 1.0}, 0.01 * i, 0.01, false);
+  }
+  EXPECT_NEAR(covariance.poseCovariance()[2][2], 0.02, 1e-12);
+  EXPECT_NEAR(covariance.poseCovariance()[0][0], 0.0, 1e-12);
+
+  // 2 m along x: the orientation uncertainty spreads into y, correlated with theta
+  for (int i = 0; i < 200; ++i)
+  {
+    covariance.update({1.0, 0.0, 0.0}, 0.0, 0.01, false);
+  }
+  const auto & pose = covariance.poseCovariance();
+  EXPECT_NEAR(pose[0][0], 0.02, 1e-9);
+  // 0.01 * 2 of the distance plus the orientation variance 0.02 times the squared lever of 2 m
+  EXPECT_NEAR(pose[1][1], 0.02 + 0.02 * 4.0, 1e-3);
+  EXPECT_NEAR(pose[1][2], 0.02 * 2.0, 1e-9);
+  EXPECT_EQ(pose[1][2], pose[2][1]);
+  EXPECT_NEAR(pose[0][2], 0.0, 1e-12);
+}
+
+TEST(OdometryCovarianceTest, when_slipping_or_fast_expect_larger_covariance)
+{
+  OdometryCovariance covariance;
+  covariance.configure(coefficients(), {0.0, 0.0, 0.0}, {0.01, 0.01, 0.01});
+  covariance.update({1.0, 0.0, 0.0}, 0.0, 0.1, false);
+  const double nominal = covariance.poseCovariance()[0][0];
+  covariance.reset();
+  covariance.update({1.0, 0.0, 0.0}, 0.0, 0.1, true);
+  EXPECT_NEAR(covariance.poseCovariance()[0][0], 10.0 * nominal, 1e-12);
+
+  covariance.updateTwist(0.0);
+  EXPECT_EQ(covariance.twistVariance()[0], 0.01);
+  covariance.updateTwist(20.0);
+  EXPECT_NEAR(covariance.twistVariance()[0], 0.01 + 4.0, 1e-12);
+}
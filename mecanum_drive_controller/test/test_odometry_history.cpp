@@ -0,0 +1,122 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/odometry_history.hpp"
+
+using mecanum_drive_controller::OdometryHistory;
+using mecanum_drive_controller::OdometrySample;
+
+namespace
+{
+// Floating-point value comparison threshold
+const double EPS = 1e-9;
+constexpr int64_t PERIOD_NS = 10000000;  // 100 Hz
+
+/// Pose on a circle of radius 1 m driven at 1 rad/s, starting at the origin with heading 0.3 rad
+OdometrySample circle_sample(int64_t stamp_ns)
+{
+  const double t = static_cast<double>(stamp_ns) * 1e-9;
+  const double heading = 0.3;
+  OdometrySample sample;
+  sample.stamp_ns = stamp_ns;
+  sample.x = std::sin(heading + t) - std::sin(heading);
+  sample.y = std::cos(heading) - std::cos(heading + t);
+  sample.theta = heading + t;
+  sample.linear_x = 1.0;
+  sample.angular_z = 1.0;
+  return sample;
+}
+}  // namespace
+
+TEST(OdometryHistoryTest, when_empty_or_outside_history_expect_no_pose)
+{
+  OdometryHistory history(10);
+  OdometrySample sample;
+  EXPECT_FALSE(history.poseAt(0, sample));
+  EXPECT_FALSE(history.latest(sample));
+
+  history.push(circle_sample(PERIOD_NS));
+  history.push(circle_sample(2 * PERIOD_NS));
+  EXPECT_FALSE(history.poseAt(PERIOD_NS - 1, sample));
+  EXPECT_FALSE(history.poseAt(2 * PERIOD_NS + 1, sample));
+  ASSERT_TRUE(history.latest(sample));
+  EXPECT_EQ(sample.stamp_ns, 2 * PERIOD_NS);
+}
+
+TEST(OdometryHistoryTest, when_driving_circle_expect_exact_interpolation_between_samples)
+{
+  // 25 samples in a history of 10, the oldest ones are overwritten
+  OdometryHistory history(10);
+  for (int64_t i = 0; i < 25; ++i)
+  {
+    history.push(circle_sample(i * PERIOD_NS));
+  }
+
+  OdometrySample sample;
+  EXPECT_FALSE(history.poseAt(10 * PERIOD_NS, sample));
+  for (int64_t stamp_ns : {16 * PERIOD_NS, 17 * PERIOD_NS + 1234567, 20 * PERIOD_NS + 5000000,
+                           24 * PERIOD_NS - 1, 24 * PERIOD_NS})
+  {
+    ASSERT_TRUE(history.poseAt(stamp_ns, sample)) << stamp_ns;
+    const OdometrySample expected = circle_sample(stamp_ns);
+    EXPECT_EQ(sample.stamp_ns, stamp_ns);
+    EXPECT_NEAR(sample.x, expected.x, EPS);
+    EXPECT_NEAR(sample.y, expected.y, EPS);
+    EXPECT_NEAR(sample.theta, expected.theta, EPS);
+    EXPECT_NEAR(sample.linear_x, 1.0, EPS);
+    EXPECT_NEAR(sample.angular_z, 1.0, EPS);
+  }
+}
+
+TEST(OdometryHistoryTest, when_queried_while_written_expect_consistent_poses)
+{
+  OdometryHistory history(64);
+  history.push(circle_sample(0));
+  std::atomic<bool> running{true};
+  std::thread writer(
+    [&]()
+    {
+      for (int64_t i = 1; i < 200000; ++i)
+      {
+        history.push(circle_sample(i * PERIOD_NS));
+      }
+      running = false;
+    });
+
+  size_t nr_queries = 0;
+  OdometrySample latest;
+  while (running)
+  {
+    ASSERT_TRUE(history.latest(latest));
+    // a time in the middle of the history, which is not overwritten during the query
+    const int64_t stamp_ns = latest.stamp_ns - 20 * PERIOD_NS - PERIOD_NS / 3;
+    OdometrySample sample;
+    if (stamp_ns > 0 && history.poseAt(stamp_ns, sample))
+    {
+      const OdometrySample expected = circle_sample(stamp_ns);
+      ASSERT_NEAR(sample.x, expected.x, 1e-6);
+      ASSERT_NEAR(sample.y, expected.y, 1e-6);
+      ASSERT_NEAR(sample.theta, expected.theta, 1e-6);
+      ++nr_queries;
+    }
+  }
+  writer.join();
+  EXPECT_GT(nr_queries, 0u);
+}
@@ -0,0 +1,143 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstddef>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/odometry_integration_kernel.hpp"
+
+using mecanum_drive_controller::EulerIntegration;
+using mecanum_drive_controller::ExactIntegration;
+using mecanum_drive_controller::OdometryIntegrationKernel;
+using mecanum_drive_controller::RungeKutta2Integration;
+
+namespace
+{
+// Floating-point value comparison threshold
+const double EPS = 1e-12;
+
+/// Drives a circle of radius 1 m at 1 rad/s with the given method and a 10 Hz loop
+/// \return distance of the integrated position to the true one after 1.5 s
+template <typename Method>
+double circle_position_error(double heading_offset)
+{
+  OdometryIntegrationKernel kernel;
+  const double dt = 0.1;
+  const size_t nr_steps = 15;
+  for (size_t i = 0; i < nr_steps; ++i)
+  {
+    kernel.integrate<Method>(1.0, 0.0, 1.0, dt, heading_offset);
+  }
+  const double orientation = dt * nr_steps;
+  // the circle starts in direction heading_offset
+  const double x_true = std::sin(heading_offset + orientation) - std::sin(heading_offset);
+  const double y_true = std::cos(heading_offset) - std::cos(heading_offset + orientation);
+  return std::hypot(kernel.getX() - x_true, kernel.getY() - y_true);
+}
+
+/// Scalar Euler integration, as done by Odometry before the integration kernel was introduced.
+struct ReferenceIntegration
+{
+  void integrate(
+    double linear_x, double linear_y, double angular_z, double dt, double heading_offset)
+  {
+    orientation_ += angular_z * dt;
+
+    const double heading = heading_offset + orientation_;
+    const double cos_heading = std::cos(heading);
+    const double sin_heading = std::sin(heading);
+    position_x_ += (cos_heading * linear_x - sin_heading * linear_y) * dt;
+    position_y_ += (sin_heading * linear_x + cos_heading * linear_y) * dt;
+  }
+
+  double position_x_ = 0.0;
+  double position_y_ = 0.0;
+  double orientation_ = 0.0;
+};
+}  // namespace
+
+TEST(OdometryIntegrationKernelTest, when_reset_expect_zero_pose)
+{
+  OdometryIntegrationKernel kernel;
+  kernel.integrate(1.0, 0.5, 0.2, 0.01, 0.0);
+  ASSERT_NE(kernel.getX(), 0.0);
+
+  kernel.reset();
+  EXPECT_EQ(kernel.getX(), 0.0);
+  EXPECT_EQ(kernel.getY(), 0.0);
+  EXPECT_EQ(kernel.getRz(), 0.0);
+}
+
+TEST(OdometryIntegrationKernelTest, when_driving_straight_expect_pose_along_heading)
+{
+  OdometryIntegrationKernel kernel;
+  for (size_t i = 0; i < 100; ++i)
+  {
+    kernel.integrate(1.0, 0.0, 0.0, 0.01, M_PI_2);
+  }
+  EXPECT_NEAR(kernel.getX(), 0.0, EPS);
+  EXPECT_NEAR(kernel.getY(), 1.0, EPS);
+  EXPECT_NEAR(kernel.getRz(), 0.0, EPS);
+}
+
+TEST(OdometryIntegrationKernelTest, when_integrating_expect_same_pose_as_scalar_integration)
+{
+  OdometryIntegrationKernel kernel;
+  ReferenceIntegration reference;
+
+  for (size_t i = 0; i < 5000; ++i)
+  {
+    const double t = 0.01 * static_cast<double>(i);
+    const double linear_x = 0.8 * std::sin(0.3 * t) + 0.1;
+    const double linear_y = -0.4 * std::cos(0.7 * t);
+    const double angular_z = 0.5 * std::sin(1.1 * t);
+    const double dt = 0.01 + 0.002 * std::sin(5.0 * t);
+
+    kernel.integrate(linear_x, linear_y, angular_z, dt, -0.3);
+    reference.integrate(linear_x, linear_y, angular_z, dt, -0.3);
+
+    ASSERT_NEAR(kernel.getX(), reference.position_x_, EPS) << "step " << i;
+    ASSERT_NEAR(kernel.getY(), reference.position_y_, EPS) << "step " << i;
+    ASSERT_NEAR(kernel.getRz(), reference.orientation_, EPS) << "step " << i;
+  }
+}
+
+TEST(OdometryIntegrationKernelTest, when_driving_circle_expect_higher_order_methods_more_accurate)
+{
+  for (double heading_offset : {0.0, 0.7})
+  {
+    const double euler_error = circle_position_error<EulerIntegration>(heading_offset);
+    const double runge_kutta_2_error =
+      circle_position_error<RungeKutta2Integration>(heading_offset);
+    const double exact_error = circle_position_error<ExactIntegration>(heading_offset);
+
+    EXPECT_GT(euler_error, 1e-2);
+    EXPECT_LT(runge_kutta_2_error, euler_error / 10.0);
+    EXPECT_LT(exact_error, EPS);
+  }
+}
+
+TEST(OdometryIntegrationKernelTest, when_not_rotating_expect_same_pose_for_all_methods)
+{
+  OdometryIntegrationKernel euler;
+  OdometryIntegrationKernel exact;
+  for (size_t i = 0; i < 10; ++i)
+  {
+    euler.integrate<EulerIntegration>(0.4, -0.3, 0.0, 0.01, 0.5);
+    exact.integrate<ExactIntegration>(0.4, -0.3, 0.0, 0.01, 0.5);
+  }
+  EXPECT_NEAR(euler.getX(), exact.getX(), EPS);
+  EXPECT_NEAR(euler.getY(), exact.getY(), EPS);
+}
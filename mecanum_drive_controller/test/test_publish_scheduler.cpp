@@ -0,0 +1,90 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/publish_scheduler.hpp"
+
+using mecanum_drive_controller::PublishScheduler;
+
+namespace
+{
+constexpr int64_t MS = 1000000;  // [ns]
+
+// runs a control loop and publishes whenever the scheduler says so
+size_t count_publications(PublishScheduler & scheduler, int64_t start_ns, size_t nr_cycles)
+{
+  size_t nr_publications = 0;
+  for (size_t i = 0; i < nr_cycles; ++i)
+  {
+    const int64_t time_ns = start_ns + static_cast<int64_t>(i) * MS;
+    if (scheduler.isDue(time_ns))
+    {
+      scheduler.published(time_ns);
+      ++nr_publications;
+    }
+  }
+  return nr_publications;
+}
+}  // namespace
+
+TEST(PublishSchedulerTest, when_period_is_zero_expect_publication_in_every_cycle)
+{
+  PublishScheduler scheduler;
+  scheduler.configure(0);
+  EXPECT_EQ(count_publications(scheduler, 0, 100), 100u);
+}
+
+TEST(PublishSchedulerTest, when_period_is_not_multiple_of_control_period_expect_exact_rate)
+{
+  // 30 Hz out of a 1 kHz loop for 10 s
+  PublishScheduler scheduler;
+  scheduler.configure(33333333);
+  EXPECT_EQ(count_publications(scheduler, 5 * MS, 10000), 300u);
+}
+
+TEST(PublishSchedulerTest, when_publication_skipped_expect_retry_in_next_cycle_and_phase_kept)
+{
+  PublishScheduler scheduler;
+  scheduler.configure(10 * MS);
+
+  ASSERT_TRUE(scheduler.isDue(0));
+  scheduler.published(0);
+  EXPECT_FALSE(scheduler.isDue(9 * MS));
+  EXPECT_TRUE(scheduler.isDue(10 * MS));
+  // publisher busy at 10 ms, published at 11 ms, next deadline stays at 20 ms
+  EXPECT_TRUE(scheduler.isDue(11 * MS));
+  scheduler.published(11 * MS);
+  EXPECT_FALSE(scheduler.isDue(19 * MS));
+  EXPECT_TRUE(scheduler.isDue(20 * MS));
+
+  // missed deadlines are skipped, not published in a burst
+  scheduler.published(45 * MS);
+  EXPECT_FALSE(scheduler.isDue(49 * MS));
+  EXPECT_TRUE(scheduler.isDue(50 * MS));
+}
+
+TEST(PublishSchedulerTest, when_time_jumps_back_expect_publication)
+{
+  PublishScheduler scheduler;
+  scheduler.configure(10 * MS);
+
+  scheduler.published(1000 * MS);
+  EXPECT_FALSE(scheduler.isDue(1005 * MS));
+  EXPECT_TRUE(scheduler.isDue(0));
+  scheduler.published(0);
+  EXPECT_FALSE(scheduler.isDue(5 * MS));
+  EXPECT_TRUE(scheduler.isDue(10 * MS));
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/reference_mailbox.hpp"
+
+using mecanum_drive_controller::ReferenceMailbox;
+using mecanum_drive_controller::TwistReference;
+
+namespace
+{
+TwistReference make_reference(int64_t i)
+{
+  TwistReference reference;
+  reference.linear_x = static_cast<double>(i);
+  reference.linear_y = 2.0 * static_cast<double>(i);
+  reference.angular_z = -static_cast<double>(i);
+  reference.stamp_ns = i;
+  return reference;
+}
+}  // namespace
+
+TEST(ReferenceMailboxTest, when_nothing_written_expect_no_new_value)
+{
+  ReferenceMailbox mailbox;
+  TwistReference reference = make_reference(7);
+
+  EXPECT_FALSE(mailbox.readFromRT(reference));
+  EXPECT_EQ(reference.stamp_ns, 7);
+  EXPECT_TRUE(std::isnan(mailbox.readFromNonRT().linear_x));
+}
+
+TEST(ReferenceMailboxTest, when_value_written_expect_it_read_exactly_once)
+{
+  ReferenceMailbox mailbox;
+  TwistReference reference;
+
+  mailbox.writeFromNonRT(make_reference(1));
+  mailbox.writeFromNonRT(make_reference(2));
+  EXPECT_EQ(mailbox.readFromNonRT().stamp_ns, 2);
+
+  ASSERT_TRUE(mailbox.readFromRT(reference));
+  EXPECT_EQ(reference.linear_x, 2.0);
+  EXPECT_EQ(reference.stamp_ns, 2);
+  EXPECT_FALSE(mailbox.readFromRT(reference));
+  EXPECT_EQ(reference.stamp_ns, 2);
+
+  mailbox.writeFromNonRT(make_reference(3));
+  ASSERT_TRUE(mailbox.readFromRT(reference));
+  EXPECT_EQ(reference.stamp_ns, 3);
+
+  mailbox.reset(TwistReference());
+  EXPECT_FALSE(mailbox.readFromRT(reference));
+  EXPECT_TRUE(std::isnan(mailbox.readFromNonRT().linear_x));
+}
+
+// writer at ~10 kHz against a reader spinning as fast as possible, configure with
+// -DMECANUM_DRIVE_CONTROLLER_SANITIZE_THREAD=ON to check the hand-over for data races
+TEST(ReferenceMailboxTest, when_written_and_read_concurrently_expect_consistent_values)
+{
+  constexpr int64_t NR_WRITES = 5000;
+  ReferenceMailbox mailbox;
+  std::atomic<bool> writer_done{false};
+
+  std::thread writer(
+    [&]()
+    {
+      for (int64_t i = 1; i <= NR_WRITES; ++i)
+      {
+        mailbox.writeFromNonRT(make_reference(i));
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      writer_done = true;
+    });
+
+  TwistReference reference;
+  int64_t last_stamp = 0;
+  size_t nr_reads = 0;
+  bool consistent = true;
+  bool monotonic = true;
+  while (true)
+  {
+    const bool done = writer_done;
+    if (mailbox.readFromRT(reference))
+    {
+      consistent = consistent && reference.linear_x == static_cast<double>(reference.stamp_ns) &&
+                   reference.linear_y == 2.0 * static_cast<double>(reference.stamp_ns) &&
+                   reference.angular_z == -static_cast<double>(reference.stamp_ns);
+      monotonic = monotonic && reference.stamp_ns > last_stamp;
+      last_stamp = reference.stamp_ns;
+      ++nr_reads;
+    }
+    if (done && last_stamp == NR_WRITES)
+    {
+      break;
+    }
+  }
+  writer.join();
+
+  EXPECT_TRUE(consistent);
+  EXPECT_TRUE(monotonic);
+  EXPECT_GT(nr_reads, 0u);
+  EXPECT_EQ(last_stamp, NR_WRITES);
+}
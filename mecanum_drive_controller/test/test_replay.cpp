@@ -0,0 +1,315 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/flight_recorder.hpp"
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+#include "mecanum_drive_controller/replay.hpp"
+
+using mecanum_drive_controller::FlightRecorder;
+using mecanum_drive_controller::MecanumKinematics;
+using mecanum_drive_controller::ReplayFileResult;
+using mecanum_drive_controller::ReplayParameters;
+using mecanum_drive_controller::ReplayResult;
+using mecanum_drive_controller::WheelLog;
+
+namespace
+{
+constexpr double WHEELS_RADIUS = 0.05;
+constexpr double SUM_OF_PROJECTIONS = 0.4;
+constexpr int64_t PERIOD_NS = 10000000;
+constexpr size_t NR_CYCLES = 101;
+}  // namespace
+
+class ReplayTest : public ::testing::Test
+{
+public:
+  void SetUp()
+  {
+    prefix_ = "/tmp/test_replay_" + std::to_string(::getpid());
+    kinematics_.configure(SUM_OF_PROJECTIONS, WHEELS_RADIUS, {0.0, 0.0, 0.0});
+  }
+
+  void TearDown()
+  {
+    for (const auto & file : files_)
+    {
+      std::remove(file.c_str());
+    }
+  }
+
+protected:
+  // CSV of driving forward at 'linear_x' for one second, as written by flight_recorder_decoder
+  std::string write_csv(const std::string & name, double linear_x)
+  {
+    const std::string path = prefix_ + name;
+    files_.push_back(path);
+    std::vector<double> wheels(MecanumKinematics::NR_DEFAULT_WHEELS);
+    kinematics_.inverse({linear_x, 0.0, 0.0}, wheels);
+
+    FILE * file = std::fopen(path.c_str(), "w");
+    std::fprintf(file, "stamp_ns,wheel_state_0,wheel_state_1,wheel_state_2,wheel_state_3,pose_x\n");
+    for (size_t i = 0; i < NR_CYCLES; ++i)
+    {
+      std::fprintf(
+        file, "%lld,%.17g,%.17g,%.17g,%.17g,0.0\n", static_cast<long long>(i * PERIOD_NS),
+        wheels[0], wheels[1], wheels[2], wheels[3]);
+    }
+    std::fclose(file);
+    return path;
+  }
+
+  // CSV with the given header and one row of zeros
+  std::string write_csv_header(const std::string & name, const std::vector<std::string> & header)
+  {
+    const std::string path = prefix_ + name;
+    files_.push_back(path);
+    FILE * file = std::fopen(path.c_str(), "w");
+    for (size_t i = 0; i < header.size(); ++i)
+    {
+      std::fprintf(file, "%s%s", i > 0 ? "," : "", header[i].c_str());
+    }
+    for (size_t i = 0; i < header.size(); ++i)
+    {
+      std::fprintf(file, "%s0", i > 0 ? "," : "\n");
+    }
+    std::fprintf(file, "\n");
+    std::fclose(file);
+    return path;
+  }
+
+  ReplayParameters parameters(double wheels_radius) const
+  {
+    ReplayParameters replay_parameters;
+    replay_parameters.wheels_radius = wheels_radius;
+    replay_parameters.sum_of_robot_center_projection_on_X_Y_axis = SUM_OF_PROJECTIONS;
+    return replay_parameters;
+  }
+
+  std::string prefix_;
+  std::vector<std::string> files_;
+  MecanumKinematics kinematics_;
+};
+
+TEST_F(ReplayTest, when_csv_replayed_expect_odometry_scaled_with_wheels_radius)
+{
+  WheelLog log;
+  std::string error;
+  ASSERT_TRUE(mecanum_drive_controller::loadWheelLog(write_csv(".csv", 0.5), log, error)) << error;
+  ASSERT_EQ(log.size(), NR_CYCLES);
+  ASSERT_EQ(log.nr_wheels, 4u);
+  EXPECT_TRUE(log.references.empty());
+
+  ReplayResult result;
+  ASSERT_TRUE(mecanum_drive_controller::replay(log, parameters(WHEELS_RADIUS), result, error));
+  EXPECT_EQ(result.nr_integrated, NR_CYCLES - 1);
+  EXPECT_NEAR(result.x, 0.5, 1e-9);
+  EXPECT_NEAR(result.y, 0.0, 1e-9);
+  EXPECT_NEAR(result.path_length, 0.5, 1e-9);
+  EXPECT_TRUE(std::isnan(result.command_rms_error));
+
+  ASSERT_TRUE(mecanum_drive_controller::replay(log, parameters(2 * WHEELS_RADIUS), result, error));
+  EXPECT_NEAR(result.x, 1.0, 1e-9);
+
+  EXPECT_FALSE(mecanum_drive_controller::replay(log, parameters(0.0), result, error));
+  EXPECT_THAT(error, ::testing::HasSubstr("valid base"));
+}
+
+TEST_F(ReplayTest, when_flight_recorder_replayed_with_same_parameters_expect_same_commands)
+{
+  const std::string path = prefix_ + ".bin";
+  files_.push_back(path);
+  FlightRecorder recorder;
+  std::string error;
+  ASSERT_TRUE(recorder.open(path, 4, 1000, std::chrono::seconds(1), error)) << error;
+  std::vector<double> wheels(4);
+  std::vector<double> record(recorder.nrValues(), 0.0);
+  for (size_t i = 0; i < NR_CYCLES; ++i)
+  {
+    const MecanumKinematics::Twist reference = {0.2, -0.1, 0.3};
+    kinematics_.inverse(reference, wheels);
+    std::copy(wheels.begin(), wheels.end(), record.begin());
+    std::copy(wheels.begin(), wheels.end(), record.begin() + 4);
+    std::copy(reference.begin(), reference.end(), record.begin() + 8);
+    recorder.write(static_cast<int64_t>(i) * PERIOD_NS, record.data());
+  }
+  recorder.close();
+
+  WheelLog log;
+  ASSERT_TRUE(mecanum_drive_controller::loadWheelLog(path, log, error)) << error;
+  ASSERT_EQ(log.size(), NR_CYCLES);
+
+  ReplayResult result;
+  ASSERT_TRUE(mecanum_drive_controller::replay(log, parameters(WHEELS_RADIUS), result, error));
+  EXPECT_NEAR(result.command_rms_error, 0.0, 1e-12);
+  EXPECT_NEAR(result.theta, 0.3, 1e-9);
+
+  ASSERT_TRUE(
+    mecanum_drive_controller::replay(log, parameters(1.1 * WHEELS_RADIUS), result, error));
+  EXPECT_GT(result.command_rms_error, 0.1);
+}
+
+TEST_F(ReplayTest, when_csv_wheel_columns_invalid_expect_rejected)
+{
+  WheelLog log;
+  std::string error;
+  const std::vector<std::string> states = {
+    "stamp_ns", "wheel_state_0", "wheel_state_1", "wheel_state_2", "wheel_state_3"};
+
+  auto header = states;
+  header.insert(
+    header.end(), {"wheel_command_0", "wheel_command_1", "wheel_command_2", "wheel_command_3"});
+  ASSERT_TRUE(
+    mecanum_drive_controller::loadWheelLog(write_csv_header("_ok.csv", header), log, error))
+    << error;
+  EXPECT_EQ(log.nr_wheels, 4u);
+  EXPECT_EQ(log.wheel_commands.size(), 4u);
+
+  // command of a wheel without state
+  header = states;
+  header.insert(
+    header.end(), {"wheel_command_0", "wheel_command_1", "wheel_command_2", "wheel_command_7"});
+  EXPECT_FALSE(
+    mecanum_drive_controller::loadWheelLog(write_csv_header("_range.csv", header), log, error));
+  EXPECT_THAT(error, ::testing::HasSubstr("wheel index 7"));
+
+  // duplicate command
+  header = states;
+  header.insert(
+    header.end(), {"wheel_command_0", "wheel_command_1", "wheel_command_1", "wheel_command_3"});
+  EXPECT_FALSE(mecanum_drive_controller::loadWheelLog(
+    write_csv_header("_duplicate_command.csv", header), log, error));
+  EXPECT_THAT(error, ::testing::HasSubstr("duplicate wheel index 1"));
+
+  // duplicate state, wheel 2 would stay NaN
+  header = {"stamp_ns", "wheel_state_0", "wheel_state_1", "wheel_state_1", "wheel_state_3"};
+  EXPECT_FALSE(mecanum_drive_controller::loadWheelLog(
+    write_csv_header("_duplicate_state.csv", header), log, error));
+  EXPECT_THAT(error, ::testing::HasSubstr("duplicate wheel index 1"));
+
+  // missing state
+  header = {"stamp_ns", "wheel_state_0", "wheel_state_1", "wheel_state_3"};
+  EXPECT_FALSE(mecanum_drive_controller::loadWheelLog(
+    write_csv_header("_missing_state.csv", header), log, error));
+  EXPECT_THAT(error, ::testing::HasSubstr("no 'wheel_state_2' column"));
+
+  // indices that are not numbers, or too large for the columns, must not allocate or wrap
+  for (const std::string name :
+       {"wheel_state_x", "wheel_state_", "wheel_state_-1", "wheel_state_1x",
+        "wheel_state_99999999999999999999999", "wheel_command_1000"})
+  {
+    header = states;
+    header.push_back(name);
+    EXPECT_FALSE(mecanum_drive_controller::loadWheelLog(
+      write_csv_header("_index.csv", header), log, error))
+      << name;
+    EXPECT_THAT(error, ::testing::HasSubstr("invalid wheel index in '" + name + "'"));
+  }
+}
+
+TEST_F(ReplayTest, when_log_has_six_wheels_expect_replayed_only_with_their_geometry)
+{
+  const std::vector<MecanumKinematics::WheelGeometry> wheels = {
+    {0.6, 0.3, -M_PI_4, WHEELS_RADIUS},  {0.0, 0.3, M_PI_4, WHEELS_RADIUS},
+    {-0.6, 0.3, -M_PI_4, WHEELS_RADIUS}, {-0.6, -0.3, M_PI_4, WHEELS_RADIUS},
+    {0.0, -0.3, -M_PI_4, WHEELS_RADIUS}, {0.6, -0.3, M_PI_4, WHEELS_RADIUS}};
+  MecanumKinematics kinematics;
+  ASSERT_TRUE(kinematics.configure(wheels, {0.0, 0.0, 0.0}));
+  std::vector<double> velocities(wheels.size());
+  kinematics.inverse({0.5, 0.0, 0.0}, velocities);
+
+  const std::string path = prefix_ + "_six_wheels.csv";
+  files_.push_back(path);
+  FILE * file = std::fopen(path.c_str(), "w");
+  std::fprintf(file, "stamp_ns");
+  for (size_t j = 0; j < wheels.size(); ++j)
+  {
+    std::fprintf(file, ",wheel_state_%zu", j);
+  }
+  for (size_t i = 0; i < NR_CYCLES; ++i)
+  {
+    std::fprintf(file, "\n%lld", static_cast<long long>(i * PERIOD_NS));
+    for (const double velocity : velocities)
+    {
+      std::fprintf(file, ",%.17g", velocity);
+    }
+  }
+  std::fprintf(file, "\n");
+  std::fclose(file);
+
+  WheelLog log;
+  std::string error;
+  ASSERT_TRUE(mecanum_drive_controller::loadWheelLog(path, log, error)) << error;
+  ASSERT_EQ(log.nr_wheels, wheels.size());
+
+  ReplayResult result;
+  EXPECT_FALSE(mecanum_drive_controller::replay(log, parameters(WHEELS_RADIUS), result, error));
+  EXPECT_THAT(error, ::testing::HasSubstr("needs the geometry of each wheel"));
+
+  auto replay_parameters = parameters(WHEELS_RADIUS);
+  replay_parameters.wheels_geometry = {wheels.begin(), wheels.begin() + 4};
+  EXPECT_FALSE(mecanum_drive_controller::replay(log, replay_parameters, result, error));
+  EXPECT_THAT(error, ::testing::HasSubstr("does not match"));
+
+  replay_parameters.wheels_geometry = wheels;
+  ASSERT_TRUE(mecanum_drive_controller::replay(log, replay_parameters, result, error)) << error;
+  EXPECT_EQ(result.nr_integrated, NR_CYCLES - 1);
+  EXPECT_NEAR(result.x, 0.5, 1e-9);
+  EXPECT_NEAR(result.y, 0.0, 1e-9);
+
+  // wheels without a radius take the one of the parameter set
+  for (auto & wheel : replay_parameters.wheels_geometry)
+  {
+    wheel.radius = 0.0;
+  }
+  replay_parameters.wheels_radius = 2 * WHEELS_RADIUS;
+  ASSERT_TRUE(mecanum_drive_controller::replay(log, replay_parameters, result, error)) << error;
+  EXPECT_NEAR(result.x, 1.0, 1e-9);
+}
+
+TEST_F(ReplayTest, when_files_replayed_in_parallel_expect_results_in_file_order)
+{
+  std::vector<std::string> files;
+  for (int i = 0; i < 6; ++i)
+  {
+    files.push_back(write_csv("_" + std::to_string(i) + ".csv", 0.1 * (i + 1)));
+  }
+  files.push_back(prefix_ + "_missing.csv");
+  const std::vector<ReplayParameters> parameter_sets = {
+    parameters(WHEELS_RADIUS), parameters(2 * WHEELS_RADIUS)};
+
+  const auto sequential = mecanum_drive_controller::replayFiles(files, parameter_sets, 1);
+  const auto parallel = mecanum_drive_controller::replayFiles(files, parameter_sets, 4);
+  ASSERT_EQ(parallel.size(), files.size());
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    EXPECT_EQ(parallel[i].file, files[i]);
+    EXPECT_EQ(parallel[i].error.empty(), i < 6);
+    ASSERT_EQ(parallel[i].results.size(), sequential[i].results.size());
+    for (size_t j = 0; j < parallel[i].results.size(); ++j)
+    {
+      EXPECT_EQ(parallel[i].results[j].x, sequential[i].results[j].x);
+      EXPECT_NEAR(parallel[i].results[j].x, 0.1 * (i + 1) * (j + 1), 1e-9);
+    }
+  }
+}
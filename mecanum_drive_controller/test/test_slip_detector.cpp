@@ -0,0 +1,132 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+#include "mecanum_drive_controller/slip_detector.hpp"
+
+using mecanum_drive_controller::MecanumKinematics;
+using mecanum_drive_controller::SlipDetector;
+
+namespace
+{
+const double EPS = 1e-9;
+}  // namespace
+
+class SlipDetectorTest : public ::testing::Test
+{
+public:
+  void SetUp()
+  {
+    ASSERT_TRUE(kinematics_.configure(0.4, 0.05, {0.1, 0.0, 0.2}));
+    ASSERT_TRUE(kinematics_.setDownweightedWheelWeight(0.0));
+    wheel_velocities_.resize(kinematics_.size());
+    kinematics_.inverse(twist_, wheel_velocities_);
+  }
+
+protected:
+  MecanumKinematics kinematics_;
+  const MecanumKinematics::Twist twist_ = {0.5, -0.2, 0.3};
+  std::vector<double> wheel_velocities_;
+};
+
+TEST_F(SlipDetectorTest, when_wheels_consistent_expect_no_slip)
+{
+  SlipDetector detector;
+  detector.configure(kinematics_.size(), 0.5, 0.05, true);
+
+  MecanumKinematics::Twist twist;
+  for (int i = 0; i < 3; ++i)
+  {
+    detector.update(kinematics_, wheel_velocities_, twist);
+    EXPECT_FALSE(detector.isSlipping());
+    EXPECT_NEAR(detector.residualNorm(), 0.0, EPS);
+    for (size_t j = 0; j < twist.size(); ++j)
+    {
+      EXPECT_NEAR(twist[j], twist_[j], EPS);
+    }
+  }
+}
+
+TEST_F(SlipDetectorTest, when_wheel_spins_expect_it_flagged_and_ignored_in_twist)
+{
+  SlipDetector detector;
+  detector.configure(kinematics_.size(), 0.5, 0.05, true);
+  MecanumKinematics::Twist twist;
+  detector.update(kinematics_, wheel_velocities_, twist);
+
+  // wheel 2 loses traction and spins up
+  std::vector<double> slipping = wheel_velocities_;
+  slipping[2] += 5.0;
+  for (int i = 0; i < 3; ++i)
+  {
+    detector.update(kinematics_, slipping, twist);
+    EXPECT_TRUE(detector.isSlipping());
+    EXPECT_EQ(detector.slippingWheel(), 2u);
+    EXPECT_GT(detector.residualNorm(), 1.0);
+    // the other three wheels alone determine the twist
+    for (size_t j = 0; j < twist.size(); ++j)
+    {
+      EXPECT_NEAR(twist[j], twist_[j], EPS);
+    }
+  }
+  EXPECT_EQ(detector.slipEvents()[2], 1u);
+
+  detector.update(kinematics_, wheel_velocities_, twist);
+  EXPECT_FALSE(detector.isSlipping());
+  EXPECT_EQ(detector.slippingWheel(), SlipDetector::NO_WHEEL);
+}
+
+TEST_F(SlipDetectorTest, when_reset_while_slipping_expect_slip_state_cleared)
+{
+  SlipDetector detector;
+  detector.configure(kinematics_.size(), 0.5, 0.05, true);
+  std::vector<double> slipping = wheel_velocities_;
+  slipping[1] += 5.0;
+  MecanumKinematics::Twist twist;
+  detector.update(kinematics_, slipping, twist);
+  ASSERT_TRUE(detector.isSlipping());
+
+  // e.g., a cycle with NaN wheel states
+  detector.reset();
+  EXPECT_FALSE(detector.isSlipping());
+  EXPECT_EQ(detector.residualNorm(), 0.0);
+  for (size_t i = 0; i < kinematics_.size(); ++i)
+  {
+    EXPECT_EQ(detector.residuals()[i], 0.0);
+    EXPECT_EQ(detector.innovations()[i], 0.0);
+  }
+  // the events are kept
+  EXPECT_EQ(detector.slipEvents()[1], 1u);
+}
+
+TEST_F(SlipDetectorTest, when_downweighting_disabled_expect_least_squares_twist)
+{
+  SlipDetector detector;
+  detector.configure(kinematics_.size(), 0.5, 0.05, false);
+  std::vector<double> slipping = wheel_velocities_;
+  slipping[0] -= 5.0;
+
+  MecanumKinematics::Twist twist;
+  MecanumKinematics::Twist least_squares_twist;
+  detector.update(kinematics_, slipping, twist);
+  kinematics_.forward(slipping, least_squares_twist);
+  EXPECT_TRUE(detector.isSlipping());
+  for (size_t j = 0; j < twist.size(); ++j)
+  {
+    EXPECT_EQ(twist[j], least_squares_twist[j]);
+  }
+}
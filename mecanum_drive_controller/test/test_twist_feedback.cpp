@@ -0,0 +1,98 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/twist_feedback.hpp"
+
+using mecanum_drive_controller::TwistFeedback;
+using mecanum_drive_controller::TwistFeedbackGains;
+
+TEST(TwistFeedbackTest, when_base_drifts_sideways_expect_integral_to_cancel_the_drift)
+{
+  TwistFeedback feedback;
+  feedback.configure({TwistFeedbackGains{0.5, 2.0, 0.0}, TwistFeedbackGains{0.5, 2.0, 0.0},
+                      TwistFeedbackGains{0.5, 2.0, 0.0}});
+
+  // the base achieves the commanded twist, except for a drift of -0.1 m/s along y
+  const TwistFeedback::Twist reference = {0.5, 0.0, 0.2};
+  TwistFeedback::Twist commanded = reference;
+  for (int i = 0; i < 2000; ++i)
+  {
+    const TwistFeedback::Twist measured = {commanded[0], commanded[1] - 0.1, commanded[2]};
+    commanded = reference;
+    feedback.correct(commanded, measured, 0.01);
+  }
+  EXPECT_NEAR(commanded[0], 0.5, 1e-9);
+  EXPECT_NEAR(commanded[1], 0.1, 1e-6);
+  EXPECT_NEAR(commanded[2], 0.2, 1e-9);
+  EXPECT_NEAR(feedback.getIntegrals()[1], 0.1, 1e-6);
+
+  feedback.reset();
+  EXPECT_EQ(feedback.getIntegrals()[1], 0.0);
+}
+
+TEST(TwistFeedbackTest, when_correction_saturated_expect_clamped_without_windup)
+{
+  TwistFeedback feedback;
+  feedback.configure({TwistFeedbackGains{1.0, 10.0, 0.2}, TwistFeedbackGains{},
+                      TwistFeedbackGains{}});
+
+  // blocked base
+  TwistFeedback::Twist commanded;
+  for (int i = 0; i < 1000; ++i)
+  {
+    commanded = {0.1, 0.0, 0.0};
+    feedback.correct(commanded, {0.0, 0.0, 0.0}, 0.01);
+    EXPECT_LE(feedback.getCorrection()[0], 0.2);
+  }
+  EXPECT_DOUBLE_EQ(commanded[0], 0.3);
+  EXPECT_DOUBLE_EQ(feedback.getIntegrals()[0], 0.1);
+  // components without gains are passed through
+  EXPECT_EQ(commanded[1], 0.0);
+
+  // the base moves again, the correction leaves the saturation at once
+  commanded = {0.1, 0.0, 0.0};
+  feedback.correct(commanded, {0.1, 0.0, 0.0}, 0.01);
+  EXPECT_DOUBLE_EQ(commanded[0], 0.2);
+}
+
+TEST(TwistFeedbackTest, when_corrected_twist_scaled_down_expect_no_windup)
+{
+  TwistFeedback feedback;
+  feedback.configure({TwistFeedbackGains{0.1, 10.0, 0.0}, TwistFeedbackGains{},
+                      TwistFeedbackGains{}});
+
+  // the correction would grow the integral, which is undone while the twist is scaled down
+  TwistFeedback::Twist commanded = {1.0, 0.0, 0.0};
+  feedback.correct(commanded, {0.0, 0.0, 0.0}, 0.01);
+  EXPECT_DOUBLE_EQ(feedback.getIntegrals()[0], 0.1);
+  feedback.scaleCorrection(0.5);
+  EXPECT_EQ(feedback.getIntegrals()[0], 0.0);
+  EXPECT_DOUBLE_EQ(feedback.getCorrection()[0], 0.1);
+
+  // without scaling the integral advances
+  commanded = {1.0, 0.0, 0.0};
+  feedback.correct(commanded, {0.0, 0.0, 0.0}, 0.01);
+  feedback.scaleCorrection(1.0);
+  EXPECT_DOUBLE_EQ(feedback.getIntegrals()[0], 0.1);
+  EXPECT_DOUBLE_EQ(feedback.getCorrection()[0], 0.2);
+
+  // an integral step that reduces the correction is kept
+  commanded = {1.0, 0.0, 0.0};
+  feedback.correct(commanded, {1.05, 0.0, 0.0}, 0.01);
+  EXPECT_DOUBLE_EQ(feedback.getCorrection()[0], 0.09);
+  feedback.scaleCorrection(0.5);
+  EXPECT_DOUBLE_EQ(feedback.getIntegrals()[0], 0.095);
+  EXPECT_DOUBLE_EQ(feedback.getCorrection()[0], 0.045);
+}
@@ -0,0 +1,132 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/twist_filter.hpp"
+
+using mecanum_drive_controller::TwistFilter;
+using mecanum_drive_controller::TwistFilterConfig;
+using mecanum_drive_controller::TwistFilterType;
+
+namespace
+{
+// Floating-point value comparison threshold
+const double EPS = 1e-9;
+const double DT = 0.01;  // [s]
+
+TwistFilterConfig make_config(TwistFilterType type)
+{
+  TwistFilterConfig config;
+  config.type = type;
+  config.window_size = 4;
+  config.exponential_alpha = 0.2;
+  config.cutoff_frequency = 5.0;
+  config.one_euro_beta = 1.0;
+  return config;
+}
+}  // namespace
+
+class TwistFilterTypeTest : public ::testing::TestWithParam<TwistFilterType>
+{
+};
+
+TEST_P(TwistFilterTypeTest, when_input_constant_expect_output_equal_to_input)
+{
+  TwistFilter filter;
+  filter.configure(make_config(GetParam()));
+  const TwistFilter::Twist input = {0.5, -0.2, 1.0};
+  for (size_t i = 0; i < 10; ++i)
+  {
+    const auto & output = filter.filter(input, DT);
+    EXPECT_NEAR(output[0], input[0], EPS);
+    EXPECT_NEAR(output[1], input[1], EPS);
+    EXPECT_NEAR(output[2], input[2], EPS);
+  }
+}
+
+TEST_P(TwistFilterTypeTest, when_input_steps_expect_output_converging_without_overshoot_beyond_step)
+{
+  TwistFilter filter;
+  filter.configure(make_config(GetParam()));
+  filter.filter({0.0, 0.0, 0.0}, DT);
+  double output = 0.0;
+  for (size_t i = 0; i < 200; ++i)
+  {
+    output = filter.filter({1.0, 0.0, 0.0}, DT)[0];
+    // second order Butterworth overshoots by about 4%
+    EXPECT_LT(output, 1.05);
+  }
+  EXPECT_NEAR(output, 1.0, 1e-3);
+
+  // after reset the next sample is taken as is
+  filter.reset();
+  EXPECT_EQ(filter.filter({-1.0, 0.0, 0.0}, DT)[0], -1.0);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  FilterTypes, TwistFilterTypeTest,
+  ::testing::Values(
+    TwistFilterType::NONE, TwistFilterType::MEAN, TwistFilterType::EXPONENTIAL,
+    TwistFilterType::BUTTERWORTH, TwistFilterType::ONE_EURO));
+
+TEST(TwistFilterTest, when_mean_filter_expect_mean_of_last_window)
+{
+  TwistFilter filter;
+  filter.configure(make_config(TwistFilterType::MEAN));
+  for (double value : {1.0, 2.0, 3.0, 4.0, 5.0, 6.0})
+  {
+    filter.filter({value, 0.0, 0.0}, DT);
+  }
+  EXPECT_NEAR(filter.output()[0], (3.0 + 4.0 + 5.0 + 6.0) / 4.0, EPS);
+}
+
+TEST(TwistFilterTest, when_butterworth_filters_sine_above_cutoff_expect_attenuation)
+{
+  TwistFilter filter;
+  filter.configure(make_config(TwistFilterType::BUTTERWORTH));
+  // 25 Hz sine, five times the cutoff: -28 dB for a second order filter
+  double amplitude = 0.0;
+  for (size_t i = 0; i < 1000; ++i)
+  {
+    const double output = filter.filter({std::sin(2.0 * M_PI * 25.0 * DT * i), 0.0, 0.0}, DT)[0];
+    if (i > 500)
+    {
+      amplitude = std::max(amplitude, std::abs(output));
+    }
+  }
+  EXPECT_LT(amplitude, 0.06);
+}
+
+TEST(TwistFilterTest, when_one_euro_input_moves_fast_expect_less_lag_than_slow_cutoff)
+{
+  TwistFilter one_euro;
+  one_euro.configure(make_config(TwistFilterType::ONE_EURO));
+  auto fixed_cutoff_config = make_config(TwistFilterType::ONE_EURO);
+  fixed_cutoff_config.one_euro_beta = 0.0;
+  TwistFilter fixed_cutoff;
+  fixed_cutoff.configure(fixed_cutoff_config);
+
+  // ramp of 10 m/s^2
+  for (size_t i = 0; i < 50; ++i)
+  {
+    one_euro.filter({10.0 * DT * i, 0.0, 0.0}, DT);
+    fixed_cutoff.filter({10.0 * DT * i, 0.0, 0.0}, DT);
+  }
+  const double input = 10.0 * DT * 49;
+  EXPECT_LT(input - one_euro.output()[0], 0.5 * (input - fixed_cutoff.output()[0]));
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/mecanum_kinematics.hpp"
+#include "mecanum_drive_controller/twist_limiter.hpp"
+
+using mecanum_drive_controller::AxisLimits;
+using mecanum_drive_controller::MecanumKinematics;
+using mecanum_drive_controller::TwistLimiter;
+
+namespace
+{
+const double EPS = 1e-9;
+const double DT = 0.01;
+}  // namespace
+
+class TwistLimiterTest : public ::testing::Test
+{
+public:
+  void SetUp()
+  {
+    ASSERT_TRUE(kinematics_.configure(0.4, 0.05, {0.0, 0.0, 0.0}));
+    wheel_velocities_.resize(kinematics_.size());
+  }
+
+protected:
+  MecanumKinematics kinematics_;
+  std::vector<double> wheel_velocities_;
+};
+
+TEST_F(TwistLimiterTest, when_no_limits_expect_twist_unchanged)
+{
+  TwistLimiter limiter;
+  limiter.configure({}, 0.0);
+  EXPECT_FALSE(limiter.isActive());
+
+  TwistLimiter::Twist twist = {3.0, -2.0, 5.0};
+  limiter.limit(twist, DT, kinematics_, wheel_velocities_);
+  EXPECT_EQ(twist, (TwistLimiter::Twist{3.0, -2.0, 5.0}));
+
+  std::vector<double> expected(kinematics_.size());
+  kinematics_.inverse(twist, expected);
+  EXPECT_EQ(wheel_velocities_, expected);
+}
+
+TEST_F(TwistLimiterTest, when_step_reference_expect_velocity_and_acceleration_limited)
+{
+  TwistLimiter limiter;
+  AxisLimits linear_x;
+  linear_x.max_velocity = 1.0;
+  linear_x.max_acceleration = 2.0;
+  limiter.configure({linear_x, AxisLimits(), AxisLimits()}, 0.0);
+  EXPECT_TRUE(limiter.isActive());
+
+  double previous = 0.0;
+  for (int i = 1; i <= 100; ++i)
+  {
+    TwistLimiter::Twist twist = {5.0, 0.0, 0.0};
+    limiter.limit(twist, DT, kinematics_, wheel_velocities_);
+    EXPECT_LE(twist[0] - previous, 2.0 * DT + EPS);
+    EXPECT_NEAR(twist[0], std::min(1.0, 2.0 * DT * i), EPS);
+    previous = twist[0];
+  }
+}
+
+TEST_F(TwistLimiterTest, when_jerk_limited_expect_smooth_acceleration_without_overshoot)
+{
+  TwistLimiter limiter;
+  AxisLimits angular_z;
+  angular_z.max_acceleration = 2.0;
+  angular_z.max_jerk = 10.0;
+  limiter.configure({AxisLimits(), AxisLimits(), angular_z}, 0.0);
+
+  double previous_acceleration = 0.0;
+  double velocity = 0.0;
+  for (int i = 0; i < 300; ++i)
+  {
+    TwistLimiter::Twist twist = {0.0, 0.0, 1.0};
+    limiter.limit(twist, DT, kinematics_, wheel_velocities_);
+    const double acceleration = limiter.getAcceleration()[2];
+    EXPECT_LE(std::abs(acceleration - previous_acceleration), 10.0 * DT + EPS);
+    EXPECT_LE(std::abs(acceleration), 2.0 + EPS);
+    EXPECT_LE(twist[2], 1.0 + 1e-3);
+    previous_acceleration = acceleration;
+    velocity = twist[2];
+  }
+  EXPECT_NEAR(velocity, 1.0, 1e-3);
+}
+
+TEST_F(TwistLimiterTest, when_wheel_saturates_expect_twist_scaled_uniformly)
+{
+  TwistLimiter limiter;
+  limiter.configure({}, 20.0);
+
+  // forward, sideways and turning: the wheels would need 1 / 0.05 * (1 + 0.5 + 0.4) = 38 rad/s
+  TwistLimiter::Twist twist = {1.0, 0.5, 1.0};
+  limiter.limit(twist, DT, kinematics_, wheel_velocities_);
+
+  double max_abs_wheel_velocity = 0.0;
+  for (const double wheel_velocity : wheel_velocities_)
+  {
+    max_abs_wheel_velocity = std::max(max_abs_wheel_velocity, std::abs(wheel_velocity));
+  }
+  EXPECT_NEAR(max_abs_wheel_velocity, 20.0, EPS);
+  EXPECT_NEAR(twist[1] / twist[0], 0.5, EPS);
+  EXPECT_NEAR(twist[2] / twist[0], 1.0, EPS);
+
+  std::vector<double> expected(kinematics_.size());
+  kinematics_.inverse(twist, expected);
+  for (size_t i = 0; i < expected.size(); ++i)
+  {
+    EXPECT_NEAR(wheel_velocities_[i], expected[i], EPS);
+  }
+}
+
+TEST_F(TwistLimiterTest, when_stages_run_separately_expect_ramp_to_continue_from_scaled_twist)
+{
+  TwistLimiter limiter;
+  AxisLimits linear_x;
+  linear_x.max_acceleration = 2.0;
+  limiter.configure({linear_x, AxisLimits(), AxisLimits()}, 20.0);
+
+  // a correction added between the stages is bounded only by the wheel velocity limit
+  TwistLimiter::Twist twist = {5.0, 0.0, 0.0};
+  limiter.limitComponents(twist, DT);
+  EXPECT_NEAR(twist[0], 0.02, EPS);
+  twist[0] += 2.98;
+  const double scale = limiter.desaturate(twist, kinematics_, wheel_velocities_);
+  EXPECT_NEAR(scale, 1.0 / 3.0, EPS);
+  EXPECT_NEAR(twist[0], 1.0, EPS);
+  EXPECT_NEAR(wheel_velocities_[0], 20.0, EPS);
+
+  // the ramp continues from the limited twist, scaled as it was commanded
+  EXPECT_NEAR(limiter.getVelocity()[0], 0.02 / 3.0, EPS);
+  EXPECT_NEAR(limiter.getAcceleration()[0], 0.02 / 3.0 / DT, EPS);
+  twist = {5.0, 0.0, 0.0};
+  limiter.limitComponents(twist, DT);
+  EXPECT_NEAR(twist[0], 0.02 / 3.0 + 0.02, EPS);
+  EXPECT_EQ(limiter.desaturate(twist, kinematics_, wheel_velocities_), 1.0);
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2023, Stogl Robotics Consulting UG (haftungsbeschränkt)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "mecanum_drive_controller/wheel_pid.hpp"
+
+using mecanum_drive_controller::WheelPidBank;
+
+TEST(WheelPidBankTest, when_tracking_reference_expect_feedforward_and_pid_terms)
+{
+  WheelPidBank::Gains gains;
+  gains.p = 2.0;
+  gains.i = 10.0;
+  gains.d = 0.1;
+  gains.feedforward = 0.5;
+  WheelPidBank pid;
+  pid.configure(2, gains);
+
+  std::vector<double> outputs(2, 0.0);
+  pid.update({1.0, -1.0}, {1.0, -1.0}, 0.01, outputs);
+  // no error: feedforward only
+  EXPECT_DOUBLE_EQ(outputs[0], 0.5);
+  EXPECT_DOUBLE_EQ(outputs[1], -0.5);
+
+  // error of 0.5, the measured velocity dropped by 0.5 in 10 ms
+  pid.update({1.0, -1.0}, {0.5, -1.0}, 0.01, outputs);
+  EXPECT_DOUBLE_EQ(pid.integrals()[0], 0.05);
+  EXPECT_DOUBLE_EQ(outputs[0], 0.5 + 2.0 * 0.5 + 0.05 + 0.1 * 50.0);
+  EXPECT_DOUBLE_EQ(outputs[1], -0.5);
+
+  pid.reset();
+  EXPECT_EQ(pid.integrals()[0], 0.0);
+  // no derivative kick after reset
+  pid.update({1.0, -1.0}, {0.0, -1.0}, 0.01, outputs);
+  EXPECT_DOUBLE_EQ(outputs[0], 0.5 + 2.0 + 0.1);
+}
+
+TEST(WheelPidBankTest, when_output_saturated_expect_integral_not_winding_up)
+{
+  WheelPidBank::Gains gains;
+  gains.p = 1.0;
+  gains.i = 10.0;
+  gains.max_output = 2.0;
+  WheelPidBank pid;
+  pid.configure(1, gains);
+
+  // blocked wheel, the output saturates after a few cycles
+  std::vector<double> outputs(1, 0.0);
+  for (int i = 0; i < 1000; ++i)
+  {
+    pid.update({1.5}, {0.0}, 0.01, outputs);
+    EXPECT_LE(outputs[0], 2.0);
+  }
+  EXPECT_DOUBLE_EQ(outputs[0], 2.0);
+  // the integral stops at the value that saturates the output
+  EXPECT_DOUBLE_EQ(pid.integrals()[0], 0.5);
+
+  // when the wheel reaches the reference, the output leaves the saturation at once
+  pid.update({1.5}, {1.5}, 0.01, outputs);
+  EXPECT_LT(outputs[0], 1.0);
+}
+
+TEST(WheelPidBankTest, when_integral_limited_expect_clamped_integral)
+{
+  WheelPidBank::Gains gains;
+  gains.i = 1.0;
+  gains.max_integral = 0.2;
+  WheelPidBank pid;
+  pid.configure(1, gains);
+
+  std::vector<double> outputs(1, 0.0);
+  for (int i = 0; i < 100; ++i)
+  {
+    pid.update({-1.0}, {0.0}, 0.01, outputs);
+  }
+  EXPECT_DOUBLE_EQ(pid.integrals()[0], -0.2);
+  EXPECT_DOUBLE_EQ(outputs[0], -0.2);
+}